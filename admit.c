@@ -0,0 +1,89 @@
+#include <stdint.h>
+#include <string.h>
+#include "admit.h"
+
+/**
+ * Prepare the admission state of a link with a full bucket.
+ *
+ * @param a Admission state
+ * @param rate Requests admitted per second on average (0: no rate limit)
+ * @param burst Requests admitted back to back (0: same as rate)
+ * @param now_ns Current time (timing_now_ns clock)
+ */
+void admit_init(admit_t *a, uint32_t rate, uint32_t burst, uint64_t now_ns) {
+    memset(a, 0, sizeof(*a));
+    a->rate = rate;
+    a->burst = burst ? burst : (rate ? rate : 1);
+    a->tokens = a->burst;
+    a->refill_ns = now_ns;
+}
+
+/**
+ * Add the tokens earned since the last refill. Only whole tokens are added
+ * and the refill time advances by exactly their worth, so no credit is lost
+ * to rounding.
+ *
+ * @param a Admission state
+ * @param now_ns Current time
+ */
+static void refill(admit_t *a, uint64_t now_ns) {
+    uint64_t elapsed = now_ns - a->refill_ns;
+    uint64_t full_ns = ((uint64_t)a->burst * 1000000000ull + a->rate - 1) / a->rate; // Time to fill the bucket
+    if (elapsed > full_ns) elapsed = full_ns; // Keeps elapsed * rate from overflowing after a long idle
+    uint64_t earned = elapsed * a->rate / 1000000000ull;
+    if (earned == 0) return;
+    if (a->tokens + earned >= a->burst) {
+        a->tokens = a->burst;
+        a->refill_ns = now_ns;
+    } else {
+        a->tokens += (uint32_t)earned;
+        a->refill_ns += earned * 1000000000ull / a->rate;
+    }
+}
+
+/**
+ * Decide whether a request that passed the free pre-checks may be
+ * authenticated. Costs a few arithmetic operations, so it can run for every
+ * frame of a flood.
+ *
+ * @param a Admission state
+ * @param now_ns Current time
+ * @return ADMIT_OK, ADMIT_PENALTY or ADMIT_RATE
+ */
+int admit_request(admit_t *a, uint64_t now_ns) {
+    if (now_ns < a->penalty_until_ns) {
+        a->dropped_penalty++;
+        return ADMIT_PENALTY;
+    }
+    if (a->rate) {
+        refill(a, now_ns);
+        if (a->tokens == 0) {
+            a->dropped_rate++;
+            return ADMIT_RATE;
+        }
+        a->tokens--;
+    }
+    a->admitted++;
+    return ADMIT_OK;
+}
+
+/**
+ * Record the outcome of an admitted request's MAC check. Each consecutive
+ * failure doubles the penalty window, up to ADMIT_PENALTY_MAX_MS.
+ *
+ * @param a Admission state
+ * @param authentic Nonzero if the request HMAC was valid
+ * @param now_ns Current time
+ */
+void admit_result(admit_t *a, int authentic, uint64_t now_ns) {
+    if (authentic) {
+        a->failures = 0;
+        return;
+    }
+    a->failed++;
+    uint64_t penalty_ms = ADMIT_PENALTY_BASE_MS;
+    for (uint32_t i = 0; i < a->failures && penalty_ms < ADMIT_PENALTY_MAX_MS; i++) penalty_ms *= 2;
+    if (penalty_ms > ADMIT_PENALTY_MAX_MS) penalty_ms = ADMIT_PENALTY_MAX_MS;
+    a->failures++;
+    a->penalty_until_ns = now_ns + penalty_ms * 1000000;
+}
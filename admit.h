@@ -0,0 +1,37 @@
+#ifndef ADMIT_H
+#define ADMIT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define ADMIT_PENALTY_BASE_MS 100    // Backoff after the first failed MAC
+#define ADMIT_PENALTY_MAX_MS 10000   // Longest backoff
+
+// Admission decisions
+#define ADMIT_OK 0
+#define ADMIT_RATE -1      // Token bucket empty
+#define ADMIT_PENALTY -2   // Backing off after failed MACs
+
+// Admission control of one link: bounds how often requests that passed the
+// free pre-checks may cost an HMAC (or more). Tokens refill at `rate` per
+// second up to `burst`; every failed MAC doubles a penalty window in which
+// nothing is admitted, and an authentic request resets it.
+typedef struct {
+    uint32_t rate;               // Admitted requests per second (0: unlimited)
+    uint32_t burst;              // Bucket size
+    uint32_t tokens;
+    uint64_t refill_ns;          // Time the tokens were last brought up to date
+    uint32_t failures;           // Consecutive failed MACs
+    uint64_t penalty_until_ns;   // Nothing is admitted before this time
+    uint64_t admitted;
+    uint64_t dropped_rate;
+    uint64_t dropped_penalty;
+    uint64_t failed;             // Admitted requests that failed the MAC check
+} admit_t;
+
+// Function prototypes
+void admit_init(admit_t *a, uint32_t rate, uint32_t burst, uint64_t now_ns);
+int admit_request(admit_t *a, uint64_t now_ns);
+void admit_result(admit_t *a, int authentic, uint64_t now_ns);
+
+#endif // ADMIT_H
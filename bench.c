@@ -0,0 +1,1283 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "admit.h"
+#include "frame.h"
+#include "golden.h"
+#include "keycache.h"
+#include "keystore.h"
+#include "measure.h"
+#include "mvring.h"
+#include "sched.h"
+#include "selfmeasure.h"
+#include "simple.h"
+#include "snapshot.h"
+#include "timing.h"
+
+/*
+ * Benchmarks for the building blocks of the SIMPLE implementation.
+ * Usage: ./bench <name> [options]; run without arguments for the list.
+ */
+
+#define BENCH_SAMPLES 65536 // Latency samples kept per recorder
+
+static uint64_t *alloc_samples(void) {
+    uint64_t *samples = malloc(BENCH_SAMPLES * sizeof(uint64_t));
+    if (!samples) {
+        perror("[BENCH] Failed to allocate samples");
+        exit(1);
+    }
+    return samples;
+}
+
+// ---------------------------------------------------------------------------
+// slice: latency a time-sliced measurement adds to a periodic control loop
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    measure_ctx_t ctx;
+    measure_region_t region;
+    size_t slice_bytes;
+    uint32_t rounds;       // Measurements completed
+    uint64_t start_ns;
+    lat_stats_t duration;  // Wall time per complete measurement
+} slice_bench_t;
+
+static int slice_measure_task(void *arg) {
+    slice_bench_t *b = arg;
+    if (!b->ctx.active) {
+        measure_begin(&b->ctx, &b->region, 1);
+        b->start_ns = timing_now_ns();
+    }
+    if (measure_step(&b->ctx, b->slice_bytes)) {
+        uint8_t digest[MEASURE_DIGEST_SIZE];
+        measure_finish(&b->ctx, digest);
+        lat_stats_record(&b->duration, timing_now_ns() - b->start_ns);
+        b->rounds++;
+    }
+    return 1; // Always more work: measure back to back
+}
+
+static int slice_control_task(void *arg) {
+    volatile double *plant = arg;
+    *plant += 0.1 * (1.0 - *plant);
+    return 0;
+}
+
+static int bench_slice(int argc, char **argv) {
+    size_t image_size = 16u << 20;
+    uint32_t period_us = 1000;
+    uint32_t seconds = 2;
+    int opt;
+    while ((opt = getopt(argc, argv, "m:p:s:")) != -1) {
+        if (opt == 'm') image_size = (size_t)strtoul(optarg, NULL, 10) << 10;
+        else if (opt == 'p') period_us = (uint32_t)strtoul(optarg, NULL, 10);
+        else if (opt == 's') seconds = (uint32_t)strtoul(optarg, NULL, 10);
+        else {
+            fprintf(stderr, "Usage: bench slice [-m image_kib] [-p period_us] [-s seconds]\n");
+            return 1;
+        }
+    }
+
+    uint8_t *image = malloc(image_size);
+    if (!image) {
+        perror("[BENCH] Failed to allocate image");
+        return 1;
+    }
+    for (size_t i = 0; i < image_size; i++) image[i] = (uint8_t)(i * 2654435761u >> 24);
+
+    // 0 = no measurement (baseline), SIZE_MAX = run-to-completion measurement
+    const size_t slices[] = { 0, SIZE_MAX, 256 << 10, 64 << 10, 16 << 10, 4 << 10 };
+    uint64_t *control_samples = alloc_samples();
+    uint64_t *duration_samples = alloc_samples();
+    static double plant;
+
+    printf("[BENCH] slice: %zu KiB image, %u us control period, %u s per run\n",
+           image_size >> 10, period_us, seconds);
+    printf("%12s %12s %12s %12s %14s\n",
+           "slice", "ctl p50 us", "ctl p99 us", "ctl max us", "measure ms");
+
+    for (size_t s = 0; s < sizeof(slices) / sizeof(slices[0]); s++) {
+        slice_bench_t b = { .region = { image, image_size }, .slice_bytes = slices[s] };
+        sched_task_t tasks[] = {
+            { "control", slice_control_task, &plant, (uint64_t)period_us * 1000 },
+            { "measure", slice_measure_task, &b, 0 },
+        };
+        lat_stats_init(&tasks[0].lateness, control_samples, BENCH_SAMPLES);
+        lat_stats_init(&tasks[1].lateness, NULL, 0);
+        lat_stats_init(&b.duration, duration_samples, BENCH_SAMPLES);
+
+        sched_t sched;
+        sched_init(&sched, tasks, slices[s] ? 2 : 1, -1);
+        uint64_t end = timing_now_ns() + (uint64_t)seconds * 1000000000ull;
+        while (timing_now_ns() < end) sched_run_once(&sched);
+
+        char label[32];
+        if (slices[s] == 0) snprintf(label, sizeof(label), "none");
+        else if (slices[s] == SIZE_MAX) snprintf(label, sizeof(label), "unsliced");
+        else snprintf(label, sizeof(label), "%zu KiB", slices[s] >> 10);
+
+        printf("%12s %12.1f %12.1f %12.1f %14.2f\n", label,
+               lat_stats_percentile(&tasks[0].lateness, 50.0) / 1e3,
+               lat_stats_percentile(&tasks[0].lateness, 99.0) / 1e3,
+               tasks[0].lateness.max_ns / 1e3,
+               b.rounds ? (double)b.duration.sum_ns / b.rounds / 1e6 : 0.0);
+    }
+
+    free(control_samples);
+    free(duration_samples);
+    free(image);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// frame: resynchronization after byte loss, framed vs. raw fixed-size stream
+// ---------------------------------------------------------------------------
+
+#define FRAME_BENCH_BAUD 115200 // Link the recovery time is quoted for (10 bits per byte)
+
+static uint64_t frame_rng(uint64_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+/**
+ * Fills the payload of message i: its index, then bytes derived from it,
+ * so a receiver can tell an intact message from a misaligned one.
+ */
+static void frame_payload(uint32_t i, uint8_t *out) {
+    uint64_t rng = 0x9E3779B97F4A7C15ull ^ i;
+    memcpy(out, &i, sizeof(i));
+    for (size_t k = sizeof(i); k < SIMPLE_REQUEST_SIZE; k++) out[k] = (uint8_t)frame_rng(&rng);
+}
+
+/**
+ * Appends one message to a stream, damaging it if kind >= 0: 0 drops, 1
+ * inserts and 2 flips bits, at a random offset within the message.
+ *
+ * @return Stream offset of the damage
+ */
+static size_t frame_append(uint8_t *stream, size_t *len, const uint8_t *msg, size_t n, int kind, uint64_t *rng) {
+    size_t at = frame_rng(rng) % n, burst = 1 + frame_rng(rng) % 8;
+    if (kind == 0 && at + burst > n) burst = n - at;
+
+    memcpy(stream + *len, msg, at);
+    size_t out = *len + at;
+    if (kind == 1) {
+        for (size_t k = 0; k < burst; k++) stream[out++] = (uint8_t)frame_rng(rng);
+    } else if (kind == 2) {
+        stream[out++] = msg[at] ^ (uint8_t)(1 + frame_rng(rng) % 255);
+        at++;
+    }
+    if (kind == 0) at += burst;
+    memcpy(stream + out, msg + at, n - at);
+    *len = out + n - at;
+    return *len - (n - at);
+}
+
+static int bench_frame(int argc, char **argv) {
+    uint32_t n = 100000, every = 100, chunk = 32;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:e:c:")) != -1) {
+        if (opt == 'n') n = (uint32_t)strtoul(optarg, NULL, 10);
+        else if (opt == 'e') every = (uint32_t)strtoul(optarg, NULL, 10);
+        else if (opt == 'c') chunk = (uint32_t)strtoul(optarg, NULL, 10);
+        else {
+            fprintf(stderr, "Usage: bench frame [-n messages] [-e damage_every] [-c read_bytes]\n");
+            return 1;
+        }
+    }
+    if (n == 0 || every == 0 || chunk == 0) return 1;
+
+    size_t cap = (size_t)n * (FRAME_MAX_SIZE + 8);
+    uint8_t *framed = malloc(cap), *raw = malloc(cap);
+    size_t *damage = malloc((n / every + 1) * sizeof(size_t));
+    if (!framed || !raw || !damage) {
+        perror("[BENCH] Failed to allocate streams");
+        return 1;
+    }
+
+    // The same messages and the same damage, with and without framing
+    size_t framed_len = 0, raw_len = 0, ndamage = 0;
+    uint64_t rng_framed = 42, rng_raw = 42;
+    for (uint32_t i = 0; i < n; i++) {
+        uint8_t payload[SIMPLE_REQUEST_SIZE], frame[FRAME_MAX_SIZE];
+        frame_payload(i, payload);
+        size_t flen = frame_encode(FRAME_REQUEST, payload, sizeof(payload), frame);
+        int kind = (i + 1) % every == 0 ? (int)(ndamage % 3) : -1;
+        size_t at = frame_append(framed, &framed_len, frame, flen, kind, &rng_framed);
+        frame_append(raw, &raw_len, payload, sizeof(payload), kind, &rng_raw);
+        if (kind >= 0) damage[ndamage++] = at;
+    }
+    printf("[BENCH] frame: %u requests, damage every %u (drop/insert/flip), read %u bytes at a time\n",
+           n, every, chunk);
+
+    // Framed: feed the stream as a UART would deliver it
+    static frame_rx_t rx;
+    frame_rx_init(&rx);
+    uint64_t delivered = 0, wrong = 0, recovery_sum = 0, recovery_max = 0, recovered = 0;
+    size_t fed = 0, next_damage = 0;
+    uint64_t t0 = timing_now_ns();
+    while (fed < framed_len) {
+        size_t space, len = framed_len - fed < chunk ? framed_len - fed : chunk;
+        uint8_t *tail = frame_rx_space(&rx, &space);
+        if (len > space) len = space;
+        memcpy(tail, framed + fed, len);
+        frame_rx_commit(&rx, len);
+        fed += len;
+
+        frame_t f;
+        while (frame_rx_next(&rx, &f)) {
+            uint8_t expect[SIMPLE_REQUEST_SIZE];
+            uint32_t idx;
+            memcpy(&idx, f.payload, sizeof(idx));
+            frame_payload(idx, expect);
+            if (f.length != SIMPLE_REQUEST_SIZE || idx >= n || memcmp(expect, f.payload, sizeof(expect)) != 0) {
+                wrong++;
+                continue;
+            }
+            delivered++;
+
+            // First intact frame starting after a damage point ends its recovery
+            size_t end = fed - (rx.len - rx.consumed), start = end - (f.length + FRAME_OVERHEAD);
+            while (next_damage < ndamage && damage[next_damage] < start) {
+                uint64_t bytes = end - damage[next_damage];
+                recovery_sum += bytes;
+                if (bytes > recovery_max) recovery_max = bytes;
+                recovered++;
+                next_damage++;
+            }
+        }
+    }
+    uint64_t elapsed = timing_now_ns() - t0;
+
+    // Raw: fixed-size reads, as before framing
+    uint64_t raw_delivered = 0;
+    for (size_t off = 0; off + SIMPLE_REQUEST_SIZE <= raw_len; off += SIMPLE_REQUEST_SIZE) {
+        uint8_t expect[SIMPLE_REQUEST_SIZE];
+        uint32_t idx;
+        memcpy(&idx, raw + off, sizeof(idx));
+        frame_payload(idx, expect);
+        if (idx < n && memcmp(expect, raw + off, sizeof(expect)) == 0) raw_delivered++;
+    }
+
+    double byte_ms = 10 * 1e3 / FRAME_BENCH_BAUD;
+    printf("[BENCH] %-28s %10s %10s %9s\n", "stream", "delivered", "lost", "wrong");
+    printf("[BENCH] %-28s %10llu %10llu %9s\n", "raw, fixed-size reads", (unsigned long long)raw_delivered,
+           (unsigned long long)(n - raw_delivered), "-");
+    printf("[BENCH] %-28s %10llu %10llu %9llu\n", "framed, CRC-32", (unsigned long long)delivered,
+           (unsigned long long)(n - delivered), (unsigned long long)wrong);
+    printf("[BENCH] Framing overhead %d bytes per request (%.1f%%)\n", FRAME_OVERHEAD,
+           100.0 * FRAME_OVERHEAD / SIMPLE_REQUEST_SIZE);
+    if (recovered) {
+        printf("[BENCH] Recovery after %llu damage points: mean %.1f bytes (%.2fms at %d baud), max %llu bytes (%.2fms)\n",
+               (unsigned long long)recovered, (double)recovery_sum / recovered, byte_ms * recovery_sum / recovered,
+               FRAME_BENCH_BAUD, (unsigned long long)recovery_max, byte_ms * recovery_max);
+    }
+    printf("[BENCH] Receiver: %.1f ns/byte (%.0f MB/s), %llu CRC errors, %llu bytes skipped\n",
+           (double)elapsed / framed_len, framed_len * 1e3 / elapsed, (unsigned long long)rx.crc_errors,
+           (unsigned long long)rx.skipped);
+
+    uint32_t crc = 0;
+    t0 = timing_now_ns();
+    for (int r = 0; r < 16; r++) crc += frame_crc32(framed + r, framed_len - r);
+    elapsed = timing_now_ns() - t0;
+    printf("[BENCH] CRC-32 (table): %.0f MB/s (checksum sum %08x)\n", 16.0 * framed_len * 1e3 / elapsed, crc);
+
+    free(damage);
+    free(raw);
+    free(framed);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// mvcalls: cycles spent in each microvisor entry point per attestation
+// ---------------------------------------------------------------------------
+
+static int bench_mvcalls(int argc, char **argv) {
+    uint32_t n = 10000, measured_kb = 4;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:m:")) != -1) {
+        if (opt == 'n') n = (uint32_t)strtoul(optarg, NULL, 10);
+        else if (opt == 'm') measured_kb = (uint32_t)strtoul(optarg, NULL, 10);
+        else {
+            fprintf(stderr, "Usage: bench mvcalls [-n attestations] [-m measured_kb]\n");
+            return 1;
+        }
+    }
+    if (n == 0 || measured_kb == 0) return 1;
+
+    size_t firmware_len = (size_t)measured_kb * 1024;
+    uint8_t *firmware = malloc(firmware_len);
+    if (!firmware) {
+        perror("[BENCH] Failed to allocate firmware");
+        return 1;
+    }
+    for (size_t i = 0; i < firmware_len; i++) firmware[i] = (uint8_t)(i * 7);
+    measure_region_t region = { .base = firmware, .len = firmware_len };
+
+    static microvisor_t prover_mv, verifier_mv;
+    simple_prover_t prover;
+    simple_verifier_t verifier;
+    uint8_t key[MV_KEY_SIZE], golden[MEASURE_DIGEST_SIZE];
+    memset(key, 0x77, sizeof(key));
+    microvisor_init(&prover_mv);
+    microvisor_set_keys(&prover_mv, key, key);
+    set_measured_regions(&prover_mv, &region, 1);
+    compute_software_measurement(&prover_mv, golden);
+    simple_prover_init(&prover, &prover_mv);
+    microvisor_init(&verifier_mv);
+    microvisor_set_keys(&verifier_mv, key, key);
+    simple_verifier_init(&verifier, &verifier_mv);
+    verifier.expected_measurement = golden;
+    microvisor_reset_call_stats(&prover_mv);
+    microvisor_reset_call_stats(&verifier_mv);
+
+    // The round as prover.c and verifier.c run it, minus the UART
+    uint32_t ok = 0;
+    uint64_t t0 = timing_cycles();
+    for (uint32_t i = 0; i < n; i++) {
+        simple_request_t req;
+        simple_report_t report;
+        uint8_t vs[MV_STATE_SIZE];
+        simple_verifier_build_request(&verifier, &req);
+        simple_verifier_expect_report(&verifier, &req);
+        if (simple_prover_check_request(&prover, &req, &report) != SIMPLE_OK) continue;
+        if (simple_prover_authenticate(&prover, &req) != SIMPLE_OK) continue;
+        compute_valid_software_state(&prover_mv, vs);
+        if (simple_prover_answer(&prover, &req, vs, &report) != SIMPLE_OK) continue;
+        ok += simple_verifier_check_report(&verifier, &req, &report) == SIMPLE_OK;
+    }
+    uint64_t round_cycles = timing_cycles() - t0;
+
+    // What one timed entry costs by itself: two counter reads
+    uint64_t probe = UINT64_MAX;
+    for (int i = 0; i < 1000; i++) {
+        uint64_t a = timing_cycles(), b = timing_cycles();
+        if (b - a < probe) probe = b - a;
+    }
+
+    double per_ns = timing_cycles_per_ns();
+    printf("[BENCH] mvcalls: %u attestations (%u succeeded), %uKB measured, %.2f cycles/ns\n",
+           n, ok, measured_kb, per_ns);
+    microvisor_print_call_stats(&prover_mv, "[BENCH] prover  ");
+    microvisor_print_call_stats(&verifier_mv, "[BENCH] verifier");
+
+    printf("[BENCH] Round: %.0f cycles (%.2fus), of which the entry points above are the microvisor's share\n",
+           (double)round_cycles / n, round_cycles / per_ns / n / 1e3);
+    printf("[BENCH] Timing overhead: at least %llu cycles per call (counter reads alone)\n",
+           (unsigned long long)probe);
+    free(firmware);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// mvring: out-of-process microvisor, boundary crossing amortized by batching
+// ---------------------------------------------------------------------------
+
+static int bench_mvring(int argc, char **argv) {
+    uint32_t n = 200000;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        if (opt == 'n') n = (uint32_t)strtoul(optarg, NULL, 10);
+        else {
+            fprintf(stderr, "Usage: bench mvring [-n macs]\n");
+            return 1;
+        }
+    }
+    if (n == 0) return 1;
+
+    uint8_t key[MV_KEY_SIZE], msg[SIMPLE_MAC_INPUT_SIZE], out[MAC_SIZE];
+    memset(key, 0x11, sizeof(key));
+    memset(msg, 0x22, sizeof(msg));
+
+    // Reference: the microvisor linked into the caller
+    static microvisor_t mv;
+    microvisor_init(&mv);
+    microvisor_set_keys(&mv, key, key);
+    uint64_t t0 = timing_now_ns();
+    for (uint32_t i = 0; i < n; i++) {
+        msg[0] = (uint8_t)i;
+        microvisor_mac(&mv, MV_KEY_AUTH, msg, sizeof(msg), out);
+    }
+    double inproc_ns = (double)(timing_now_ns() - t0) / n;
+
+    mvring_t ring;
+    if (mvring_start(&ring, key, key, NULL, 0) == -1) return 1;
+    memset(key, 0, sizeof(key));
+
+    printf("[BENCH] mvring: %u request MACs through a microvisor process, batched per doorbell\n", n);
+    printf("[BENCH] %-22s %12s %10s %14s %12s\n", "calls", "MACs/s", "ns/MAC", "crossing ns/MAC", "doorbells");
+    printf("[BENCH] %-22s %12.0f %10.1f %14s %12s\n", "in-process", 1e9 / inproc_ns, inproc_ns, "-", "-");
+
+    static const uint32_t batches[] = { 1, 2, 4, 8, 16, 32, 64, 128, 256 };
+    int failed = 0;
+    for (size_t b = 0; b < sizeof(batches) / sizeof(batches[0]); b++) {
+        uint32_t batch = batches[b];
+        mvring_cqe_t cqes[MVRING_ENTRIES];
+        uint64_t doorbells = ring.doorbells;
+
+        t0 = timing_now_ns();
+        for (uint32_t done = 0; done < n;) {
+            // Requests that arrived since the last doorbell: more of them the higher the rate
+            uint32_t k = n - done < batch ? n - done : batch;
+            for (uint32_t i = 0; i < k; i++) {
+                mvring_sqe_t *sqe = mvring_get_sqe(&ring);
+                sqe->op = MVRING_OP_MAC;
+                sqe->key_type = MV_KEY_AUTH;
+                sqe->len = sizeof(msg);
+                sqe->user = done + i;
+                memcpy(sqe->msg, msg, sizeof(msg));
+                sqe->msg[0] = (uint8_t)(done + i);
+            }
+            mvring_submit(&ring);
+            for (uint32_t got = 0; got < k;) {
+                size_t m = mvring_reap(&ring, cqes, MVRING_ENTRIES, 1);
+                for (size_t j = 0; j < m; j++) failed |= cqes[j].status != 0 || cqes[j].user != done + got + j;
+                got += m;
+            }
+            done += k;
+        }
+        double ns = (double)(timing_now_ns() - t0) / n;
+        char name[32];
+        snprintf(name, sizeof(name), "ring, batch %u", batch);
+        printf("[BENCH] %-22s %12.0f %10.1f %14.1f %12llu\n", name, 1e9 / ns, ns, ns - inproc_ns,
+               (unsigned long long)(ring.doorbells - doorbells));
+    }
+
+    // Same answers as the linked-in microvisor
+    mvring_sqe_t *sqe = mvring_get_sqe(&ring);
+    mvring_cqe_t cqe;
+    sqe->op = MVRING_OP_MAC;
+    sqe->key_type = MV_KEY_AUTH;
+    sqe->len = sizeof(msg);
+    memcpy(sqe->msg, msg, sizeof(msg));
+    mvring_submit(&ring);
+    mvring_reap(&ring, &cqe, 1, 1);
+    microvisor_mac(&mv, MV_KEY_AUTH, msg, sizeof(msg), out);
+    failed |= memcmp(cqe.out, out, MAC_SIZE) != 0;
+    printf("[BENCH] Results %s the in-process microvisor\n", failed ? "DIFFER from" : "match");
+
+    mvring_stop(&ring);
+    return failed;
+}
+
+// ---------------------------------------------------------------------------
+// snapshot: pause time of a fork/COW snapshot vs. stop-the-world measurement
+// ---------------------------------------------------------------------------
+
+// Simulated application: keeps dirtying random words of the measured image
+static uint64_t snapshot_workload(uint8_t *image, size_t size, uint64_t *rng, uint32_t writes) {
+    for (uint32_t i = 0; i < writes; i++) {
+        *rng ^= *rng << 13;
+        *rng ^= *rng >> 7;
+        *rng ^= *rng << 17;
+        image[*rng % size] ^= (uint8_t)*rng;
+    }
+    return writes;
+}
+
+static int bench_snapshot(int argc, char **argv) {
+    size_t image_size = 64u << 20;
+    uint32_t rounds = 10;
+    int opt;
+    while ((opt = getopt(argc, argv, "m:n:")) != -1) {
+        if (opt == 'm') image_size = (size_t)strtoul(optarg, NULL, 10) << 20;
+        else if (opt == 'n') rounds = (uint32_t)strtoul(optarg, NULL, 10);
+        else {
+            fprintf(stderr, "Usage: bench snapshot [-m image_mib] [-n rounds]\n");
+            return 1;
+        }
+    }
+    if (rounds == 0) rounds = 1;
+
+    uint8_t *image = malloc(image_size);
+    if (!image) {
+        perror("[BENCH] Failed to allocate image");
+        return 1;
+    }
+    for (size_t i = 0; i < image_size; i++) image[i] = (uint8_t)(i * 2654435761u >> 24);
+
+    measure_region_t region = { image, image_size };
+    uint8_t digest[MEASURE_DIGEST_SIZE];
+    uint64_t rng = 0x9E3779B97F4A7C15ull;
+    lat_stats_t inline_stats, pause_stats, total_stats;
+    uint64_t *inline_samples = alloc_samples(), *pause_samples = alloc_samples(), *total_samples = alloc_samples();
+    lat_stats_init(&inline_stats, inline_samples, BENCH_SAMPLES);
+    lat_stats_init(&pause_stats, pause_samples, BENCH_SAMPLES);
+    lat_stats_init(&total_stats, total_samples, BENCH_SAMPLES);
+
+    // Workload throughput with no measurement running
+    uint64_t writes = 0, start = timing_now_ns();
+    while (timing_now_ns() - start < 200000000ull) writes += snapshot_workload(image, image_size, &rng, 1024);
+    double idle_rate = writes / ((timing_now_ns() - start) / 1e9);
+
+    // Stop-the-world: the application is paused for the whole measurement
+    for (uint32_t r = 0; r < rounds; r++) {
+        measure_ctx_t ctx;
+        uint64_t t0 = timing_now_ns();
+        measure_begin(&ctx, &region, 1);
+        measure_step(&ctx, SIZE_MAX);
+        measure_finish(&ctx, digest);
+        lat_stats_record(&inline_stats, timing_now_ns() - t0);
+    }
+
+    // Snapshot: paused only for fork(), workload keeps writing meanwhile
+    uint64_t busy_ns = 0;
+    writes = 0;
+    for (uint32_t r = 0; r < rounds; r++) {
+        snapshot_t snap;
+        if (snapshot_begin(&snap, &region, 1) == -1) return 1;
+        uint64_t t0 = timing_now_ns();
+        int done;
+        while ((done = snapshot_poll(&snap, digest)) == 0) {
+            writes += snapshot_workload(image, image_size, &rng, 1024);
+        }
+        busy_ns += timing_now_ns() - t0;
+        if (done == -1) return 1;
+        lat_stats_record(&pause_stats, snap.pause_ns);
+        lat_stats_record(&total_stats, snap.total_ns);
+    }
+    double snap_rate = busy_ns ? writes / (busy_ns / 1e9) : 0.0;
+
+    printf("[BENCH] snapshot: %zu MiB image, %u rounds\n", image_size >> 20, rounds);
+    lat_stats_print("[BENCH] Stop-the-world pause", &inline_stats);
+    lat_stats_print("[BENCH] Snapshot pause (fork)", &pause_stats);
+    lat_stats_print("[BENCH] Snapshot total", &total_stats);
+    printf("[BENCH] Workload writes/s: %.0f idle, %.0f during snapshot (COW faults)\n",
+           idle_rate, snap_rate);
+
+    free(inline_samples);
+    free(pause_samples);
+    free(total_samples);
+    free(image);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// selfmeasure: cold vs. steady-state cost of measuring the loaded segments
+// ---------------------------------------------------------------------------
+
+static int bench_selfmeasure(int argc, char **argv) {
+    uint32_t rounds = 100;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        if (opt == 'n') rounds = (uint32_t)strtoul(optarg, NULL, 10);
+        else {
+            fprintf(stderr, "Usage: bench selfmeasure [-n rounds]\n");
+            return 1;
+        }
+    }
+
+    uint64_t *samples = alloc_samples();
+    lat_stats_t warm;
+    lat_stats_init(&warm, samples, BENCH_SAMPLES);
+
+    static selfmeasure_t self;
+    selfmeasure_init(&self);
+
+    uint8_t first[MEASURE_DIGEST_SIZE], digest[MEASURE_DIGEST_SIZE];
+    size_t total = 0, hashed = 0;
+    for (uint32_t r = 0; r <= rounds; r++) {
+        measure_region_t *regions;
+        measure_ctx_t ctx;
+        uint64_t t0 = timing_now_ns();
+        size_t n = selfmeasure_refresh(&self, &regions);
+        measure_begin(&ctx, regions, n);
+        measure_step(&ctx, SIZE_MAX);
+        measure_finish(&ctx, digest);
+        uint64_t elapsed = timing_now_ns() - t0;
+
+        if (r == 0) { // Cold: every segment hashed
+            total = 0;
+            for (size_t i = 0; i < n; i++) total += regions[i].len;
+            memcpy(first, digest, sizeof(first));
+            printf("[BENCH] selfmeasure: %zu segments, %zu KiB\n", n, total >> 10);
+            printf("[BENCH] Cold measurement: %.1fus (%zu KiB hashed)\n", elapsed / 1e3, ctx.hashed >> 10);
+        } else {
+            lat_stats_record(&warm, elapsed);
+            hashed += ctx.hashed;
+            if (memcmp(first, digest, sizeof(first)) != 0) {
+                printf("[BENCH] Measurement changed in round %u\n", r);
+            }
+        }
+    }
+    lat_stats_print("[BENCH] Steady-state measurement", &warm);
+    printf("[BENCH] Steady-state bytes hashed per round: %zu\n", rounds ? hashed / rounds : 0);
+
+    free(samples);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// keycache: hit rate and derivation cost under Zipfian device popularity
+// ---------------------------------------------------------------------------
+
+/**
+ * Draw device IDs whose popularity follows Zipf(s): rank r is picked with
+ * probability proportional to 1 / r^s. Ranks are scattered over the ID space.
+ */
+static void zipf_sequence(uint32_t *ids, size_t count, uint32_t devices, double s, uint64_t seed) {
+    double *cdf = malloc(devices * sizeof(double));
+    if (!cdf) {
+        perror("[BENCH] Failed to allocate CDF");
+        exit(1);
+    }
+    double sum = 0.0;
+    for (uint32_t r = 0; r < devices; r++) {
+        sum += 1.0 / pow(r + 1, s);
+        cdf[r] = sum;
+    }
+
+    uint64_t rng = seed;
+    for (size_t i = 0; i < count; i++) {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        double u = (rng >> 11) * (1.0 / 9007199254740992.0) * sum;
+        uint32_t lo = 0, hi = devices - 1;
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            if (cdf[mid] < u) lo = mid + 1;
+            else hi = mid;
+        }
+        ids[i] = lo * 2654435761u; // Rank -> device ID
+    }
+    free(cdf);
+}
+
+static int bench_keycache(int argc, char **argv) {
+    uint32_t devices = 100000;
+    uint32_t lookups = 1000000;
+    double skew = 1.0;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:k:s:")) != -1) {
+        if (opt == 'n') devices = (uint32_t)strtoul(optarg, NULL, 10);
+        else if (opt == 'k') lookups = (uint32_t)strtoul(optarg, NULL, 10);
+        else if (opt == 's') skew = strtod(optarg, NULL);
+        else {
+            fprintf(stderr, "Usage: bench keycache [-n devices] [-k lookups] [-s zipf_exponent]\n");
+            return 1;
+        }
+    }
+    if (devices == 0 || lookups == 0) return 1;
+
+    uint32_t *ids = malloc(lookups * sizeof(uint32_t));
+    if (!ids) {
+        perror("[BENCH] Failed to allocate lookups");
+        return 1;
+    }
+    zipf_sequence(ids, lookups, devices, skew, 0x2545F4914F6CDD1Dull);
+
+    const uint8_t master[32] = "bench master secret";
+    uint8_t state[MV_STATE_SIZE], digest[MEASURE_DIGEST_SIZE] = {0};
+    microvisor_t mv;
+    microvisor_init(&mv);
+
+    // Baseline: derive on every request
+    mac_key_t prk;
+    mv_keys_t keys;
+    keycache_root(&prk, master, sizeof(master));
+    uint64_t t0 = timing_now_ns();
+    for (uint32_t i = 0; i < lookups; i++) {
+        keycache_derive(&prk, ids[i], &keys);
+        microvisor_use_keys(&mv, &keys);
+        bind_software_measurement(&mv, digest, state);
+    }
+    double uncached_ns = (double)(timing_now_ns() - t0) / lookups;
+
+    printf("[BENCH] keycache: %u devices, %u lookups, Zipf s=%.2f\n", devices, lookups, skew);
+    printf("[BENCH] No cache: %.0f ns per attestation key setup + VS\n", uncached_ns);
+    printf("%12s %10s %14s %16s %10s\n", "capacity", "hit rate", "derive us/miss", "ns per lookup+VS", "speedup");
+
+    const double fractions[] = { 0.001, 0.01, 0.05, 0.1, 0.5, 1.0 };
+    for (size_t f = 0; f < sizeof(fractions) / sizeof(fractions[0]); f++) {
+        size_t capacity = (size_t)(devices * fractions[f]);
+        if (capacity == 0) continue;
+
+        keycache_t cache;
+        if (keycache_init(&cache, master, sizeof(master), capacity) == -1) {
+            perror("[BENCH] Failed to allocate cache");
+            return 1;
+        }
+        t0 = timing_now_ns();
+        for (uint32_t i = 0; i < lookups; i++) {
+            microvisor_use_keys(&mv, keycache_get(&cache, ids[i]));
+            bind_software_measurement(&mv, digest, state);
+        }
+        double per_lookup = (double)(timing_now_ns() - t0) / lookups;
+
+        printf("%12zu %9.1f%% %14.2f %16.0f %9.2fx\n", capacity,
+               100.0 * cache.hits / lookups,
+               cache.misses ? cache.derive_ns / 1e3 / cache.misses : 0.0,
+               per_lookup, uncached_ns / per_lookup);
+        keycache_free(&cache);
+    }
+
+    free(ids);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// keystore: startup and lookup cost of the mmap keystore vs. key files
+// ---------------------------------------------------------------------------
+
+static int bench_keystore(int argc, char **argv) {
+    uint32_t devices = 1000000;
+    uint32_t lookups = 1000000;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:k:")) != -1) {
+        if (opt == 'n') devices = (uint32_t)strtoul(optarg, NULL, 10);
+        else if (opt == 'k') lookups = (uint32_t)strtoul(optarg, NULL, 10);
+        else {
+            fprintf(stderr, "Usage: bench keystore [-n devices] [-k lookups]\n");
+            return 1;
+        }
+    }
+    if (devices == 0 || lookups == 0) return 1;
+
+    char path[] = "/tmp/bench_keystore_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd == -1) {
+        perror("[BENCH] Failed to create keystore file");
+        return 1;
+    }
+    close(fd);
+
+    uint32_t *ids = malloc(devices * sizeof(uint32_t));
+    uint8_t *keys = malloc((size_t)devices * KEYSTORE_KEY_SIZE);
+    if (!ids || !keys) {
+        perror("[BENCH] Failed to allocate keys");
+        return 1;
+    }
+    for (uint32_t i = 0; i < devices; i++) ids[i] = i * 2654435761u; // Sparse IDs
+    for (size_t i = 0; i < (size_t)devices * KEYSTORE_KEY_SIZE; i++) keys[i] = (uint8_t)(i * 131);
+    uint64_t t0 = timing_now_ns();
+    int written = keystore_write(path, ids, keys, keys, devices);
+    printf("[BENCH] keystore: %u devices, written in %.1fms\n", devices, (timing_now_ns() - t0) / 1e6);
+    if (written == -1) return 1;
+
+    keystore_t store;
+    t0 = timing_now_ns();
+    if (keystore_open(&store, path) == -1) return 1;
+    printf("[BENCH] Open (mmap + header check): %.1fus for %zu MiB\n",
+           (timing_now_ns() - t0) / 1e3, store.map_len >> 20);
+
+    uint8_t kauth[KEYSTORE_KEY_SIZE], kattest[KEYSTORE_KEY_SIZE];
+    uint64_t rng = 0x9E3779B97F4A7C15ull;
+    uint32_t missing = 0;
+    for (int pass = 0; pass < 2; pass++) { // Cold: first touch faults pages in
+        t0 = timing_now_ns();
+        for (uint32_t i = 0; i < lookups; i++) {
+            rng ^= rng << 13;
+            rng ^= rng >> 7;
+            rng ^= rng << 17;
+            missing += keystore_lookup(&store, ids[rng % devices], kauth, kattest) != 0;
+        }
+        printf("[BENCH] %s random lookup: %.0f ns\n", pass ? "Warm" : "Cold",
+               (double)(timing_now_ns() - t0) / lookups);
+    }
+    if (missing) printf("[BENCH] %u lookups failed\n", missing);
+    keystore_close(&store);
+
+    // Key files: what initialize_keys did per device
+    char kfile[sizeof(path) + 8];
+    snprintf(kfile, sizeof(kfile), "%s.key", path);
+    FILE *fp = fopen(kfile, "wb");
+    if (fp) {
+        fwrite(keys, 1, KEYSTORE_KEY_SIZE, fp);
+        fclose(fp);
+        keystore_t files;
+        keystore_open_files(&files, kfile, kfile);
+        uint32_t rounds = lookups < 10000 ? lookups : 10000;
+        t0 = timing_now_ns();
+        for (uint32_t i = 0; i < rounds; i++) keystore_lookup(&files, 0, kauth, kattest);
+        printf("[BENCH] Key files (fopen/fread) lookup: %.0f ns\n", (double)(timing_now_ns() - t0) / rounds);
+        unlink(kfile);
+    }
+
+    unlink(path);
+    free(keys);
+    free(ids);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// golden: expected-measurement lookup vs. hashing the firmware per request
+// ---------------------------------------------------------------------------
+
+static int bench_golden(int argc, char **argv) {
+    uint32_t models = 100, versions = 50;
+    uint32_t lookups = 1000000;
+    int opt;
+    while ((opt = getopt(argc, argv, "m:v:k:")) != -1) {
+        if (opt == 'm') models = (uint32_t)strtoul(optarg, NULL, 10);
+        else if (opt == 'v') versions = (uint32_t)strtoul(optarg, NULL, 10);
+        else if (opt == 'k') lookups = (uint32_t)strtoul(optarg, NULL, 10);
+        else {
+            fprintf(stderr, "Usage: bench golden [-m models] [-v versions_per_model] [-k lookups]\n");
+            return 1;
+        }
+    }
+    uint32_t count = models * versions;
+    if (count == 0 || lookups == 0) return 1;
+
+    golden_record_t *records = malloc(count * sizeof(golden_record_t));
+    if (!records) {
+        perror("[BENCH] Failed to allocate records");
+        return 1;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        records[i].model = i / versions;
+        records[i].version = i % versions;
+        memset(records[i].digest, (int)i, MEASURE_DIGEST_SIZE);
+    }
+
+    char path[] = "/tmp/bench_golden_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd == -1) {
+        perror("[BENCH] Failed to create golden database");
+        return 1;
+    }
+    close(fd);
+    if (golden_write(path, records, count) == -1) return 1;
+
+    golden_db_t db;
+    uint64_t t0 = timing_now_ns();
+    if (golden_open(&db, path) == -1) return 1;
+    printf("[BENCH] golden: %u entries (%u models x %u versions), opened in %.1fus\n",
+           count, models, versions, (timing_now_ns() - t0) / 1e3);
+
+    uint8_t digest[MEASURE_DIGEST_SIZE];
+    uint64_t rng = 0x9E3779B97F4A7C15ull;
+    uint32_t missing = 0;
+    t0 = timing_now_ns();
+    for (uint32_t i = 0; i < lookups; i++) {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        uint32_t r = (uint32_t)(rng % count);
+        missing += golden_lookup(&db, r / versions, r % versions, digest) != 0;
+    }
+    printf("[BENCH] Lookup: %.0f ns%s\n", (double)(timing_now_ns() - t0) / lookups, missing ? " (misses!)" : "");
+
+    t0 = timing_now_ns();
+    for (uint32_t i = 0; i < 10000; i++) golden_reload(&db);
+    printf("[BENCH] Reload check, file unchanged: %.0f ns\n", (double)(timing_now_ns() - t0) / 10000);
+
+    records[0].digest[0] ^= 1;
+    golden_write(path, records, count);
+    t0 = timing_now_ns();
+    int reloaded = golden_reload(&db);
+    printf("[BENCH] Reload after swap: %.1fus (%s)\n", (timing_now_ns() - t0) / 1e3,
+           reloaded == 1 ? "new file mapped" : "not picked up!");
+
+    // What the verifier did before: hash the firmware for every request
+    microvisor_t mv;
+    microvisor_init(&mv);
+    t0 = timing_now_ns();
+    for (uint32_t i = 0; i < 10000; i++) compute_software_measurement(&mv, digest);
+    printf("[BENCH] Measuring the firmware instead: %.0f ns\n", (double)(timing_now_ns() - t0) / 10000);
+
+    golden_close(&db);
+    unlink(path);
+    free(records);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// rotate: MAC throughput of attestation threads while keys are rotated
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    microvisor_t *mv;
+    atomic_int *stop;
+    uint64_t macs;
+    uint64_t torn;      // Keys that changed while pinned (must stay 0)
+} rotate_reader_t;
+
+/**
+ * Attestation thread: pins the current keys, checks that they belong to the
+ * epoch they claim (the writer fills both keys with the epoch's low byte),
+ * MACs a request-sized message and checks again before releasing them.
+ */
+static void *rotate_reader(void *arg) {
+    rotate_reader_t *r = arg;
+    uint8_t msg[72] = {0}, out[MAC_SIZE];
+    while (!atomic_load_explicit(r->stop, memory_order_relaxed)) {
+        mv_keys_ref_t ref;
+        microvisor_keys_get(r->mv, MV_KEYS_CURRENT, &ref);
+        uint8_t expect = (uint8_t)ref.keys->epoch;
+        int ok = ref.keys->kauth[0] == expect && ref.keys->kattest[MV_KEY_SIZE - 1] == expect;
+        microvisor_mac_with(r->mv, ref.keys, MV_KEY_AUTH, msg, sizeof(msg), out);
+        ok = ok && ref.keys->kauth[MV_KEY_SIZE - 1] == expect && ref.keys->epoch == expect;
+        microvisor_keys_put(r->mv, &ref);
+        r->torn += !ok;
+        r->macs++;
+        msg[0] = out[0];
+    }
+    return NULL;
+}
+
+/**
+ * Runs the reader threads for duration_ms, rotating the keys every
+ * rotate_us (0: never).
+ */
+static int rotate_run(microvisor_t *mv, int nthreads, uint32_t duration_ms, uint32_t rotate_us, uint32_t grace_ms) {
+    rotate_reader_t readers[16];
+    pthread_t threads[16];
+    atomic_int stop = 0;
+    uint8_t key[MV_KEY_SIZE];
+
+    for (int i = 0; i < nthreads; i++) {
+        readers[i] = (rotate_reader_t){ mv, &stop, 0, 0 };
+        pthread_create(&threads[i], NULL, rotate_reader, &readers[i]);
+    }
+
+    uint64_t start = timing_now_ns(), end = start + (uint64_t)duration_ms * 1000000;
+    uint64_t rotations = 0, rotate_ns = 0;
+    while (timing_now_ns() < end) {
+        if (rotate_us == 0) {
+            usleep(1000);
+            continue;
+        }
+        usleep(rotate_us);
+        memset(key, (uint8_t)(atomic_load(&mv->keys.epoch) + 1), sizeof(key));
+        uint64_t t0 = timing_now_ns();
+        microvisor_rotate_keys(mv, key, key, grace_ms);
+        rotate_ns += timing_now_ns() - t0;
+        rotations++;
+    }
+    atomic_store(&stop, 1);
+
+    uint64_t macs = 0, torn = 0;
+    for (int i = 0; i < nthreads; i++) {
+        pthread_join(threads[i], NULL);
+        macs += readers[i].macs;
+        torn += readers[i].torn;
+    }
+    double secs = (timing_now_ns() - start) / 1e9;
+    printf("[BENCH] %-20s %10.0f MACs/s", rotate_us ? "rotating:" : "no rotation:", macs / secs);
+    if (rotations) {
+        printf("  %llu rotations, %.1fus each", (unsigned long long)rotations, rotate_ns / 1e3 / rotations);
+    }
+    printf("  torn keys: %llu\n", (unsigned long long)torn);
+    return torn ? 1 : 0;
+}
+
+static int bench_rotate(int argc, char **argv) {
+    int nthreads = 2;
+    uint32_t duration_ms = 2000, rotate_us = 1000, grace_ms = 100;
+    int opt;
+    while ((opt = getopt(argc, argv, "t:d:r:g:")) != -1) {
+        if (opt == 't') nthreads = atoi(optarg);
+        else if (opt == 'd') duration_ms = (uint32_t)strtoul(optarg, NULL, 10);
+        else if (opt == 'r') rotate_us = (uint32_t)strtoul(optarg, NULL, 10);
+        else if (opt == 'g') grace_ms = (uint32_t)strtoul(optarg, NULL, 10);
+        else {
+            fprintf(stderr, "Usage: bench rotate [-t threads] [-d duration_ms] [-r rotate_every_us] [-g grace_ms]\n");
+            return 1;
+        }
+    }
+    if (nthreads < 1 || nthreads > 16) nthreads = 2;
+    if (rotate_us == 0) rotate_us = 1000;
+
+    static microvisor_t mv;
+    uint8_t key[MV_KEY_SIZE];
+    microvisor_init(&mv);
+    memset(key, (uint8_t)(atomic_load(&mv.keys.epoch) + 1), sizeof(key));
+    microvisor_set_keys(&mv, key, key);
+
+    printf("[BENCH] rotate: %d attestation threads, %ums, rotation every %uus\n", nthreads, duration_ms, rotate_us);
+    int failed = rotate_run(&mv, nthreads, duration_ms, 0, grace_ms);
+    failed |= rotate_run(&mv, nthreads, duration_ms, rotate_us, grace_ms);
+    return failed;
+}
+
+// ---------------------------------------------------------------------------
+// reports: report verification per report vs. the batched pipeline
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    uint64_t ok, rejected;
+} reports_tally_t;
+
+static void reports_sink(void *ctx, void *user, int status) {
+    reports_tally_t *tally = ctx;
+    (void)user;
+    if (status == SIMPLE_OK) tally->ok++;
+    else tally->rejected++;
+}
+
+/**
+ * Builds one request per session and a report for it; fail_pct of the
+ * reports carry a forged tag. Leaves the expected tags precomputed.
+ */
+static void reports_prepare(simple_verifier_t *sessions, simple_request_t *requests, uint8_t *report_bufs,
+                            uint32_t n, uint32_t fail_pct) {
+    for (uint32_t i = 0; i < n; i++) {
+        simple_report_t report = { .status = 1 };
+        simple_verifier_build_request(&sessions[i], &requests[i]);
+        simple_verifier_expect_report(&sessions[i], &requests[i]);
+        memcpy(report.mac, sessions[i].expected_report, SIMPLE_MAC_SIZE);
+        if (i % 100 < fail_pct) report.mac[SIMPLE_MAC_SIZE - 1] ^= 1;
+        simple_encode_report(&report, report_bufs + (size_t)i * SIMPLE_REPORT_SIZE);
+    }
+}
+
+static int bench_reports(int argc, char **argv) {
+    uint32_t n = 100000, fail_pct = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:f:")) != -1) {
+        if (opt == 'n') n = (uint32_t)strtoul(optarg, NULL, 10);
+        else if (opt == 'f') fail_pct = (uint32_t)strtoul(optarg, NULL, 10);
+        else {
+            fprintf(stderr, "Usage: bench reports [-n reports] [-f forged_pct]\n");
+            return 1;
+        }
+    }
+    if (n == 0) return 1;
+
+    static microvisor_t mv;
+    uint8_t key[MV_KEY_SIZE];
+    static uint8_t golden[MEASURE_DIGEST_SIZE];
+    microvisor_init(&mv);
+    memset(key, 0x5A, sizeof(key));
+    microvisor_set_keys(&mv, key, key);
+
+    simple_verifier_t *sessions = malloc(n * sizeof(simple_verifier_t));
+    simple_request_t *requests = malloc(n * sizeof(simple_request_t));
+    uint8_t *report_bufs = malloc((size_t)n * SIMPLE_REPORT_SIZE);
+    if (!sessions || !requests || !report_bufs) {
+        perror("[BENCH] Failed to allocate sessions");
+        return 1;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        simple_verifier_init(&sessions[i], &mv);
+        sessions[i].expected_measurement = golden;
+    }
+    printf("[BENCH] reports: %u reports, %u%% forged\n", n, fail_pct);
+    printf("[BENCH] %-34s %12s %10s %9s\n", "verification", "reports/s", "ns/report", "rejected");
+
+    for (int mode = 0; mode < 3; mode++) {
+        reports_tally_t tally = { 0, 0 };
+        simple_report_pipeline_t pipeline;
+        const char *name = mode == 0 ? "per report, HMAC on arrival"
+                         : mode == 1 ? "per report, precomputed tag" : "pipeline, precomputed tags";
+
+        reports_prepare(sessions, requests, report_bufs, n, fail_pct);
+        if (mode == 0) {
+            for (uint32_t i = 0; i < n; i++) sessions[i].expected_counter = 0; // Nothing precomputed
+        }
+        simple_report_pipeline_init(&pipeline, reports_sink, &tally);
+
+        uint64_t t0 = timing_now_ns();
+        for (uint32_t i = 0; i < n; i++) {
+            const uint8_t *buf = report_bufs + (size_t)i * SIMPLE_REPORT_SIZE;
+            if (mode == 2) {
+                simple_report_pipeline_push(&pipeline, &sessions[i], &requests[i], buf, NULL);
+            } else {
+                simple_report_t report;
+                simple_decode_report(buf, &report);
+                reports_sink(&tally, NULL, simple_verifier_check_report(&sessions[i], &requests[i], &report));
+            }
+        }
+        simple_report_pipeline_flush(&pipeline);
+        uint64_t elapsed = timing_now_ns() - t0;
+
+        printf("[BENCH] %-34s %12.0f %10.1f %9llu\n", name, n * 1e9 / elapsed, (double)elapsed / n,
+               (unsigned long long)tally.rejected);
+    }
+
+    free(report_bufs);
+    free(requests);
+    free(sessions);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// flood: prover CPU under a flood of forged requests
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    uint64_t frames, measurements, macs;
+    uint64_t legit_sent, legit_ok;
+} flood_tally_t;
+
+/**
+ * One request through the prover, as prover.c handles it in each mode:
+ * 0 measures first and then checks the HMAC (the old order), 1 checks the
+ * HMAC over the claimed VS first, 2 also runs admission control.
+ *
+ * @return 1 if a success report was produced
+ */
+static int flood_handle(int mode, simple_prover_t *prover, admit_t *admit, const simple_request_t *req,
+                        simple_report_t *report, flood_tally_t *tally) {
+    uint8_t vs[MV_STATE_SIZE];
+    uint64_t now = timing_now_ns();
+    tally->frames++;
+    if (simple_prover_check_request(prover, req, report) == SIMPLE_ERR_REPLAY) return 0;
+
+    if (mode == 2 && admit_request(admit, now) != ADMIT_OK) return 0;
+    if (mode >= 1) {
+        int authentic = simple_prover_authenticate(prover, req) == SIMPLE_OK;
+        tally->macs++;
+        if (mode == 2) admit_result(admit, authentic, now);
+        if (!authentic) return 0;
+    }
+    compute_valid_software_state(prover->mv, vs);
+    tally->measurements++;
+    tally->macs++;
+    return simple_prover_answer(prover, req, vs, report) == SIMPLE_OK;
+}
+
+static int bench_flood(int argc, char **argv) {
+    uint32_t rate = 20000, duration_ms = 2000, measured_kb = 256, admit_rate = 100;
+    uint32_t legit_ms = 100;
+    int opt;
+    while ((opt = getopt(argc, argv, "r:d:m:A:l:")) != -1) {
+        if (opt == 'r') rate = (uint32_t)strtoul(optarg, NULL, 10);
+        else if (opt == 'd') duration_ms = (uint32_t)strtoul(optarg, NULL, 10);
+        else if (opt == 'm') measured_kb = (uint32_t)strtoul(optarg, NULL, 10);
+        else if (opt == 'A') admit_rate = (uint32_t)strtoul(optarg, NULL, 10);
+        else if (opt == 'l') legit_ms = (uint32_t)strtoul(optarg, NULL, 10);
+        else {
+            fprintf(stderr, "Usage: bench flood [-r forged_per_s] [-d duration_ms] [-m measured_kb] "
+                            "[-A admit_per_s] [-l legit_every_ms]\n");
+            return 1;
+        }
+    }
+    if (rate == 0 || measured_kb == 0 || legit_ms == 0) return 1;
+
+    size_t firmware_len = (size_t)measured_kb * 1024;
+    uint8_t *firmware = malloc(firmware_len);
+    if (!firmware) {
+        perror("[BENCH] Failed to allocate firmware");
+        return 1;
+    }
+    for (size_t i = 0; i < firmware_len; i++) firmware[i] = (uint8_t)(i * 31);
+    measure_region_t region = { .base = firmware, .len = firmware_len };
+    uint8_t key[MV_KEY_SIZE], golden[MEASURE_DIGEST_SIZE];
+    memset(key, 0x3C, sizeof(key));
+
+    printf("[BENCH] flood: %u forged requests/s for %ums, %uKB measured, a genuine request every %ums\n",
+           rate, duration_ms, measured_kb, legit_ms);
+    printf("[BENCH] %-24s %6s %9s %9s %13s %9s\n", "prover", "CPU", "frames", "backlog", "measurements", "genuine");
+
+    for (int mode = 0; mode < 3; mode++) {
+        static microvisor_t prover_mv, verifier_mv;
+        simple_prover_t prover;
+        simple_verifier_t verifier;
+        admit_t admit;
+        flood_tally_t tally = { 0 };
+
+        microvisor_init(&prover_mv);
+        microvisor_set_keys(&prover_mv, key, key);
+        set_measured_regions(&prover_mv, &region, 1);
+        compute_software_measurement(&prover_mv, golden);
+        simple_prover_init(&prover, &prover_mv);
+        microvisor_init(&verifier_mv);
+        microvisor_set_keys(&verifier_mv, key, key);
+        simple_verifier_init(&verifier, &verifier_mv);
+        verifier.expected_measurement = golden;
+
+        uint64_t start = timing_now_ns(), end = start + (uint64_t)duration_ms * 1000000;
+        uint64_t interval = 1000000000ull / rate, next_forged = start, next_legit = start;
+        uint64_t busy_ns = 0, arrived = 0;
+        admit_init(&admit, admit_rate, 0, start);
+
+        while (1) {
+            uint64_t now = timing_now_ns();
+            if (now >= end) break;
+            uint64_t due = next_forged < next_legit ? next_forged : next_legit;
+            if (due > now) {
+                struct timespec ts = { 0, (long)(due - now) };
+                nanosleep(&ts, NULL);
+                continue;
+            }
+
+            simple_request_t req;
+            simple_report_t report;
+            uint64_t t0 = timing_now_ns();
+            if (next_legit <= next_forged) {
+                simple_verifier_build_request(&verifier, &req);
+                tally.legit_sent++;
+                if (flood_handle(mode, &prover, &admit, &req, &report, &tally) &&
+                    simple_verifier_check_report(&verifier, &req, &report) == SIMPLE_OK) {
+                    tally.legit_ok++;
+                }
+                next_legit += (uint64_t)legit_ms * 1000000;
+            } else {
+                memset(&req, 0, sizeof(req)); // Fresh counter, garbage HMAC
+                req.counter = prover.counter + 1 + (uint32_t)(arrived & 0xFF);
+                memset(req.mac, (int)arrived, SIMPLE_MAC_SIZE);
+                flood_handle(mode, &prover, &admit, &req, &report, &tally);
+                next_forged += interval;
+                arrived++;
+            }
+            busy_ns += timing_now_ns() - t0;
+        }
+        // Forged frames that were due but never got processed
+        uint64_t due_total = (end - start) / interval;
+        uint64_t backlog = due_total > arrived ? due_total - arrived : 0;
+
+        const char *name = mode == 0 ? "measure, then HMAC" : mode == 1 ? "HMAC on claimed VS first" : "plus admission control";
+        printf("[BENCH] %-24s %5.0f%% %9llu %9llu %13llu %5llu/%llu\n", name,
+               100.0 * busy_ns / (end - start), (unsigned long long)tally.frames, (unsigned long long)backlog,
+               (unsigned long long)tally.measurements, (unsigned long long)tally.legit_ok,
+               (unsigned long long)tally.legit_sent);
+        if (mode == 2) {
+            printf("[BENCH] Admission (%u/s): admitted %llu, dropped %llu by rate and %llu by penalty\n", admit_rate,
+                   (unsigned long long)admit.admitted, (unsigned long long)admit.dropped_rate,
+                   (unsigned long long)admit.dropped_penalty);
+        }
+    }
+    free(firmware);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    const char *name;
+    int (*run)(int argc, char **argv);
+    const char *help;
+} bench_t;
+
+static const bench_t benches[] = {
+    { "slice", bench_slice, "control loop latency added by time-sliced measurement" },
+    { "snapshot", bench_snapshot, "pause vs. total time of fork/COW snapshot measurement" },
+    { "selfmeasure", bench_selfmeasure, "cold vs. cached measurement of the loaded segments" },
+    { "keycache", bench_keycache, "per-device key cache hit rate under Zipfian access" },
+    { "keystore", bench_keystore, "mmap keystore startup and lookup vs. key files" },
+    { "golden", bench_golden, "golden database lookup and reload cost" },
+    { "frame", bench_frame, "resynchronization after byte loss, framed vs. raw stream" },
+    { "flood", bench_flood, "prover CPU under a flood of forged requests" },
+    { "mvcalls", bench_mvcalls, "cycles spent in each microvisor entry point per attestation" },
+    { "mvring", bench_mvring, "microvisor process behind a call ring, by batch size" },
+    { "reports", bench_reports, "report verification per report vs. batched pipeline" },
+    { "rotate", bench_rotate, "attestation MAC throughput during lock-free key rotation" },
+};
+
+int main(int argc, char **argv) {
+    if (argc >= 2) {
+        for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+            if (strcmp(argv[1], benches[i].name) == 0) {
+                return benches[i].run(argc - 1, argv + 1);
+            }
+        }
+    }
+
+    fprintf(stderr, "Usage: %s <benchmark> [options]\n", argv[0]);
+    for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+        fprintf(stderr, "    %-12s %s\n", benches[i].name, benches[i].help);
+    }
+    return 1;
+}
@@ -0,0 +1,809 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "keycache.h"
+#include "microvisor.h"
+#include "simple.h"
+#include "swarm.h"
+#include "timing.h"
+
+/*
+ * In-process fleet simulator for load-testing the verifier.
+ *
+ * Hosts N virtual provers, each with its own keys, counter and microvisor,
+ * and one verifier session per device, all in a single process. Device keys
+ * are derived from a master secret; the verifier looks them up in a key
+ * cache before every request, as a real fleet verifier would. Requests and
+ * reports travel over in-memory queues instead of ptys. Requests arrive
+ * open-loop at a target rate; a request that finds every device busy (or the
+ * verifier behind schedule) waits, and that wait is the queueing delay.
+ *
+ * Faults can be injected per request: extra prover processing delay (the
+ * report is held back, no CPU is burnt), failures (the prover answers from a
+ * tampered VS, as compromised software would) and replays (a copy of the
+ * device's last accepted request is delivered again to the prover).
+ *
+ * With request pregeneration, the verifier uses idle time to build the next
+ * requests of the devices due soon, in batches; issuing one is then a copy.
+ *
+ * Links can lose requests and reports, and some devices can be dead (never
+ * answer). With a timeout, an unanswered request is retransmitted with a
+ * fresh counter and the device is given up on after the last retry, so its
+ * slot is freed and the rest of the fleet keeps its throughput.
+ *
+ * In swarm mode (-T) the fleet forms one tree instead and is attested with a
+ * single request per round (swarm.c); failures are injected per member and
+ * round, and dead members and lost messages show up in the missing bitmap.
+ */
+
+#define FLEET_SAMPLES 65536  // Latency samples kept per recorder
+#define FLEET_QUEUE_SIZE 65536 // Messages in flight per direction (power of two)
+#define FLEET_NONE UINT32_MAX  // End of the deadline list
+
+// A request or report on its way through an in-memory link
+typedef struct {
+    uint32_t device;
+    uint32_t attempt;   // Request the message belongs to (simulator bookkeeping)
+    uint64_t ready_ns;  // Not delivered before this time (injected delay)
+    uint8_t buf[SIMPLE_REQUEST_SIZE];
+} fleet_msg_t;
+
+// FIFO of messages; delays are uniform per direction, so FIFO order is delivery order
+typedef struct {
+    fleet_msg_t *msgs;
+    size_t head;
+    size_t tail;
+} fleet_queue_t;
+
+// Prover half of one simulated device
+typedef struct {
+    microvisor_t mv;
+    simple_prover_t prover;
+    uint8_t last_request[SIMPLE_REQUEST_SIZE]; // Replayed on demand
+    int has_last;
+    int dead;                                  // Never answers
+} virtual_prover_t;
+
+// Verifier half of one simulated device
+typedef struct {
+    microvisor_t mv;
+    simple_verifier_t verifier;
+    simple_request_t request;  // Outstanding request
+    simple_pregen_t pregen;    // Requests built ahead of time (capacity 0: off)
+    uint64_t arrival_ns;       // When the attestation was due (open-loop schedule)
+    int busy;                  // A request is outstanding
+    int tampered;              // Failure injected into the outstanding request
+    uint32_t attempt;          // Requests sent to the device so far, retransmissions included
+    uint32_t tries;            // Requests sent in the current attestation
+    uint64_t deadline_ns;      // Retransmit or give up if no report by then
+    uint32_t prev, next;       // Deadline list links (FLEET_NONE: end)
+    uint32_t timeouts;         // Requests of this device that timed out
+    uint32_t given_up;         // Attestations abandoned after the last retry
+} device_session_t;
+
+// Outstanding requests in deadline order. The timeout is the same for every
+// request, so appending on send keeps the list sorted.
+typedef struct {
+    uint32_t head, tail;
+} fleet_deadlines_t;
+
+typedef struct {
+    uint32_t devices;
+    uint32_t rate;        // Attestations per second
+    uint32_t seconds;
+    uint32_t delay_us;    // Injected prover processing delay
+    uint32_t fail_pct;    // Requests answered from a tampered VS
+    uint32_t replay_pct;  // Requests replayed to the prover afterwards
+    uint32_t key_cache;   // Devices whose keys the verifier keeps derived
+    uint32_t pregen;      // Requests pregenerated per device (0: build on issue)
+    uint32_t timeout_us;  // Report deadline after each request (0: wait forever)
+    uint32_t retries;     // Retransmissions before giving up on a device
+    uint32_t loss_pct;    // Requests and reports lost on the link
+    uint32_t dead_pct;    // Devices that never answer
+    uint32_t fanout;      // Swarm mode: children per member (0: attest devices one by one)
+} fleet_config_t;
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ull;
+
+/**
+ * xorshift64*: cheap, reproducible randomness for fault injection and keys.
+ */
+static uint64_t fleet_rand(void) {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545F4914F6CDD1Dull;
+}
+
+static int chance(uint32_t pct) {
+    return pct && fleet_rand() % 100 < pct;
+}
+
+static int queue_full(const fleet_queue_t *q) {
+    return q->tail - q->head == FLEET_QUEUE_SIZE;
+}
+
+static fleet_msg_t *queue_push(fleet_queue_t *q) {
+    return &q->msgs[q->tail++ & (FLEET_QUEUE_SIZE - 1)];
+}
+
+/**
+ * Return the oldest message if it is deliverable at now_ns.
+ */
+static fleet_msg_t *queue_peek(fleet_queue_t *q, uint64_t now_ns) {
+    if (q->head == q->tail) return NULL;
+    fleet_msg_t *m = &q->msgs[q->head & (FLEET_QUEUE_SIZE - 1)];
+    return m->ready_ns <= now_ns ? m : NULL;
+}
+
+static void deadline_append(fleet_deadlines_t *d, device_session_t *sessions, uint32_t i) {
+    sessions[i].prev = d->tail;
+    sessions[i].next = FLEET_NONE;
+    if (d->tail != FLEET_NONE) sessions[d->tail].next = i;
+    else d->head = i;
+    d->tail = i;
+}
+
+static void deadline_remove(fleet_deadlines_t *d, device_session_t *sessions, uint32_t i) {
+    device_session_t *s = &sessions[i];
+    if (s->prev != FLEET_NONE) sessions[s->prev].next = s->next;
+    else d->head = s->next;
+    if (s->next != FLEET_NONE) sessions[s->next].prev = s->prev;
+    else d->tail = s->prev;
+}
+
+static uint64_t cpu_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void *alloc_or_die(size_t size) {
+    void *p = calloc(1, size);
+    if (!p) {
+        perror("[FLEET] Allocation failed");
+        exit(1);
+    }
+    return p;
+}
+
+/**
+ * Provision every prover with its own keys derived from the fleet master
+ * secret. Verifier sessions get theirs from the key cache per request and
+ * expect the golden measurement instead of hashing firmware themselves.
+ */
+static void provision_fleet(virtual_prover_t *provers, device_session_t *sessions, uint32_t n,
+                            const uint8_t *master, const uint8_t *golden) {
+    mac_key_t prk;
+    keycache_root(&prk, master, MV_KEY_SIZE);
+    for (uint32_t i = 0; i < n; i++) {
+        mv_keys_t keys;
+        keycache_derive(&prk, i, &keys);
+
+        microvisor_init(&provers[i].mv);
+        microvisor_use_keys(&provers[i].mv, &keys);
+        simple_prover_init(&provers[i].prover, &provers[i].mv);
+
+        microvisor_init(&sessions[i].mv);
+        simple_verifier_init(&sessions[i].verifier, &sessions[i].mv);
+        sessions[i].verifier.expected_measurement = golden;
+    }
+}
+
+/**
+ * Virtual prover: handle one request exactly as prover.c does. A tampered VS
+ * fails the HMAC check; the simulated device then reports failure instead of
+ * staying silent, so the verifier does not stall.
+ *
+ * @return SIMPLE_OK, SIMPLE_ERR_REPLAY or SIMPLE_ERR_MAC
+ */
+static int prover_handle(virtual_prover_t *vp, const uint8_t *buf, int tampered,
+                         simple_report_t *report) {
+    simple_request_t req;
+    uint8_t vs[MV_STATE_SIZE];
+
+    simple_decode_request(buf, &req);
+    if (simple_prover_check_request(&vp->prover, &req, report) == SIMPLE_ERR_REPLAY) {
+        return SIMPLE_ERR_REPLAY;
+    }
+
+    compute_valid_software_state(&vp->mv, vs);
+    if (tampered) vs[0] ^= 0x01;
+    int status = simple_prover_answer(&vp->prover, &req, vs, report);
+    if (status != SIMPLE_OK) memset(report, 0, sizeof(*report));
+    return status;
+}
+
+// Verification results, updated by the report pipeline's sink
+typedef struct {
+    device_session_t *sessions;
+    fleet_deadlines_t *deadlines;  // NULL: no timeouts
+    lat_stats_t *e2e;
+    uint64_t completed, succeeded;
+    uint64_t injected_failures, detected_failures, missed_failures, false_alarms;
+    uint32_t idle_devices;
+} fleet_results_t;
+
+/**
+ * Report pipeline sink: tallies one verified report and frees its device.
+ */
+static void report_verified(void *ctx, void *user, int status) {
+    fleet_results_t *res = ctx;
+    device_session_t *s = user;
+    int ok = status == SIMPLE_OK;
+
+    lat_stats_record(res->e2e, timing_now_ns() - s->arrival_ns);
+    res->succeeded += ok;
+    if (s->tampered) {
+        res->injected_failures++;
+        if (ok) res->missed_failures++;
+        else res->detected_failures++;
+    } else if (!ok) {
+        res->false_alarms++;
+    }
+    if (res->deadlines) deadline_remove(res->deadlines, res->sessions, (uint32_t)(s - res->sessions));
+    s->busy = 0;
+    res->idle_devices++;
+    res->completed++;
+}
+
+/**
+ * Puts the device's next request into buf: a pregenerated one if the queue
+ * has any, else one built now. Every request gets a fresh counter, so a
+ * retransmission is never mistaken for a replay.
+ *
+ * @return 1 if the request was pregenerated
+ */
+static int next_request(device_session_t *s, keycache_t *keys, uint32_t device, uint8_t *buf) {
+    const uint8_t *frame = simple_verifier_take_request(&s->verifier, &s->pregen, &s->request);
+    if (frame) { // Built in idle time: sending is a copy
+        memcpy(buf, frame, SIMPLE_REQUEST_SIZE);
+        return 1;
+    }
+    microvisor_use_keys(&s->mv, keycache_get(keys, device));
+    simple_verifier_build_request(&s->verifier, &s->request);
+    simple_encode_request(&s->request, buf);
+    simple_verifier_expect_report(&s->verifier, &s->request); // Off the report path
+    return 0;
+}
+
+static int run_fleet(const fleet_config_t *cfg) {
+    virtual_prover_t *provers = alloc_or_die(cfg->devices * sizeof(virtual_prover_t));
+    device_session_t *sessions = alloc_or_die(cfg->devices * sizeof(device_session_t));
+    fleet_queue_t to_prover = { alloc_or_die(FLEET_QUEUE_SIZE * sizeof(fleet_msg_t)), 0, 0 };
+    fleet_queue_t to_verifier = { alloc_or_die(FLEET_QUEUE_SIZE * sizeof(fleet_msg_t)), 0, 0 };
+    uint64_t *queue_samples = alloc_or_die(FLEET_SAMPLES * sizeof(uint64_t));
+    uint64_t *e2e_samples = alloc_or_die(FLEET_SAMPLES * sizeof(uint64_t));
+    uint64_t *issue_samples = alloc_or_die(FLEET_SAMPLES * sizeof(uint64_t));
+    lat_stats_t queueing, e2e, issue;
+    lat_stats_init(&queueing, queue_samples, FLEET_SAMPLES);
+    lat_stats_init(&e2e, e2e_samples, FLEET_SAMPLES);
+    lat_stats_init(&issue, issue_samples, FLEET_SAMPLES);
+
+    uint8_t master[MV_KEY_SIZE];
+    for (size_t j = 0; j < MV_KEY_SIZE; j += 8) {
+        uint64_t r = fleet_rand();
+        memcpy(master + j, &r, 8);
+    }
+    keycache_t keys;
+    if (keycache_init(&keys, master, sizeof(master), cfg->key_cache) == -1) {
+        perror("[FLEET] Failed to allocate key cache");
+        exit(1);
+    }
+
+    // The whole fleet runs the dummy firmware: its golden measurement, computed once
+    uint8_t golden[MEASURE_DIGEST_SIZE];
+    microvisor_init(&sessions[0].mv);
+    compute_software_measurement(&sessions[0].mv, golden);
+
+    uint64_t t0 = timing_now_ns();
+    provision_fleet(provers, sessions, cfg->devices, master, golden);
+    printf("[FLEET] Provisioned %u devices in %.1fms\n", cfg->devices, (timing_now_ns() - t0) / 1e6);
+
+    simple_pregen_slot_t *pregen_slots = NULL;
+    if (cfg->pregen) {
+        pregen_slots = alloc_or_die((size_t)cfg->devices * cfg->pregen * sizeof(simple_pregen_slot_t));
+        for (uint32_t i = 0; i < cfg->devices; i++) {
+            simple_pregen_init(&sessions[i].pregen, pregen_slots + (size_t)i * cfg->pregen, cfg->pregen);
+        }
+    }
+    uint32_t pregen_device = 0, pregen_empty = cfg->pregen ? cfg->devices : 0;
+    uint64_t pregen_ns = 0, pregen_hits = 0;
+
+    uint64_t interval_ns = 1000000000ull / cfg->rate;
+    uint64_t total = (uint64_t)cfg->rate * cfg->seconds;
+    uint64_t issued = 0;
+    uint64_t injected_replays = 0, rejected_replays = 0;
+    uint64_t verifier_ns = 0, prover_ns = 0;
+    uint32_t next_device = 0;
+    uint64_t timeout_ns = (uint64_t)cfg->timeout_us * 1000, lost = 0, late_reports = 0;
+    uint64_t timeouts = 0, retransmissions = 0, given_up = 0;
+    fleet_msg_t discarded; // Where lost messages go
+    fleet_deadlines_t deadlines = { FLEET_NONE, FLEET_NONE };
+    for (uint32_t i = 0; i < cfg->devices; i++) provers[i].dead = chance(cfg->dead_pct);
+    fleet_results_t res = { .sessions = sessions, .deadlines = timeout_ns ? &deadlines : NULL, .e2e = &e2e,
+                            .idle_devices = cfg->devices };
+    simple_report_pipeline_t reports;
+    simple_report_pipeline_init(&reports, report_verified, &res);
+
+    uint64_t start_ns = timing_now_ns();
+    uint64_t cpu_start_ns = cpu_now_ns();
+    while (res.completed < total) {
+        uint64_t now = timing_now_ns();
+        int progress = 0;
+
+        // Verifier: issue every attestation that is due, if a device is free
+        while (issued < total && start_ns + issued * interval_ns <= now &&
+               res.idle_devices > 0 && !queue_full(&to_prover)) {
+            while (sessions[next_device].busy) next_device = (next_device + 1) % cfg->devices;
+            device_session_t *s = &sessions[next_device];
+            fleet_msg_t *m = chance(cfg->loss_pct) ? &discarded : queue_push(&to_prover);
+            lost += m == &discarded;
+
+            uint64_t t = timing_now_ns();
+            s->arrival_ns = start_ns + issued * interval_ns;
+            lat_stats_record(&queueing, t - s->arrival_ns);
+            if (next_request(s, &keys, next_device, m->buf)) {
+                pregen_hits++;
+                if (s->pregen.count == 0) pregen_empty++;
+            }
+            uint64_t issued_ns = timing_now_ns();
+            verifier_ns += issued_ns - t;
+            lat_stats_record(&issue, issued_ns - t);
+
+            s->busy = 1;
+            s->tampered = chance(cfg->fail_pct);
+            s->attempt++;
+            s->tries = 1;
+            if (timeout_ns) {
+                s->deadline_ns = issued_ns + timeout_ns;
+                deadline_append(&deadlines, sessions, next_device);
+            }
+            m->device = next_device;
+            m->attempt = s->attempt;
+            m->ready_ns = 0;
+            res.idle_devices--;
+            issued++;
+            next_device = (next_device + 1) % cfg->devices;
+            progress = 1;
+        }
+
+        // Provers: answer requests; reports are held back by the processing delay
+        fleet_msg_t *m;
+        while ((m = queue_peek(&to_prover, now)) != NULL) {
+            virtual_prover_t *vp = &provers[m->device];
+            device_session_t *s = &sessions[m->device];
+            simple_report_t report;
+
+            if (vp->dead) { // Swallows the request
+                to_prover.head++;
+                progress = 1;
+                continue;
+            }
+            uint64_t t = timing_now_ns();
+            int status = prover_handle(vp, m->buf, s->tampered, &report);
+            if (chance(cfg->replay_pct) && vp->has_last) { // Attacker re-sends an accepted request
+                simple_report_t ignored;
+                injected_replays++;
+                rejected_replays += prover_handle(vp, vp->last_request, 0, &ignored) == SIMPLE_ERR_REPLAY;
+            }
+            if (status == SIMPLE_OK) {
+                memcpy(vp->last_request, m->buf, SIMPLE_REQUEST_SIZE);
+                vp->has_last = 1;
+            }
+            prover_ns += timing_now_ns() - t;
+
+            uint32_t device = m->device, attempt = m->attempt;
+            to_prover.head++;
+            // Full only with many retransmissions in flight: then the report is lost too
+            fleet_msg_t *r = chance(cfg->loss_pct) || queue_full(&to_verifier) ? &discarded : queue_push(&to_verifier);
+            lost += r == &discarded;
+            r->device = device;
+            r->attempt = attempt;
+            r->ready_ns = now + (uint64_t)cfg->delay_us * 1000;
+            simple_encode_report(&report, r->buf);
+            progress = 1;
+        }
+
+        // Verifier: collect the reports that have arrived and verify them in batches
+        uint64_t check_start = timing_now_ns(), verified = reports.reports;
+        while ((m = queue_peek(&to_verifier, now)) != NULL) {
+            device_session_t *s = &sessions[m->device];
+            if (s->busy && m->attempt == s->attempt) {
+                simple_report_pipeline_push(&reports, &s->verifier, &s->request, m->buf, s);
+            } else { // Answers a request that already timed out
+                late_reports++;
+            }
+            to_verifier.head++;
+            progress = 1;
+        }
+        simple_report_pipeline_flush(&reports);
+        if (reports.reports != verified) {
+            verifier_ns += timing_now_ns() - check_start;
+            progress = 1;
+        }
+
+        // Verifier: retransmit requests past their deadline, give up after the last retry
+        while (deadlines.head != FLEET_NONE && sessions[deadlines.head].deadline_ns <= now) {
+            uint32_t device = deadlines.head;
+            device_session_t *s = &sessions[device];
+            deadline_remove(&deadlines, sessions, device);
+            s->timeouts++;
+            timeouts++;
+            progress = 1;
+
+            if (s->tries > cfg->retries) {
+                s->given_up++;
+                given_up++;
+                s->busy = 0;
+                res.idle_devices++;
+                res.completed++;
+                continue;
+            }
+            fleet_msg_t *m = chance(cfg->loss_pct) || queue_full(&to_prover) ? &discarded : queue_push(&to_prover);
+            lost += m == &discarded;
+            uint64_t t = timing_now_ns();
+            if (next_request(s, &keys, device, m->buf) && s->pregen.count == 0) pregen_empty++;
+            uint64_t sent_ns = timing_now_ns();
+            verifier_ns += sent_ns - t;
+
+            s->attempt++;
+            s->tries++;
+            s->deadline_ns = sent_ns + timeout_ns;
+            deadline_append(&deadlines, sessions, device);
+            m->device = device;
+            m->attempt = s->attempt;
+            m->ready_ns = 0;
+            retransmissions++;
+        }
+
+        if (!progress) { // Sleep until the next arrival, report or deadline, whichever is first
+            uint64_t wake = issued < total ? start_ns + issued * interval_ns : UINT64_MAX;
+            if (deadlines.head != FLEET_NONE && sessions[deadlines.head].deadline_ns < wake) {
+                wake = sessions[deadlines.head].deadline_ns;
+            }
+            if (to_verifier.head != to_verifier.tail) {
+                uint64_t ready = to_verifier.msgs[to_verifier.head & (FLEET_QUEUE_SIZE - 1)].ready_ns;
+                if (ready < wake) wake = ready;
+            }
+
+            // Until then, refill the request queues of the devices due next
+            uint64_t t = timing_now_ns();
+            while (pregen_empty > 0 && t < wake) {
+                device_session_t *s = &sessions[pregen_device];
+                if (s->pregen.count == 0) {
+                    microvisor_use_keys(&s->mv, keycache_get(&keys, pregen_device));
+                    if (simple_verifier_pregenerate(&s->verifier, &s->pregen) > 0) pregen_empty--;
+                    uint64_t done = timing_now_ns();
+                    pregen_ns += done - t;
+                    t = done;
+                }
+                pregen_device = (pregen_device + 1) % cfg->devices;
+            }
+            now = timing_now_ns();
+            if (wake > now && wake != UINT64_MAX) {
+                struct timespec ts = { (time_t)((wake - now) / 1000000000ull), (long)((wake - now) % 1000000000ull) };
+                nanosleep(&ts, NULL);
+            }
+        }
+    }
+    uint64_t elapsed_ns = timing_now_ns() - start_ns;
+    uint64_t cpu_ns = cpu_now_ns() - cpu_start_ns;
+
+    printf("[FLEET] %llu attestations in %.2fs: %.0f/s achieved (target %u/s)\n",
+           (unsigned long long)res.completed, elapsed_ns / 1e9, res.completed * 1e9 / elapsed_ns, cfg->rate);
+    printf("[FLEET] Succeeded %llu, failures injected %llu (detected %llu, missed %llu), false alarms %llu\n",
+           (unsigned long long)res.succeeded, (unsigned long long)res.injected_failures,
+           (unsigned long long)res.detected_failures, (unsigned long long)res.missed_failures,
+           (unsigned long long)res.false_alarms);
+    printf("[FLEET] Replays injected %llu, rejected %llu\n",
+           (unsigned long long)injected_replays, (unsigned long long)rejected_replays);
+    printf("[FLEET] Key cache (%u devices): hit rate %.1f%%, %.2fus per derivation\n", cfg->key_cache,
+           100.0 * keys.hits / (keys.hits + keys.misses),
+           keys.misses ? keys.derive_ns / 1e3 / keys.misses : 0.0);
+    if (timeout_ns) {
+        uint32_t timed_out_devices = 0, worst = 0;
+        for (uint32_t i = 0; i < cfg->devices; i++) {
+            timed_out_devices += sessions[i].timeouts > 0;
+            if (sessions[i].timeouts > sessions[worst].timeouts) worst = i;
+        }
+        printf("[FLEET] Messages lost %llu, late reports dropped %llu\n",
+               (unsigned long long)lost, (unsigned long long)late_reports);
+        printf("[FLEET] Timeouts %llu (%uus): retransmitted %llu, gave up on %llu attestations\n",
+               (unsigned long long)timeouts, cfg->timeout_us, (unsigned long long)retransmissions,
+               (unsigned long long)given_up);
+        printf("[FLEET] Devices with timeouts: %u, most on device %u (%u timeouts, gave up %u times)\n",
+               timed_out_devices, worst, sessions[worst].timeouts, sessions[worst].given_up);
+    }
+    lat_stats_print("[FLEET] Queueing delay", &queueing);
+    lat_stats_print("[FLEET] End-to-end latency", &e2e);
+    lat_stats_print("[FLEET] Verifier issue path", &issue);
+    printf("[FLEET] Reports verified in %llu batches (%.1f per batch)\n", (unsigned long long)reports.batches,
+           reports.batches ? (double)reports.reports / reports.batches : 0.0);
+    if (cfg->pregen) {
+        printf("[FLEET] Pregenerated %u requests per device: %.1f%% of requests ready when due\n",
+               cfg->pregen, 100.0 * pregen_hits / issued);
+    }
+    printf("[FLEET] CPU per attestation: verifier %.2fus, provers %.2fus, process %.2fus\n",
+           (verifier_ns + pregen_ns) / 1e3 / res.completed, prover_ns / 1e3 / res.completed,
+           cpu_ns / 1e3 / res.completed);
+
+    keycache_free(&keys);
+    free(pregen_slots);
+    free(issue_samples);
+    free(e2e_samples);
+    free(queue_samples);
+    free(to_verifier.msgs);
+    free(to_prover.msgs);
+    free(sessions);
+    free(provers);
+    return res.missed_failures || res.false_alarms || rejected_replays != injected_replays ? 1 : 0;
+}
+
+// One swarm round in flight: the tree's devices and this round's faults
+typedef struct {
+    const fleet_config_t *cfg;
+    virtual_prover_t *provers;
+    swarm_member_t *members;
+    uint8_t *tampered;       // Member answers from a tampered VS this round
+    uint64_t prover_ns;
+} swarm_sim_t;
+
+/**
+ * Member i handles the round's request as a relaying device would: checks it,
+ * passes it to its children, answers and merges their reports into its own.
+ * A dead member, or a lost request or report, leaves the parent to mark the
+ * subtree missing.
+ *
+ * @return 0 if the member's report reaches its parent, -1 if not
+ */
+static int swarm_relay(swarm_sim_t *sim, uint32_t i, const uint8_t *buf, swarm_report_t *report) {
+    virtual_prover_t *vp = &sim->provers[i];
+    swarm_member_t *m = &sim->members[i];
+    swarm_request_t req;
+    uint8_t vs[MV_STATE_SIZE];
+
+    if (vp->dead || chance(sim->cfg->loss_pct)) return -1;
+    uint64_t t = timing_now_ns();
+    swarm_decode_request(buf, &req);
+    if (swarm_member_accept(m, &req) != SIMPLE_OK) return -1;
+    compute_valid_software_state(&vp->mv, vs);
+    if (sim->tampered[i]) vs[0] ^= 0x01;
+    swarm_member_contribute(m, &req, vs, report);
+    sim->prover_ns += timing_now_ns() - t;
+
+    uint32_t first = swarm_first_child(i, sim->cfg->fanout);
+    for (uint64_t c = first; c < (uint64_t)first + sim->cfg->fanout && c < sim->cfg->devices; c++) {
+        swarm_report_t child;
+        if (swarm_relay(sim, (uint32_t)c, buf, &child) == 0) swarm_report_merge(report, &child);
+        else swarm_report_mark_missing(report, (uint32_t)c, sim->cfg->devices, sim->cfg->fanout);
+    }
+    swarm_member_forward(m, report);
+    return chance(sim->cfg->loss_pct) ? -1 : 0;
+}
+
+/**
+ * Drill-down query: what member sent in the last round.
+ */
+static int swarm_ask(void *ctx, uint32_t member, uint8_t *own, uint8_t *subtree) {
+    swarm_sim_t *sim = ctx;
+    if (sim->provers[member].dead) return -1;
+    memcpy(own, sim->members[member].own, MAC_SIZE);
+    memcpy(subtree, sim->members[member].subtree, MAC_SIZE);
+    return 0;
+}
+
+static int run_swarm(const fleet_config_t *cfg) {
+    uint32_t n = cfg->devices;
+    virtual_prover_t *provers = alloc_or_die(n * sizeof(virtual_prover_t));
+    device_session_t *sessions = alloc_or_die(n * sizeof(device_session_t));
+    swarm_member_t *members = alloc_or_die(n * sizeof(swarm_member_t));
+    uint8_t *tampered = alloc_or_die(n);
+    uint32_t *suspects = alloc_or_die(n * sizeof(uint32_t));
+
+    uint8_t master[MV_KEY_SIZE];
+    for (size_t j = 0; j < MV_KEY_SIZE; j += 8) {
+        uint64_t r = fleet_rand();
+        memcpy(master + j, &r, 8);
+    }
+    keycache_t keys;
+    if (keycache_init(&keys, master, sizeof(master), cfg->key_cache) == -1) {
+        perror("[FLEET] Failed to allocate key cache");
+        exit(1);
+    }
+    uint8_t golden[MEASURE_DIGEST_SIZE];
+    microvisor_init(&sessions[0].mv);
+    compute_software_measurement(&sessions[0].mv, golden);
+    provision_fleet(provers, sessions, n, master, golden);
+
+    mac_key_t group;
+    swarm_group_key(keys.prk, &group);
+    uint32_t dead = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        swarm_member_init(&members[i], &provers[i].mv, &group, i);
+        provers[i].dead = i > 0 && chance(cfg->dead_pct); // A dead root would be a dead swarm
+        dead += provers[i].dead;
+    }
+    swarm_verifier_t verifier;
+    if (swarm_verifier_init(&verifier, &group, &keys, golden, n, cfg->fanout) == -1) {
+        fprintf(stderr, "[FLEET] Failed to set up the swarm verifier\n");
+        exit(1);
+    }
+
+    // Baseline: the verifier's work to attest every device on its own, once
+    uint64_t individual_ns = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        uint8_t buf[SIMPLE_REQUEST_SIZE];
+        simple_report_t report;
+        uint64_t t = timing_now_ns();
+        next_request(&sessions[i], &keys, i, buf);
+        individual_ns += timing_now_ns() - t;
+        prover_handle(&provers[i], buf, 0, &report);
+        t = timing_now_ns();
+        simple_verifier_check_report(&sessions[i].verifier, &sessions[i].request, &report);
+        individual_ns += timing_now_ns() - t;
+    }
+
+    printf("[FLEET] Tree of fanout %u, depth %u: one request, %u hops down and back per round\n",
+           cfg->fanout, swarm_depth(n, cfg->fanout), 2 * swarm_depth(n, cfg->fanout));
+
+    swarm_sim_t sim = { cfg, provers, members, tampered, 0 };
+    uint64_t rounds = 0, healthy = 0, prepare_ns = 0, check_ok_ns = 0, check_fail_ns = 0, failed_rounds = 0;
+    uint64_t injected = 0, hidden = 0, detected = 0, missed = 0, false_alarms = 0, missing = 0;
+    uint64_t cpu_start_ns = cpu_now_ns(), start_ns = timing_now_ns(), end_ns = start_ns + cfg->seconds * 1000000000ull;
+    while (timing_now_ns() < end_ns) {
+        uint64_t t = timing_now_ns();
+        swarm_verifier_prepare(&verifier); // Idle time between rounds
+        prepare_ns += timing_now_ns() - t;
+
+        uint32_t round_injected = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            tampered[i] = chance(cfg->fail_pct);
+            round_injected += tampered[i];
+        }
+
+        swarm_request_t req;
+        uint8_t buf[SWARM_REQUEST_SIZE];
+        swarm_report_t report;
+        swarm_verifier_take_request(&verifier, &req);
+        swarm_encode_request(&req, buf);
+        if (swarm_relay(&sim, 0, buf, &report) == -1) { // Lost between the verifier and the root
+            memset(&report, 0, sizeof(report));
+            swarm_report_mark_missing(&report, 0, n, cfg->fanout);
+        }
+
+        size_t nsuspects;
+        uint64_t queries = verifier.queries;
+        t = timing_now_ns();
+        int status = swarm_verifier_check(&verifier, &report, swarm_ask, &sim, suspects, n, &nsuspects);
+        uint64_t check_ns = timing_now_ns() - t;
+        rounds++;
+        missing += n - report.answered;
+        if (status == SIMPLE_OK) {
+            healthy++;
+            check_ok_ns += check_ns;
+        } else if (verifier.queries > queries) {
+            failed_rounds++;
+            check_fail_ns += check_ns;
+        }
+
+        // Score the verdicts against what was injected
+        for (size_t k = 0; k < nsuspects; k++) {
+            if (tampered[suspects[k]]) {
+                detected++;
+                tampered[suspects[k]] = 2;
+            } else {
+                false_alarms++;
+            }
+        }
+        for (uint32_t i = 0; i < n && round_injected; i++) {
+            if (!tampered[i]) continue;
+            round_injected--;
+            if (swarm_report_is_missing(&report, i)) hidden++;
+            else {
+                injected++;
+                missed += tampered[i] == 1;
+            }
+        }
+    }
+    uint64_t elapsed_ns = timing_now_ns() - start_ns;
+    uint64_t cpu_ns = cpu_now_ns() - cpu_start_ns;
+
+    printf("[FLEET] %llu rounds in %.2fs: %.0f device attestations/s, %llu rounds fully healthy\n",
+           (unsigned long long)rounds, elapsed_ns / 1e9, (double)rounds * n * 1e9 / elapsed_ns,
+           (unsigned long long)healthy);
+    printf("[FLEET] Failures injected %llu (detected %llu, missed %llu, unreachable %llu), false alarms %llu\n",
+           (unsigned long long)injected, (unsigned long long)detected, (unsigned long long)missed,
+           (unsigned long long)hidden, (unsigned long long)false_alarms);
+    printf("[FLEET] Dead devices %u, members missing per round %.1f\n", dead, (double)missing / rounds);
+    printf("[FLEET] Verifier per round: prepare %.1fus (idle), check %.2fus healthy",
+           prepare_ns / 1e3 / rounds, healthy ? check_ok_ns / 1e3 / healthy : 0.0);
+    if (failed_rounds) {
+        printf(", %.2fus and %.1f queries with failures", check_fail_ns / 1e3 / failed_rounds,
+               (double)verifier.queries / failed_rounds);
+    }
+    printf("\n[FLEET] One by one, the verifier spends %.1fus per round on %u requests and reports\n",
+           individual_ns / 1e3, n);
+    printf("[FLEET] CPU per round: provers %.1fus, process %.1fus\n", sim.prover_ns / 1e3 / rounds,
+           cpu_ns / 1e3 / rounds);
+
+    swarm_verifier_free(&verifier);
+    keycache_free(&keys);
+    memset(&group, 0, sizeof(group));
+    free(suspects);
+    free(tampered);
+    free(members);
+    free(sessions);
+    free(provers);
+    return missed || false_alarms ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    fleet_config_t cfg = { .devices = 1000, .rate = 10000, .seconds = 5 };
+    int opt;
+    while ((opt = getopt(argc, argv, "n:r:d:D:f:R:c:P:s:w:t:L:X:T:")) != -1) {
+        if (opt == 'n') {
+            cfg.devices = (uint32_t)strtoul(optarg, NULL, 10);
+        } else if (opt == 'r') {
+            cfg.rate = (uint32_t)strtoul(optarg, NULL, 10);
+        } else if (opt == 'd') {
+            cfg.seconds = (uint32_t)strtoul(optarg, NULL, 10);
+        } else if (opt == 'D') {
+            cfg.delay_us = (uint32_t)strtoul(optarg, NULL, 10);
+        } else if (opt == 'f') {
+            cfg.fail_pct = (uint32_t)strtoul(optarg, NULL, 10);
+        } else if (opt == 'R') {
+            cfg.replay_pct = (uint32_t)strtoul(optarg, NULL, 10);
+        } else if (opt == 'c') {
+            cfg.key_cache = (uint32_t)strtoul(optarg, NULL, 10);
+        } else if (opt == 'P') {
+            cfg.pregen = (uint32_t)strtoul(optarg, NULL, 10);
+        } else if (opt == 'w') {
+            cfg.timeout_us = (uint32_t)strtoul(optarg, NULL, 10);
+        } else if (opt == 't') {
+            cfg.retries = (uint32_t)strtoul(optarg, NULL, 10);
+        } else if (opt == 'L') {
+            cfg.loss_pct = (uint32_t)strtoul(optarg, NULL, 10);
+        } else if (opt == 'X') {
+            cfg.dead_pct = (uint32_t)strtoul(optarg, NULL, 10);
+        } else if (opt == 'T') {
+            cfg.fanout = (uint32_t)strtoul(optarg, NULL, 10);
+        } else if (opt == 's') {
+            rng_state = strtoull(optarg, NULL, 10) | 1;
+        } else {
+            fprintf(stderr, "Usage: %s [-n devices] [-r rate_per_s] [-d seconds] [-D prover_delay_us] "
+                            "[-f fail_pct] [-R replay_pct] [-c key_cache_devices] [-P pregen_depth] [-w timeout_us] "
+                            "[-t retries] [-L loss_pct] [-X dead_pct] [-T swarm_fanout] [-s seed]\n", argv[0]);
+            return -1;
+        }
+    }
+    if (cfg.devices == 0 || cfg.devices > FLEET_QUEUE_SIZE || cfg.rate == 0 || cfg.seconds == 0) {
+        fprintf(stderr, "[FLEET] Need 1..%d devices and a non-zero rate and duration\n", FLEET_QUEUE_SIZE);
+        return -1;
+    }
+    if (cfg.pregen > SIMPLE_PREGEN_MAX) {
+        fprintf(stderr, "[FLEET] At most %d requests can be pregenerated per device\n", SIMPLE_PREGEN_MAX);
+        return -1;
+    }
+    if (cfg.key_cache == 0) cfg.key_cache = cfg.devices;
+    if (cfg.fanout) {
+        if (cfg.devices > SWARM_MAX_MEMBERS) {
+            fprintf(stderr, "[FLEET] A swarm has at most %d devices\n", SWARM_MAX_MEMBERS);
+            return -1;
+        }
+        printf("[FLEET] Swarm of %u devices for %us, failures %u%%, loss %u%%, dead %u%%\n",
+               cfg.devices, cfg.seconds, cfg.fail_pct, cfg.loss_pct, cfg.dead_pct);
+        return run_swarm(&cfg);
+    }
+    if ((cfg.loss_pct || cfg.dead_pct) && cfg.timeout_us == 0) {
+        fprintf(stderr, "[FLEET] Lost messages and dead devices need a timeout (-w)\n");
+        return -1;
+    }
+
+    printf("[FLEET] %u devices, %u/s for %us, prover delay %uus, failures %u%%, replays %u%%\n",
+           cfg.devices, cfg.rate, cfg.seconds, cfg.delay_us, cfg.fail_pct, cfg.replay_pct);
+    return run_fleet(&cfg);
+}
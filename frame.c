@@ -0,0 +1,154 @@
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include "frame.h"
+
+static uint32_t crc_table[256];
+static pthread_once_t crc_table_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Build the byte-at-a-time table of the reflected CRC-32 polynomial.
+ * Filled once, on first use; pthread_once keeps other threads from reading
+ * it half built.
+ */
+static void crc_table_init(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        crc_table[i] = c;
+    }
+}
+
+/**
+ * Compute the CRC-32 (IEEE 802.3) of a buffer, one table lookup per byte.
+ *
+ * @param data Bytes to checksum
+ * @param len Number of bytes
+ * @return CRC-32 value
+ */
+uint32_t frame_crc32(const uint8_t *data, size_t len) {
+    pthread_once(&crc_table_once, crc_table_init);
+    uint32_t c = 0xFFFFFFFFu;
+    for (size_t i = 0; i < len; i++) c = crc_table[(c ^ data[i]) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
+
+/**
+ * Wrap a payload in a frame.
+ *
+ * @param type Message type (FRAME_REQUEST, FRAME_REPORT, ...)
+ * @param payload Message bytes
+ * @param len Payload length, at most FRAME_MAX_PAYLOAD
+ * @param out Buffer of at least len + FRAME_OVERHEAD bytes
+ * @return Frame length, or 0 if the payload is too long
+ */
+size_t frame_encode(uint8_t type, const uint8_t *payload, size_t len, uint8_t *out) {
+    if (len > FRAME_MAX_PAYLOAD) return 0;
+    out[0] = FRAME_SYNC0;
+    out[1] = FRAME_SYNC1;
+    out[2] = FRAME_VERSION;
+    out[3] = type;
+    out[4] = (uint8_t)len;
+    out[5] = (uint8_t)(len >> 8);
+    memcpy(out + FRAME_HEADER_SIZE, payload, len);
+
+    uint32_t crc = frame_crc32(out + 2, FRAME_HEADER_SIZE - 2 + len);
+    for (int i = 0; i < FRAME_CRC_SIZE; i++) out[FRAME_HEADER_SIZE + len + i] = (uint8_t)(crc >> (8 * i));
+    return len + FRAME_OVERHEAD;
+}
+
+/**
+ * Prepare an empty receiver.
+ *
+ * @param rx Receiver
+ */
+void frame_rx_init(frame_rx_t *rx) {
+    memset(rx, 0, sizeof(*rx));
+}
+
+/**
+ * Get the free part of the receive buffer, to read() into directly.
+ * Drops the frame returned last, so its payload becomes invalid.
+ *
+ * @param rx Receiver
+ * @param space Receives the number of bytes that fit
+ * @return Where new bytes go; pass the count to frame_rx_commit
+ */
+uint8_t *frame_rx_space(frame_rx_t *rx, size_t *space) {
+    if (rx->consumed) {
+        memmove(rx->buf, rx->buf + rx->consumed, rx->len - rx->consumed);
+        rx->len -= rx->consumed;
+        rx->consumed = 0;
+    }
+    *space = sizeof(rx->buf) - rx->len;
+    return rx->buf + rx->len;
+}
+
+/**
+ * Account for bytes written into the space from frame_rx_space.
+ *
+ * @param rx Receiver
+ * @param n Bytes added
+ */
+void frame_rx_commit(frame_rx_t *rx, size_t n) {
+    rx->len += n;
+}
+
+/**
+ * Discard bytes up to the next possible start of a frame after the first
+ * byte, so every buffered byte is examined as a candidate only once.
+ *
+ * @param rx Receiver
+ */
+static void resync(frame_rx_t *rx) {
+    const uint8_t *next = memchr(rx->buf + rx->consumed + 1, FRAME_SYNC0, rx->len - rx->consumed - 1);
+    size_t skip = next ? (size_t)(next - (rx->buf + rx->consumed)) : rx->len - rx->consumed;
+    rx->skipped += skip;
+    rx->consumed += skip;
+}
+
+/**
+ * Extract the next valid frame from the buffered bytes. Garbage, truncated
+ * frames and frames with a bad CRC are skipped by scanning forward to the
+ * next sync marker.
+ *
+ * @param rx Receiver
+ * @param frame Receives the frame; its payload is valid until the next
+ *              frame_rx_space call
+ * @return 1 if a frame was extracted, 0 if more bytes are needed
+ */
+int frame_rx_next(frame_rx_t *rx, frame_t *frame) {
+    while (rx->len - rx->consumed >= 2) {
+        const uint8_t *p = rx->buf + rx->consumed;
+        size_t avail = rx->len - rx->consumed;
+
+        if (p[0] != FRAME_SYNC0 || p[1] != FRAME_SYNC1) {
+            resync(rx);
+            continue;
+        }
+        if (avail < FRAME_HEADER_SIZE) return 0;
+
+        size_t length = p[4] | (size_t)p[5] << 8;
+        if (p[2] != FRAME_VERSION || p[3] == 0 || length > FRAME_MAX_PAYLOAD) {
+            resync(rx); // Not a header: the marker was part of some payload
+            continue;
+        }
+        if (avail < length + FRAME_OVERHEAD) return 0;
+
+        const uint8_t *c = p + FRAME_HEADER_SIZE + length;
+        uint32_t crc = c[0] | (uint32_t)c[1] << 8 | (uint32_t)c[2] << 16 | (uint32_t)c[3] << 24;
+        if (frame_crc32(p + 2, FRAME_HEADER_SIZE - 2 + length) != crc) {
+            rx->crc_errors++;
+            resync(rx);
+            continue;
+        }
+
+        frame->type = p[3];
+        frame->length = (uint16_t)length;
+        frame->payload = p + FRAME_HEADER_SIZE;
+        rx->consumed += length + FRAME_OVERHEAD;
+        rx->frames++;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,59 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Wire framing of protocol messages:
+ *
+ *   0xA5 0x5A | version (1) | type (1) | length (2, LE) | payload | CRC-32 (4, LE)
+ *
+ * The CRC (IEEE 802.3, reflected) covers version through payload. A receiver
+ * that lost or gained bytes scans for the next sync marker whose header is
+ * plausible and whose CRC matches, so one bad byte costs at most the frames
+ * it touched.
+ */
+
+#define FRAME_SYNC0 0xA5
+#define FRAME_SYNC1 0x5A
+#define FRAME_VERSION 1
+#define FRAME_HEADER_SIZE 6      // Sync marker, version, type, length
+#define FRAME_CRC_SIZE 4
+#define FRAME_MAX_PAYLOAD 256
+#define FRAME_OVERHEAD (FRAME_HEADER_SIZE + FRAME_CRC_SIZE)
+#define FRAME_MAX_SIZE (FRAME_OVERHEAD + FRAME_MAX_PAYLOAD)
+
+// Message types
+#define FRAME_REQUEST 1   // Attestation request
+#define FRAME_REPORT 2    // Attestation report
+#define FRAME_SWATT_CHALLENGE 3 // Timed attestation nonce
+#define FRAME_SWATT_CHECKSUM 4  // Timed attestation answer
+
+// A received frame; payload points into the receiver's buffer and stays
+// valid until the receiver is fed again
+typedef struct {
+    uint8_t type;
+    uint16_t length;
+    const uint8_t *payload;
+} frame_t;
+
+// Incremental frame receiver: bytes go in as they arrive, whole frames come out
+typedef struct {
+    uint8_t buf[2 * FRAME_MAX_SIZE];
+    size_t len;                // Bytes buffered
+    size_t consumed;           // Bytes of buf already returned as a frame
+    uint64_t frames;           // Valid frames received
+    uint64_t crc_errors;       // Plausible headers whose CRC did not match
+    uint64_t skipped;          // Bytes discarded while resynchronizing
+} frame_rx_t;
+
+// Function prototypes
+uint32_t frame_crc32(const uint8_t *data, size_t len);
+size_t frame_encode(uint8_t type, const uint8_t *payload, size_t len, uint8_t *out);
+void frame_rx_init(frame_rx_t *rx);
+uint8_t *frame_rx_space(frame_rx_t *rx, size_t *space);
+void frame_rx_commit(frame_rx_t *rx, size_t n);
+int frame_rx_next(frame_rx_t *rx, frame_t *frame);
+
+#endif // FRAME_H
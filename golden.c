@@ -0,0 +1,239 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "golden.h"
+
+static uint32_t get_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void put_le32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static int compare_key(uint32_t model_a, uint32_t version_a, uint32_t model_b, uint32_t version_b) {
+    if (model_a != model_b) return model_a < model_b ? -1 : 1;
+    if (version_a != version_b) return version_a < version_b ? -1 : 1;
+    return 0;
+}
+
+/**
+ * Map a golden database file and check its header and ordering.
+ *
+ * @param path Database file
+ * @param map_out Receives the mapping
+ * @param len_out Receives the mapping length
+ * @param count_out Receives the record count
+ * @param st Receives the file's identity
+ * @return 0 on success, -1 if the file cannot be mapped or is malformed
+ */
+static int map_db(const char *path, const uint8_t **map_out, size_t *len_out, uint32_t *count_out, struct stat *st) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        perror("[GOLDEN] Failed to open golden database");
+        return -1;
+    }
+    if (fstat(fd, st) == -1 || (size_t)st->st_size < GOLDEN_HEADER_SIZE) {
+        fprintf(stderr, "[GOLDEN] %s: not a golden database\n", path);
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, (size_t)st->st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("[GOLDEN] Failed to map golden database");
+        return -1;
+    }
+
+    const uint8_t *hdr = map;
+    uint32_t count = get_le32(hdr + 12);
+    int ok = memcmp(hdr, GOLDEN_MAGIC, 8) == 0 && get_le32(hdr + 8) == GOLDEN_VERSION &&
+             GOLDEN_HEADER_SIZE + (uint64_t)count * GOLDEN_RECORD_SIZE == (uint64_t)st->st_size;
+
+    // Binary search relies on strict ordering: check it once per load
+    const uint8_t *rec = hdr + GOLDEN_HEADER_SIZE;
+    for (uint32_t i = 1; ok && i < count; i++, rec += GOLDEN_RECORD_SIZE) {
+        const uint8_t *next = rec + GOLDEN_RECORD_SIZE;
+        ok = compare_key(get_le32(rec), get_le32(rec + 4), get_le32(next), get_le32(next + 4)) < 0;
+    }
+    if (!ok) {
+        fprintf(stderr, "[GOLDEN] %s: bad header, size or ordering\n", path);
+        munmap(map, (size_t)st->st_size);
+        return -1;
+    }
+
+    *map_out = map;
+    *len_out = (size_t)st->st_size;
+    *count_out = count;
+    return 0;
+}
+
+/**
+ * Open a golden database.
+ *
+ * @param db Database to initialize
+ * @param path Database file; kept for reloads, so it must stay valid
+ * @return 0 on success, -1 on error
+ */
+int golden_open(golden_db_t *db, const char *path) {
+    struct stat st;
+    memset(db, 0, sizeof(*db));
+    db->path = path;
+    if (map_db(path, &db->map, &db->map_len, &db->count, &st) == -1) return -1;
+    db->dev = st.st_dev;
+    db->ino = st.st_ino;
+    db->mtime = st.st_mtim;
+    return 0;
+}
+
+/**
+ * Find the expected measurement of a firmware build by binary search.
+ *
+ * @param db Open database
+ * @param model Hardware model
+ * @param version Firmware version
+ * @param digest Buffer receiving MEASURE_DIGEST_SIZE bytes
+ * @return 0 if found, -1 if the build is unknown
+ */
+int golden_lookup(const golden_db_t *db, uint32_t model, uint32_t version, uint8_t *digest) {
+    const uint8_t *records = db->map + GOLDEN_HEADER_SIZE;
+    uint32_t lo = 0, hi = db->count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        const uint8_t *rec = records + (size_t)mid * GOLDEN_RECORD_SIZE;
+        int cmp = compare_key(get_le32(rec), get_le32(rec + 4), model, version);
+        if (cmp == 0) {
+            memcpy(digest, rec + 8, MEASURE_DIGEST_SIZE);
+            return 0;
+        }
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return -1;
+}
+
+/**
+ * Pick up a new database if the file was swapped since it was mapped.
+ * Costs one stat() when nothing changed. A broken replacement is rejected
+ * and the current mapping stays in use.
+ *
+ * @param db Open database
+ * @return 1 if a new database was loaded, 0 if unchanged, -1 if the new file was rejected
+ */
+int golden_reload(golden_db_t *db) {
+    struct stat st;
+    if (stat(db->path, &st) == -1) return 0; // Mid-swap or removed: keep what we have
+    if (st.st_dev == db->dev && st.st_ino == db->ino &&
+        st.st_mtim.tv_sec == db->mtime.tv_sec && st.st_mtim.tv_nsec == db->mtime.tv_nsec) {
+        return 0;
+    }
+
+    const uint8_t *map;
+    size_t len;
+    uint32_t count;
+    if (map_db(db->path, &map, &len, &count, &st) == -1) {
+        db->dev = st.st_dev; // Do not retry the same broken file on every request
+        db->ino = st.st_ino;
+        db->mtime = st.st_mtim;
+        return -1;
+    }
+
+    munmap((void *)db->map, db->map_len);
+    db->map = map;
+    db->map_len = len;
+    db->count = count;
+    db->dev = st.st_dev;
+    db->ino = st.st_ino;
+    db->mtime = st.st_mtim;
+    return 1;
+}
+
+/**
+ * Unmap a golden database.
+ *
+ * @param db Database from golden_open
+ */
+void golden_close(golden_db_t *db) {
+    if (db->map) munmap((void *)db->map, db->map_len);
+    memset(db, 0, sizeof(*db));
+}
+
+/**
+ * Copy every record out of a database, in order.
+ *
+ * @param db Open database
+ * @param records Array of at least db->count records
+ * @return Number of records copied
+ */
+int golden_read_all(const golden_db_t *db, golden_record_t *records) {
+    const uint8_t *rec = db->map + GOLDEN_HEADER_SIZE;
+    for (uint32_t i = 0; i < db->count; i++, rec += GOLDEN_RECORD_SIZE) {
+        records[i].model = get_le32(rec);
+        records[i].version = get_le32(rec + 4);
+        memcpy(records[i].digest, rec + 8, MEASURE_DIGEST_SIZE);
+    }
+    return (int)db->count;
+}
+
+static int compare_records(const void *a, const void *b) {
+    const golden_record_t *x = a, *y = b;
+    return compare_key(x->model, x->version, y->model, y->version);
+}
+
+/**
+ * Write a golden database. Records are sorted in place; the file is written
+ * under a temporary name and renamed over the old one, which is the atomic
+ * swap running verifiers pick up with golden_reload.
+ *
+ * @param path Destination file
+ * @param records Records to store (no duplicate model/version pairs)
+ * @param count Number of records
+ * @return 0 on success, -1 on error
+ */
+int golden_write(const char *path, golden_record_t *records, uint32_t count) {
+    qsort(records, count, sizeof(golden_record_t), compare_records);
+    for (uint32_t i = 1; i < count; i++) {
+        if (compare_records(&records[i - 1], &records[i]) == 0) {
+            fprintf(stderr, "[GOLDEN] Duplicate entry for model %u version %u\n",
+                    records[i].model, records[i].version);
+            return -1;
+        }
+    }
+
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp) {
+        perror("[GOLDEN] Failed to create golden database");
+        return -1;
+    }
+
+    uint8_t hdr[GOLDEN_HEADER_SIZE];
+    memcpy(hdr, GOLDEN_MAGIC, 8);
+    put_le32(hdr + 8, GOLDEN_VERSION);
+    put_le32(hdr + 12, count);
+    int ok = fwrite(hdr, sizeof(hdr), 1, fp) == 1;
+    for (uint32_t i = 0; ok && i < count; i++) {
+        uint8_t rec[GOLDEN_RECORD_SIZE];
+        put_le32(rec, records[i].model);
+        put_le32(rec + 4, records[i].version);
+        memcpy(rec + 8, records[i].digest, MEASURE_DIGEST_SIZE);
+        ok = fwrite(rec, sizeof(rec), 1, fp) == 1;
+    }
+    if (fflush(fp) != 0 || fsync(fileno(fp)) != 0) ok = 0;
+    if (fclose(fp) != 0) ok = 0;
+    if (!ok || rename(tmp, path) == -1) {
+        perror("[GOLDEN] Failed to write golden database");
+        unlink(tmp);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,51 @@
+#ifndef GOLDEN_H
+#define GOLDEN_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <time.h>
+#include "measure.h"
+
+#define GOLDEN_MAGIC "SIMPLEGD"      // First 8 bytes of a golden database file
+#define GOLDEN_VERSION 1
+#define GOLDEN_HEADER_SIZE 16
+#define GOLDEN_RECORD_SIZE (4 + 4 + MEASURE_DIGEST_SIZE) // { model, firmware version, digest }
+
+/*
+ * Golden measurement database layout (integers little-endian):
+ *   header   magic[8] | version u32 | record count u32
+ *   records  count * { model u32 | firmware version u32 | measurement digest[32] },
+ *            sorted by (model, firmware version), no duplicates
+ */
+
+// Expected measurement of one firmware build
+typedef struct {
+    uint32_t model;
+    uint32_t version;
+    uint8_t digest[MEASURE_DIGEST_SIZE];
+} golden_record_t;
+
+// A golden database mapped read-only. The file is only ever replaced by
+// rename, never modified in place, so a mapping stays consistent; a reload
+// maps the new file and unmaps the old one. Readers must not run while
+// golden_reload swaps the mapping.
+typedef struct {
+    const char *path;
+    const uint8_t *map;
+    size_t map_len;
+    uint32_t count;
+    dev_t dev;                 // Identity of the mapped file, to notice a swap
+    ino_t ino;
+    struct timespec mtime;
+} golden_db_t;
+
+// Function prototypes
+int golden_open(golden_db_t *db, const char *path);
+int golden_lookup(const golden_db_t *db, uint32_t model, uint32_t version, uint8_t *digest);
+int golden_reload(golden_db_t *db);
+void golden_close(golden_db_t *db);
+int golden_read_all(const golden_db_t *db, golden_record_t *records);
+int golden_write(const char *path, golden_record_t *records, uint32_t count);
+
+#endif // GOLDEN_H
@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include "golden.h"
+#include "microvisor.h"
+
+/**
+ * Adds or replaces the expected measurement of one firmware build. The new
+ * database is swapped in atomically; running verifiers reload it on their own.
+ */
+static int set_golden(int argc, char **argv) {
+    golden_record_t rec;
+    if (argc != 5 || parse_hex(argv[4], rec.digest, MEASURE_DIGEST_SIZE) == -1) {
+        fprintf(stderr, "Usage: golden_tool set golden_db model version measurement_hex\n");
+        return -1;
+    }
+    rec.model = (uint32_t)strtoul(argv[2], NULL, 10);
+    rec.version = (uint32_t)strtoul(argv[3], NULL, 10);
+
+    golden_db_t db;
+    uint32_t count = 0;
+    golden_record_t *records;
+    if (access(argv[1], F_OK) == 0) {
+        if (golden_open(&db, argv[1]) == -1) return -1;
+        records = malloc((db.count + 1) * sizeof(golden_record_t));
+        if (records) count = (uint32_t)golden_read_all(&db, records);
+        golden_close(&db);
+    } else {
+        records = malloc(sizeof(golden_record_t));
+    }
+    if (!records) {
+        perror("[GOLDEN] Failed to allocate records");
+        return -1;
+    }
+
+    uint32_t i = 0;
+    while (i < count && (records[i].model != rec.model || records[i].version != rec.version)) i++;
+    records[i] = rec;
+    if (i == count) count++;
+
+    int rc = golden_write(argv[1], records, count);
+    if (rc == 0) printf("[GOLDEN] %s: %u entries\n", argv[1], count);
+    free(records);
+    return rc;
+}
+
+/**
+ * Prints the expected measurement of one firmware build.
+ */
+static int get_golden(int argc, char **argv) {
+    if (argc != 4) {
+        fprintf(stderr, "Usage: golden_tool get golden_db model version\n");
+        return -1;
+    }
+    golden_db_t db;
+    uint8_t digest[MEASURE_DIGEST_SIZE];
+    uint32_t model = (uint32_t)strtoul(argv[2], NULL, 10);
+    uint32_t version = (uint32_t)strtoul(argv[3], NULL, 10);
+    if (golden_open(&db, argv[1]) == -1) return -1;
+
+    int rc = golden_lookup(&db, model, version, digest);
+    if (rc == 0) {
+        hex_dump("[GOLDEN] Expected measurement", digest, MEASURE_DIGEST_SIZE);
+    } else {
+        fprintf(stderr, "[GOLDEN] No entry for model %u version %u\n", model, version);
+    }
+    golden_close(&db);
+    return rc;
+}
+
+/**
+ * Prints every entry of a golden database.
+ */
+static int list_golden(int argc, char **argv) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: golden_tool list golden_db\n");
+        return -1;
+    }
+    golden_db_t db;
+    if (golden_open(&db, argv[1]) == -1) return -1;
+    golden_record_t *records = malloc((db.count + 1) * sizeof(golden_record_t));
+    if (!records) {
+        perror("[GOLDEN] Failed to allocate records");
+        return -1;
+    }
+    golden_read_all(&db, records);
+    for (uint32_t i = 0; i < db.count; i++) {
+        char label[64];
+        snprintf(label, sizeof(label), "model %u version %u", records[i].model, records[i].version);
+        hex_dump(label, records[i].digest, MEASURE_DIGEST_SIZE);
+    }
+    free(records);
+    golden_close(&db);
+    return 0;
+}
+
+/**
+ * Prints the measurement of the built-in dummy firmware, i.e. the golden
+ * value of a prover running without -s.
+ */
+static int measure_default(void) {
+    microvisor_t mv;
+    uint8_t digest[MEASURE_DIGEST_SIZE];
+    microvisor_init(&mv);
+    compute_software_measurement(&mv, digest);
+    for (size_t i = 0; i < MEASURE_DIGEST_SIZE; i++) printf("%02X", digest[i]);
+    printf("\n");
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc >= 2 && strcmp(argv[1], "set") == 0) return set_golden(argc - 1, argv + 1);
+    if (argc >= 2 && strcmp(argv[1], "get") == 0) return get_golden(argc - 1, argv + 1);
+    if (argc >= 2 && strcmp(argv[1], "list") == 0) return list_golden(argc - 1, argv + 1);
+    if (argc == 2 && strcmp(argv[1], "measure") == 0) return measure_default();
+
+    fprintf(stderr, "Usage: %s set golden_db model version measurement_hex\n", argv[0]);
+    fprintf(stderr, "       %s get golden_db model version\n", argv[0]);
+    fprintf(stderr, "       %s list golden_db\n", argv[0]);
+    fprintf(stderr, "       %s measure\n", argv[0]);
+    return 1;
+}
@@ -0,0 +1,193 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "keycache.h"
+#include "timing.h"
+
+/*
+ * Per-device keys: Kauth and Kattest of device `id` are
+ *     PRK     = HKDF-Extract(KEYCACHE_SALT, master secret)
+ *     Kauth   = HKDF-Expand(PRK, "kauth"   || id (LE32))
+ *     Kattest = HKDF-Expand(PRK, "kattest" || id (LE32))
+ * so a verifier needs only the master secret, and a leaked device key says
+ * nothing about other devices. Deriving costs two HMACs plus four key
+ * schedules for the precomputed contexts; the cache keeps the result for
+ * devices that attest often.
+ */
+
+/**
+ * Derive the pseudorandom key all device keys are expanded from.
+ *
+ * @param prk Receives the precomputed PRK
+ * @param master Master secret
+ * @param master_len Master secret length
+ */
+void keycache_root(mac_key_t *prk, const uint8_t *master, size_t master_len) {
+    mac_hkdf_extract((const uint8_t *)KEYCACHE_SALT, sizeof(KEYCACHE_SALT) - 1, master, master_len, prk);
+}
+
+static void expand_key(const mac_key_t *prk, const char *label, uint32_t device_id, uint8_t *key) {
+    uint8_t info[16];
+    size_t len = strlen(label);
+    memcpy(info, label, len);
+    info[len] = (uint8_t)device_id;
+    info[len + 1] = (uint8_t)(device_id >> 8);
+    info[len + 2] = (uint8_t)(device_id >> 16);
+    info[len + 3] = (uint8_t)(device_id >> 24);
+    mac_hkdf_expand(prk, info, len + 4, key);
+}
+
+/**
+ * Derive one device's key pair, contexts included.
+ *
+ * @param prk PRK from keycache_root
+ * @param device_id Device identifier
+ * @param keys Receives the device's keys
+ */
+void keycache_derive(const mac_key_t *prk, uint32_t device_id, mv_keys_t *keys) {
+    uint8_t kauth[MV_KEY_SIZE], kattest[MV_KEY_SIZE];
+    expand_key(prk, "kauth", device_id, kauth);
+    expand_key(prk, "kattest", device_id, kattest);
+    mv_keys_init(keys, kauth, kattest);
+    memset(kauth, 0, sizeof(kauth));
+    memset(kattest, 0, sizeof(kattest));
+}
+
+static size_t slot_of(const keycache_t *c, uint32_t device_id) {
+    return (size_t)((device_id * 0x9E3779B97F4A7C15ull) >> 32) & c->index_mask;
+}
+
+/**
+ * Remove a device from the index. Later entries of its probe run are shifted
+ * back (no tombstones), so lookups stay short under constant churn.
+ */
+static void index_remove(keycache_t *c, uint32_t device_id) {
+    size_t i = slot_of(c, device_id);
+    while (c->entries[c->index[i]].device_id != device_id) i = (i + 1) & c->index_mask;
+
+    size_t hole = i;
+    for (i = (i + 1) & c->index_mask; c->index[i] != -1; i = (i + 1) & c->index_mask) {
+        size_t home = slot_of(c, c->entries[c->index[i]].device_id);
+        // Move the entry into the hole unless its home lies cyclically in (hole, i]
+        if (((i - home) & c->index_mask) >= ((i - hole) & c->index_mask)) {
+            c->index[hole] = c->index[i];
+            hole = i;
+        }
+    }
+    c->index[hole] = -1;
+}
+
+static int alloc_cache(keycache_t *c, size_t capacity) {
+    memset(c, 0, sizeof(*c));
+    if (capacity == 0) capacity = 1;
+
+    size_t index_size = 2;
+    while (index_size < 2 * capacity) index_size <<= 1; // Load factor <= 1/2
+    if (secarena_create(&c->arena, sizeof(mac_key_t) + capacity * sizeof(keycache_entry_t) + 64) == -1) return -1;
+    c->prk = secarena_alloc(&c->arena, sizeof(mac_key_t), 64);
+    c->entries = secarena_alloc(&c->arena, capacity * sizeof(keycache_entry_t), 64);
+    c->index = malloc(index_size * sizeof(int32_t)); // Device IDs only: ordinary memory
+    if (!c->entries || !c->index) {
+        keycache_free(c);
+        return -1;
+    }
+    memset(c->index, 0xff, index_size * sizeof(int32_t));
+    c->capacity = capacity;
+    c->index_mask = index_size - 1;
+    return 0;
+}
+
+/**
+ * Set up an empty cache of keys derived from a master secret.
+ *
+ * @param c Cache to initialize
+ * @param master Master secret
+ * @param master_len Master secret length
+ * @param capacity Number of devices kept
+ * @return 0 on success, -1 if memory could not be allocated
+ */
+int keycache_init(keycache_t *c, const uint8_t *master, size_t master_len, size_t capacity) {
+    if (alloc_cache(c, capacity) == -1) return -1;
+    keycache_root(c->prk, master, master_len);
+    return 0;
+}
+
+/**
+ * Set up an empty cache in front of a keystore. Misses read the device's
+ * keys from the store and precompute their HMAC contexts.
+ *
+ * @param c Cache to initialize
+ * @param store Open keystore; it must outlive the cache
+ * @param capacity Number of devices kept
+ * @return 0 on success, -1 if memory could not be allocated
+ */
+int keycache_init_store(keycache_t *c, const keystore_t *store, size_t capacity) {
+    if (alloc_cache(c, capacity) == -1) return -1;
+    c->store = store;
+    return 0;
+}
+
+/**
+ * Look up a device's keys, deriving or loading them on a miss. The returned
+ * keys stay valid until the next keycache_get on the same cache.
+ *
+ * @param c Cache
+ * @param device_id Device identifier
+ * @return Keys of the device, or NULL if the keystore does not know it
+ */
+const mv_keys_t *keycache_get(keycache_t *c, uint32_t device_id) {
+    size_t i = slot_of(c, device_id);
+    for (; c->index[i] != -1; i = (i + 1) & c->index_mask) {
+        keycache_entry_t *e = &c->entries[c->index[i]];
+        if (e->device_id == device_id) {
+            e->referenced = 1;
+            c->hits++;
+            return &e->keys;
+        }
+    }
+
+    uint8_t kauth[MV_KEY_SIZE], kattest[MV_KEY_SIZE];
+    uint64_t t0 = timing_now_ns();
+    if (c->store && keystore_lookup(c->store, device_id, kauth, kattest) == -1) return NULL;
+
+    // Miss: the hand sweeps past referenced entries (clearing their bit) to a victim
+    keycache_entry_t *victim;
+    for (;;) {
+        victim = &c->entries[c->hand];
+        c->hand = (c->hand + 1) % c->capacity;
+        if (!victim->valid || !victim->referenced) break;
+        victim->referenced = 0;
+    }
+    if (victim->valid) {
+        index_remove(c, victim->device_id);
+        i = slot_of(c, device_id); // The removal may have shifted the run
+        while (c->index[i] != -1) i = (i + 1) & c->index_mask;
+    }
+
+    if (c->store) {
+        mv_keys_init(&victim->keys, kauth, kattest);
+        memset(kauth, 0, sizeof(kauth));
+        memset(kattest, 0, sizeof(kattest));
+    } else {
+        keycache_derive(c->prk, device_id, &victim->keys);
+    }
+    c->derive_ns += timing_now_ns() - t0;
+    c->misses++;
+
+    victim->device_id = device_id;
+    victim->valid = 1;
+    victim->referenced = 0;
+    c->index[i] = (int32_t)(victim - c->entries);
+    return &victim->keys;
+}
+
+/**
+ * Release the cache and wipe the derived keys.
+ *
+ * @param c Cache from keycache_init
+ */
+void keycache_free(keycache_t *c) {
+    secarena_destroy(&c->arena);
+    free(c->index);
+    memset(c, 0, sizeof(*c));
+}
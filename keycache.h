@@ -0,0 +1,48 @@
+#ifndef KEYCACHE_H
+#define KEYCACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "keystore.h"
+#include "mac.h"
+#include "microvisor.h"
+#include "secarena.h"
+
+#define KEYCACHE_SALT "SIMPLE device keys v1" // HKDF salt: domain of the derivation
+
+// One cached device: its derived keys with HMAC contexts ready to use
+typedef struct {
+    uint32_t device_id;
+    uint8_t valid;
+    uint8_t referenced;   // CLOCK bit: used since the hand last passed
+    mv_keys_t keys;
+} keycache_entry_t;
+
+// Verifier-side cache of per-device keys, derived from a master secret or
+// read from a keystore. The PRK and all entries share one locked arena, so
+// the precomputed contexts are contiguous and never paged out.
+// Replacement is CLOCK (second chance): a hit only sets a bit, so lookups
+// never reorder anything. Not thread-safe; use one cache per thread.
+typedef struct {
+    secarena_t arena;             // Holds prk and entries
+    mac_key_t *prk;               // HKDF-Extract(salt, master secret)
+    const keystore_t *store;      // Source of keys on a miss; NULL: derive from prk
+    keycache_entry_t *entries;    // capacity slots
+    int32_t *index;               // Open addressing: device_id -> slot, -1 empty
+    size_t capacity;
+    size_t index_mask;
+    size_t hand;                  // CLOCK hand
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t derive_ns;           // Time spent deriving (or loading) keys on misses
+} keycache_t;
+
+// Function prototypes
+void keycache_root(mac_key_t *prk, const uint8_t *master, size_t master_len);
+void keycache_derive(const mac_key_t *prk, uint32_t device_id, mv_keys_t *keys);
+int keycache_init(keycache_t *c, const uint8_t *master, size_t master_len, size_t capacity);
+int keycache_init_store(keycache_t *c, const keystore_t *store, size_t capacity);
+const mv_keys_t *keycache_get(keycache_t *c, uint32_t device_id);
+void keycache_free(keycache_t *c);
+
+#endif // KEYCACHE_H
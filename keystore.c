@@ -0,0 +1,229 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "keystore.h"
+
+static uint32_t get_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void put_le32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t slot_of(uint32_t device_id, uint32_t mask) {
+    return (uint32_t)((device_id * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+}
+
+/**
+ * Load a cryptographic key from a file.
+ * This function reads a 32-byte key from a specified binary file into memory.
+ *
+ * @param key Pointer to the buffer where the key will be stored.
+ * @param filename Path to the key file.
+ * @return 0 on success, -1 if the file is missing or too short
+ */
+int load_key_from_file(uint8_t *key, const char *filename) {
+    FILE *fp = fopen(filename, "rb"); // Open the key file in binary mode
+    if (!fp) {
+        perror("Error loading key");  // Print error message if file cannot be opened
+        return -1;
+    }
+    size_t n = fread(key, 1, KEYSTORE_KEY_SIZE, fp);  // Read the key into the provided buffer
+    fclose(fp);
+    if (n != KEYSTORE_KEY_SIZE) {
+        fprintf(stderr, "Error loading key: %s is shorter than %d bytes\n", filename, KEYSTORE_KEY_SIZE);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Use one key pair stored in two raw key files (the original kauth.key /
+ * kattest.key provisioning). Every device ID resolves to that pair.
+ *
+ * @param ks Keystore to initialize
+ * @param kauth_path File holding Kauth
+ * @param kattest_path File holding Kattest
+ */
+void keystore_open_files(keystore_t *ks, const char *kauth_path, const char *kattest_path) {
+    memset(ks, 0, sizeof(*ks));
+    ks->backend = KEYSTORE_FILES;
+    ks->kauth_path = kauth_path;
+    ks->kattest_path = kattest_path;
+}
+
+/**
+ * Map a fleet keystore file read-only. Only the header is validated and no
+ * record is touched, so opening costs the same for ten devices or a million;
+ * pages are faulted in by the lookups that need them.
+ *
+ * @param ks Keystore to initialize
+ * @param path Keystore file written by keystore_write
+ * @return 0 on success, -1 if the file cannot be mapped or is malformed
+ */
+int keystore_open(keystore_t *ks, const char *path) {
+    memset(ks, 0, sizeof(*ks));
+    ks->backend = KEYSTORE_MMAP;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        perror("[KEYSTORE] Failed to open keystore");
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < KEYSTORE_HEADER_SIZE) {
+        fprintf(stderr, "[KEYSTORE] %s: not a keystore\n", path);
+        close(fd);
+        return -1;
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // The mapping keeps the file open
+    if (map == MAP_FAILED) {
+        perror("[KEYSTORE] Failed to map keystore");
+        return -1;
+    }
+
+    const uint8_t *hdr = map;
+    uint32_t count = get_le32(hdr + 12);
+    uint32_t slots = get_le32(hdr + 16);
+    uint64_t expected = KEYSTORE_HEADER_SIZE + (uint64_t)slots * 4 + (uint64_t)count * KEYSTORE_RECORD_SIZE;
+    if (memcmp(hdr, KEYSTORE_MAGIC, 8) != 0 || get_le32(hdr + 8) != KEYSTORE_VERSION ||
+        slots == 0 || (slots & (slots - 1)) != 0 || slots <= count || expected != (uint64_t)st.st_size) {
+        fprintf(stderr, "[KEYSTORE] %s: bad header or size\n", path);
+        munmap(map, (size_t)st.st_size);
+        return -1;
+    }
+
+    ks->map = map;
+    ks->map_len = (size_t)st.st_size;
+    ks->index = ks->map + KEYSTORE_HEADER_SIZE;
+    ks->records = ks->index + (size_t)slots * 4;
+    ks->count = count;
+    ks->index_mask = slots - 1;
+    return 0;
+}
+
+/**
+ * Look up the key pair of a device. Nothing is allocated; a mapped keystore
+ * reads at most a few index slots and one record.
+ *
+ * @param ks Open keystore
+ * @param device_id Device identifier
+ * @param kauth Buffer receiving Kauth
+ * @param kattest Buffer receiving Kattest
+ * @return 0 on success, -1 if the device is unknown or its keys unreadable
+ */
+int keystore_lookup(const keystore_t *ks, uint32_t device_id, uint8_t *kauth, uint8_t *kattest) {
+    if (ks->backend == KEYSTORE_FILES) {
+        if (load_key_from_file(kauth, ks->kauth_path) == -1) return -1;
+        return load_key_from_file(kattest, ks->kattest_path);
+    }
+
+    // A well-formed index always has an empty slot (slots > count); the bound
+    // stops the probe on a corrupt one whose slots are all taken
+    uint32_t i = slot_of(device_id, ks->index_mask);
+    for (uint64_t probes = 0; probes <= ks->index_mask; probes++, i = (i + 1) & ks->index_mask) {
+        uint32_t ref = get_le32(ks->index + (size_t)i * 4);
+        if (ref == 0 || ref > ks->count) return -1;
+
+        const uint8_t *rec = ks->records + (size_t)(ref - 1) * KEYSTORE_RECORD_SIZE;
+        if (get_le32(rec) == device_id) {
+            memcpy(kauth, rec + 4, KEYSTORE_KEY_SIZE);
+            memcpy(kattest, rec + 4 + KEYSTORE_KEY_SIZE, KEYSTORE_KEY_SIZE);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Release a keystore.
+ *
+ * @param ks Keystore from keystore_open or keystore_open_files
+ */
+void keystore_close(keystore_t *ks) {
+    if (ks->backend == KEYSTORE_MMAP && ks->map) munmap((void *)ks->map, ks->map_len);
+    memset(ks, 0, sizeof(*ks));
+}
+
+/**
+ * Write a keystore file. The file is built under a temporary name, readable by
+ * its owner only, and synced before it is renamed into place, so a verifier
+ * never maps a half-written keystore, even after a crash.
+ *
+ * @param path Destination file
+ * @param device_ids count device IDs (no duplicates)
+ * @param kauth count * KEYSTORE_KEY_SIZE bytes of Kauth keys
+ * @param kattest count * KEYSTORE_KEY_SIZE bytes of Kattest keys
+ * @param count Number of devices
+ * @return 0 on success, -1 on error (duplicate ID, I/O failure)
+ */
+int keystore_write(const char *path, const uint32_t *device_ids, const uint8_t *kauth,
+                   const uint8_t *kattest, uint32_t count) {
+    uint32_t slots = 2;
+    while (slots < 2 * (uint64_t)count) slots <<= 1;
+    uint8_t *index = calloc(slots, 4);
+    if (!index) {
+        perror("[KEYSTORE] Failed to allocate index");
+        return -1;
+    }
+
+    for (uint32_t r = 0; r < count; r++) {
+        uint32_t i = slot_of(device_ids[r], slots - 1);
+        for (uint32_t ref; (ref = get_le32(index + (size_t)i * 4)) != 0; i = (i + 1) & (slots - 1)) {
+            if (device_ids[ref - 1] == device_ids[r]) {
+                fprintf(stderr, "[KEYSTORE] Duplicate device ID %u\n", device_ids[r]);
+                free(index);
+                return -1;
+            }
+        }
+        put_le32(index + (size_t)i * 4, r + 1);
+    }
+
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    unlink(tmp); // Left over from an interrupted write
+    int fd = open(tmp, O_WRONLY | O_CREAT | O_EXCL, 0600); // Holds every device's keys: owner only
+    FILE *fp = fd == -1 ? NULL : fdopen(fd, "wb");
+    if (!fp) {
+        perror("[KEYSTORE] Failed to create keystore");
+        if (fd != -1) {
+            close(fd);
+            unlink(tmp);
+        }
+        free(index);
+        return -1;
+    }
+
+    uint8_t hdr[KEYSTORE_HEADER_SIZE] = {0};
+    memcpy(hdr, KEYSTORE_MAGIC, 8);
+    put_le32(hdr + 8, KEYSTORE_VERSION);
+    put_le32(hdr + 12, count);
+    put_le32(hdr + 16, slots);
+    int ok = fwrite(hdr, sizeof(hdr), 1, fp) == 1 && fwrite(index, 4, slots, fp) == slots;
+    for (uint32_t r = 0; ok && r < count; r++) {
+        uint8_t rec[KEYSTORE_RECORD_SIZE];
+        put_le32(rec, device_ids[r]);
+        memcpy(rec + 4, kauth + (size_t)r * KEYSTORE_KEY_SIZE, KEYSTORE_KEY_SIZE);
+        memcpy(rec + 4 + KEYSTORE_KEY_SIZE, kattest + (size_t)r * KEYSTORE_KEY_SIZE, KEYSTORE_KEY_SIZE);
+        ok = fwrite(rec, sizeof(rec), 1, fp) == 1;
+    }
+    free(index);
+    if (fflush(fp) != 0 || fsync(fileno(fp)) != 0) ok = 0;
+    if (fclose(fp) != 0) ok = 0;
+    if (!ok || rename(tmp, path) == -1) {
+        perror("[KEYSTORE] Failed to write keystore");
+        unlink(tmp);
+        return -1;
+    }
+    return 0;
+}
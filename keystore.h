@@ -0,0 +1,51 @@
+#ifndef KEYSTORE_H
+#define KEYSTORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define KEYSTORE_KEY_SIZE 32
+#define KEYSTORE_MAGIC "SIMPLEKS"     // First 8 bytes of a keystore file
+#define KEYSTORE_VERSION 1
+#define KEYSTORE_HEADER_SIZE 32
+#define KEYSTORE_RECORD_SIZE (4 + 2 * KEYSTORE_KEY_SIZE) // { device ID, Kauth, Kattest }
+
+/*
+ * Keystore file layout (all integers little-endian):
+ *   header   magic[8] | version u32 | record count u32 | index slots u32 | 12 reserved bytes
+ *   index    slots * u32: record number + 1, 0 = empty (open addressing, linear probing)
+ *   records  count * { device ID u32 | Kauth[32] | Kattest[32] }
+ * The index is sized to a power of two at least twice the record count, so
+ * a lookup touches one or two index slots and one record.
+ */
+
+// Where device keys come from
+typedef enum {
+    KEYSTORE_FILES,  // One key pair in two raw files, used for any device ID
+    KEYSTORE_MMAP,   // Fleet keystore file, mapped read-only
+} keystore_backend_t;
+
+typedef struct {
+    keystore_backend_t backend;
+    // KEYSTORE_FILES
+    const char *kauth_path;
+    const char *kattest_path;
+    // KEYSTORE_MMAP
+    const uint8_t *map;         // Whole file, PROT_READ
+    size_t map_len;
+    const uint8_t *index;
+    const uint8_t *records;
+    uint32_t count;
+    uint32_t index_mask;
+} keystore_t;
+
+// Function prototypes
+int load_key_from_file(uint8_t *key, const char *filename);
+void keystore_open_files(keystore_t *ks, const char *kauth_path, const char *kattest_path);
+int keystore_open(keystore_t *ks, const char *path);
+int keystore_lookup(const keystore_t *ks, uint32_t device_id, uint8_t *kauth, uint8_t *kattest);
+void keystore_close(keystore_t *ks);
+int keystore_write(const char *path, const uint32_t *device_ids, const uint8_t *kauth,
+                   const uint8_t *kattest, uint32_t count);
+
+#endif // KEYSTORE_H
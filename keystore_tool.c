@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/random.h>
+#include "keycache.h"
+#include "keystore.h"
+#include "microvisor.h"
+
+/**
+ * Creates a fleet keystore for device IDs 0..N-1. Keys are either derived
+ * from a master secret (the same keys -K gives the prover and verifier) or
+ * drawn at random.
+ */
+static int create_keystore(int argc, char **argv) {
+    const char *out = NULL, *master_file = NULL;
+    uint32_t count = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "o:n:K:")) != -1) {
+        if (opt == 'o') out = optarg;
+        else if (opt == 'n') count = (uint32_t)strtoul(optarg, NULL, 10);
+        else if (opt == 'K') master_file = optarg;
+        else count = 0;
+    }
+    if (!out || count == 0) {
+        fprintf(stderr, "Usage: keystore_tool create -o keystore_file -n devices [-K master_key_file]\n");
+        return -1;
+    }
+
+    uint32_t *ids = malloc(count * sizeof(uint32_t));
+    uint8_t *kauth = malloc((size_t)count * KEYSTORE_KEY_SIZE);
+    uint8_t *kattest = malloc((size_t)count * KEYSTORE_KEY_SIZE);
+    if (!ids || !kauth || !kattest) {
+        perror("[KEYSTORE] Failed to allocate keys");
+        return -1;
+    }
+
+    mac_key_t prk;
+    if (master_file) {
+        uint8_t master[MV_KEY_SIZE];
+        if (load_key_from_file(master, master_file) == -1) return -1;
+        keycache_root(&prk, master, sizeof(master));
+        memset(master, 0, sizeof(master));
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        ids[i] = i;
+        if (master_file) {
+            mv_keys_t keys;
+            keycache_derive(&prk, i, &keys);
+            memcpy(kauth + (size_t)i * KEYSTORE_KEY_SIZE, keys.kauth, KEYSTORE_KEY_SIZE);
+            memcpy(kattest + (size_t)i * KEYSTORE_KEY_SIZE, keys.kattest, KEYSTORE_KEY_SIZE);
+        } else if (getrandom(kauth + (size_t)i * KEYSTORE_KEY_SIZE, KEYSTORE_KEY_SIZE, 0) != KEYSTORE_KEY_SIZE ||
+                   getrandom(kattest + (size_t)i * KEYSTORE_KEY_SIZE, KEYSTORE_KEY_SIZE, 0) != KEYSTORE_KEY_SIZE) {
+            perror("[KEYSTORE] Failed to generate keys");
+            return -1;
+        }
+    }
+
+    int rc = keystore_write(out, ids, kauth, kattest, count);
+    if (rc == 0) printf("[KEYSTORE] Wrote %u devices to %s\n", count, out);
+    memset(kauth, 0, (size_t)count * KEYSTORE_KEY_SIZE);
+    memset(kattest, 0, (size_t)count * KEYSTORE_KEY_SIZE);
+    free(kattest);
+    free(kauth);
+    free(ids);
+    return rc;
+}
+
+/**
+ * Prints the keys of one device.
+ */
+static int lookup_keystore(int argc, char **argv) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: keystore_tool lookup keystore_file device_id\n");
+        return -1;
+    }
+    keystore_t store;
+    uint8_t kauth[KEYSTORE_KEY_SIZE], kattest[KEYSTORE_KEY_SIZE];
+    uint32_t device_id = (uint32_t)strtoul(argv[2], NULL, 10);
+    if (keystore_open(&store, argv[1]) == -1) return -1;
+
+    int rc = keystore_lookup(&store, device_id, kauth, kattest);
+    if (rc == 0) {
+        printf("[KEYSTORE] Device %u\n", device_id);
+        hex_dump("[KEYSTORE] Kauth", kauth, KEYSTORE_KEY_SIZE);
+        hex_dump("[KEYSTORE] Kattest", kattest, KEYSTORE_KEY_SIZE);
+    } else {
+        fprintf(stderr, "[KEYSTORE] Device %u not found\n", device_id);
+    }
+    keystore_close(&store);
+    return rc;
+}
+
+int main(int argc, char **argv) {
+    if (argc >= 2 && strcmp(argv[1], "create") == 0) return create_keystore(argc - 1, argv + 1);
+    if (argc >= 2 && strcmp(argv[1], "lookup") == 0) return lookup_keystore(argc - 1, argv + 1);
+
+    fprintf(stderr, "Usage: %s create -o keystore_file -n devices [-K master_key_file]\n", argv[0]);
+    fprintf(stderr, "       %s lookup keystore_file device_id\n", argv[0]);
+    return 1;
+}
@@ -0,0 +1,172 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include "linkemu.h"
+#include "timing.h"
+#include "uart.h"
+
+/*
+ * Emulated serial link between the verifier and the prover. A PTY delivers
+ * bytes as fast as they are written, whatever baud rate open_uart sets; the
+ * shim forwards them through link_emu_t instead, so they arrive at the
+ * configured bit rate, after the propagation delay and jitter, with bytes
+ * lost and bits flipped at the configured rates.
+ *
+ * Usage: ./link_shim [options]                 creates two PTYs and prints their names
+ *        ./link_shim [options] <verifier_dev> <prover_dev>
+ *                                              forwards between existing devices
+ */
+
+static volatile sig_atomic_t stop;
+
+static void on_signal(int sig) {
+    (void)sig;
+    stop = 1;
+}
+
+/**
+ * Creates a PTY in raw mode for one end of the link.
+ * The slave stays open so the master keeps working while no peer has it open.
+ *
+ * @param name Receives the slave's path
+ * @param slave_fd Receives the slave descriptor (keep it open)
+ * @return Master descriptor, or -1 on failure
+ */
+static int open_pty(char *name, size_t name_len, int *slave_fd) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master == -1 || grantpt(master) == -1 || unlockpt(master) == -1 ||
+        ptsname_r(master, name, name_len) != 0) {
+        perror("[LINK] Failed to create PTY");
+        return -1;
+    }
+    *slave_fd = open(name, O_RDWR | O_NOCTTY);
+    if (*slave_fd == -1) {
+        perror("[LINK] Failed to open PTY");
+        return -1;
+    }
+    struct termios raw;
+    tcgetattr(*slave_fd, &raw);
+    cfmakeraw(&raw);
+    tcsetattr(*slave_fd, TCSANOW, &raw);
+    fcntl(master, F_SETFL, O_NONBLOCK);
+    return master;
+}
+
+/**
+ * Moves bytes from one end into a link direction, as far as it has room.
+ */
+static void pump_in(int fd, link_emu_t *link, uint64_t now) {
+    uint8_t buf[256];
+    size_t space = link_emu_space(link);
+    if (space == 0) return;
+    ssize_t n = read(fd, buf, space < sizeof(buf) ? space : sizeof(buf));
+    if (n > 0) link_emu_send(link, buf, n, now);
+}
+
+/**
+ * Delivers the bytes of a link direction that have arrived.
+ */
+static void pump_out(int fd, link_emu_t *link, uint64_t now) {
+    uint8_t buf[256];
+    size_t n;
+    while ((n = link_emu_recv(link, buf, sizeof(buf), now)) > 0) safe_uart_write(fd, buf, n);
+}
+
+static void print_stats(const char *dir, const link_emu_t *link) {
+    printf("[LINK] %s: %llu bytes sent, %llu delivered, %llu lost, %llu with a flipped bit\n", dir,
+           (unsigned long long)link->sent, (unsigned long long)link->delivered,
+           (unsigned long long)link->lost, (unsigned long long)link->flipped);
+}
+
+int main(int argc, char **argv) {
+    link_model_t model;
+    link_model_default(&model);
+    int opt;
+    while ((opt = getopt(argc, argv, "b:B:d:j:l:e:s:")) != -1) {
+        if (opt == 'b') model.baud = (uint32_t)strtoul(optarg, NULL, 10);
+        else if (opt == 'B') model.frame_bits = (uint32_t)strtoul(optarg, NULL, 10);
+        else if (opt == 'd') model.delay_us = (uint32_t)strtoul(optarg, NULL, 10);
+        else if (opt == 'j') model.jitter_us = (uint32_t)strtoul(optarg, NULL, 10);
+        else if (opt == 'l') model.loss = strtod(optarg, NULL);
+        else if (opt == 'e') model.ber = strtod(optarg, NULL);
+        else if (opt == 's') model.seed = strtoull(optarg, NULL, 10);
+        else {
+            fprintf(stderr, "Usage: %s [-b baud] [-B bits_per_byte] [-d delay_us] [-j jitter_us] "
+                            "[-l byte_loss] [-e bit_error_rate] [-s seed] [verifier_dev prover_dev]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    int fds[2], slaves[2] = { -1, -1 };
+    if (argc - optind == 2) {
+        for (int i = 0; i < 2; i++) {
+            fds[i] = open_uart(argv[optind + i], "[LINK]");
+            if (fds[i] == -1) return 1;
+        }
+    } else {
+        char names[2][64];
+        for (int i = 0; i < 2; i++) {
+            fds[i] = open_pty(names[i], sizeof(names[i]), &slaves[i]);
+            if (fds[i] == -1) return 1;
+        }
+        printf("[LINK] Verifier side: %s, prover side: %s\n", names[0], names[1]);
+    }
+    printf("[LINK] %u baud, %u bits per byte, delay %uus + up to %uus jitter, byte loss %g, BER %g\n",
+           model.baud, model.frame_bits, model.delay_us, model.jitter_us, model.loss, model.ber);
+    fflush(stdout);
+
+    // links[0] carries verifier -> prover, links[1] prover -> verifier
+    static link_emu_t links[2];
+    link_emu_init(&links[0], &model);
+    model.seed = model.seed * 6364136223846793005ull + 1; // Independent errors per direction
+    link_emu_init(&links[1], &model);
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    while (!stop) {
+        uint64_t now = timing_now_ns();
+        pump_out(fds[1], &links[0], now);
+        pump_out(fds[0], &links[1], now);
+
+        // Sleep until a byte arrives on either side or is due at the far end
+        uint64_t due = link_emu_next_due(&links[0]);
+        if (link_emu_next_due(&links[1]) < due) due = link_emu_next_due(&links[1]);
+        // Nanosecond timeout: at 115200 baud a byte is due every ~87us, and a
+        // millisecond one would deliver them in late bursts
+        struct timespec timeout, *wait = NULL;
+        if (due != UINT64_MAX) {
+            now = timing_now_ns();
+            uint64_t left = due > now ? due - now : 0;
+            timeout.tv_sec = left / 1000000000ull;
+            timeout.tv_nsec = left % 1000000000ull;
+            wait = &timeout;
+        }
+        struct pollfd pfds[2];
+        for (int i = 0; i < 2; i++) {
+            pfds[i].fd = fds[i];
+            pfds[i].events = link_emu_space(&links[i]) ? POLLIN : 0; // Full: hold the sender back
+        }
+        if (ppoll(pfds, 2, wait, NULL) <= 0) continue;
+
+        now = timing_now_ns();
+        for (int i = 0; i < 2; i++) {
+            if (pfds[i].revents & POLLIN) pump_in(fds[i], &links[i], now);
+        }
+    }
+
+    print_stats("Verifier -> prover", &links[0]);
+    print_stats("Prover -> verifier", &links[1]);
+    for (int i = 0; i < 2; i++) {
+        close(fds[i]);
+        if (slaves[i] != -1) close(slaves[i]);
+    }
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include <stdint.h>
+#include <string.h>
+#include "linkemu.h"
+
+/**
+ * Fill in a model of a clean 115200 baud 8N1 UART: serialization delay only.
+ *
+ * @param model Model to initialize
+ */
+void link_model_default(link_model_t *model) {
+    memset(model, 0, sizeof(*model));
+    model->baud = 115200;
+    model->frame_bits = 10;
+    model->seed = 1;
+}
+
+/**
+ * Start one direction of an emulated link with nothing in flight.
+ *
+ * @param link Link direction
+ * @param model Timing and error model (copied)
+ */
+void link_emu_init(link_emu_t *link, const link_model_t *model) {
+    memset(link, 0, sizeof(*link));
+    link->model = *model;
+    link->rng = model->seed ? model->seed : 1;
+}
+
+static uint64_t link_rng(link_emu_t *link) {
+    link->rng ^= link->rng << 13;
+    link->rng ^= link->rng >> 7;
+    link->rng ^= link->rng << 17;
+    return link->rng;
+}
+
+// Uniform in [0, 1)
+static double link_uniform(link_emu_t *link) {
+    return (link_rng(link) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * Number of bytes link_emu_send accepts right now. The caller stops reading
+ * from its source when this is 0, like a UART with a full transmit buffer.
+ *
+ * @param link Link direction
+ * @return Free queue slots
+ */
+size_t link_emu_space(const link_emu_t *link) {
+    return LINKEMU_QUEUE - link->count;
+}
+
+/**
+ * Put bytes on the wire. Each byte occupies the transmitter for frame_bits
+ * bit times after the previous one, then arrives after the propagation delay
+ * plus jitter. Lost bytes still take their wire time; flipped bits are
+ * applied on the way.
+ *
+ * @param link Link direction
+ * @param data Bytes written by the sender
+ * @param len Number of bytes, at most link_emu_space()
+ * @param now_ns Time of the write
+ */
+void link_emu_send(link_emu_t *link, const uint8_t *data, size_t len, uint64_t now_ns) {
+    const link_model_t *m = &link->model;
+    uint64_t byte_ns = m->baud ? (uint64_t)m->frame_bits * 1000000000ull / m->baud : 0;
+
+    for (size_t i = 0; i < len && link->count < LINKEMU_QUEUE; i++) {
+        uint64_t start = link->wire_free_ns > now_ns ? link->wire_free_ns : now_ns;
+        link->wire_free_ns = start + byte_ns;
+        link->sent++;
+
+        if (m->loss > 0 && link_uniform(link) < m->loss) {
+            link->lost++;
+            continue;
+        }
+        uint8_t b = data[i];
+        if (m->ber > 0 && link_uniform(link) < 8 * m->ber) { // At most one flip per byte: fine for small BERs
+            b ^= (uint8_t)(1u << (link_rng(link) & 7));
+            link->flipped++;
+        }
+
+        uint64_t due = link->wire_free_ns + (uint64_t)m->delay_us * 1000;
+        if (m->jitter_us) due += link_rng(link) % ((uint64_t)m->jitter_us * 1000 + 1);
+        if (due < link->last_due_ns) due = link->last_due_ns; // A serial line never reorders
+        link->last_due_ns = due;
+
+        size_t tail = (link->head + link->count) % LINKEMU_QUEUE;
+        link->bytes[tail] = b;
+        link->due_ns[tail] = due;
+        link->count++;
+    }
+}
+
+/**
+ * Time the next queued byte arrives.
+ *
+ * @param link Link direction
+ * @return Arrival time in ns, or UINT64_MAX if nothing is in flight
+ */
+uint64_t link_emu_next_due(const link_emu_t *link) {
+    return link->count ? link->due_ns[link->head] : UINT64_MAX;
+}
+
+/**
+ * Take the bytes that have arrived by now_ns.
+ *
+ * @param link Link direction
+ * @param out Buffer receiving the bytes
+ * @param max Size of out
+ * @param now_ns Current time
+ * @return Number of bytes delivered
+ */
+size_t link_emu_recv(link_emu_t *link, uint8_t *out, size_t max, uint64_t now_ns) {
+    size_t n = 0;
+    while (n < max && link->count && link->due_ns[link->head] <= now_ns) {
+        out[n++] = link->bytes[link->head];
+        link->head = (link->head + 1) % LINKEMU_QUEUE;
+        link->count--;
+    }
+    link->delivered += n;
+    return n;
+}
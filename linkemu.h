@@ -0,0 +1,40 @@
+#ifndef LINKEMU_H
+#define LINKEMU_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define LINKEMU_QUEUE 4096 // Bytes in flight per direction (transmit buffer plus wire)
+
+// What one direction of the emulated serial link does to bytes
+typedef struct {
+    uint32_t baud;          // Bit rate (0: no serialization delay)
+    uint32_t frame_bits;    // Bits on the wire per byte: start + data + parity + stop (8N1: 10)
+    uint32_t delay_us;      // Propagation delay
+    uint32_t jitter_us;     // Extra delay, uniform in [0, jitter_us]; bytes are never reordered
+    double loss;            // Probability that a byte is lost
+    double ber;             // Bit error rate (probability that a data bit flips)
+    uint64_t seed;
+} link_model_t;
+
+// One direction of the link: bytes queued with the time they arrive
+typedef struct {
+    link_model_t model;
+    uint8_t bytes[LINKEMU_QUEUE];
+    uint64_t due_ns[LINKEMU_QUEUE];
+    size_t head, count;
+    uint64_t wire_free_ns;     // When the transmitter finishes the byte in progress
+    uint64_t last_due_ns;      // Arrival of the newest queued byte
+    uint64_t rng;
+    uint64_t sent, delivered, lost, flipped;
+} link_emu_t;
+
+// Function prototypes
+void link_model_default(link_model_t *model);
+void link_emu_init(link_emu_t *link, const link_model_t *model);
+size_t link_emu_space(const link_emu_t *link);
+void link_emu_send(link_emu_t *link, const uint8_t *data, size_t len, uint64_t now_ns);
+uint64_t link_emu_next_due(const link_emu_t *link);
+size_t link_emu_recv(link_emu_t *link, uint8_t *out, size_t max, uint64_t now_ns);
+
+#endif // LINKEMU_H
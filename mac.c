@@ -0,0 +1,132 @@
+#include <stdint.h>
+#include <string.h>
+#include "mac.h"
+
+#define MAC_BLOCK_SIZE 64         // SHA-256 block size
+#define MAC_HKDF_MAX_INFO 64      // Longest HKDF info label supported
+
+/**
+ * Precompute an HMAC-SHA256 key (RFC 2104): absorb key ^ ipad and key ^ opad
+ * once, so every MAC computed with it costs only the message blocks.
+ *
+ * @param k Key to initialize
+ * @param key Raw key bytes
+ * @param key_len Length of the key (longer than a block: hashed first)
+ */
+void mac_key_init(mac_key_t *k, const uint8_t *key, size_t key_len) {
+    uint8_t block[MAC_BLOCK_SIZE] = {0};
+    uint8_t pad[MAC_BLOCK_SIZE];
+
+    if (key_len > MAC_BLOCK_SIZE) {
+        SHA256(key, key_len, block);
+    } else {
+        memcpy(block, key, key_len);
+    }
+
+    for (size_t i = 0; i < MAC_BLOCK_SIZE; i++) pad[i] = block[i] ^ 0x36;
+    SHA256_Init(&k->inner);
+    SHA256_Update(&k->inner, pad, MAC_BLOCK_SIZE);
+
+    for (size_t i = 0; i < MAC_BLOCK_SIZE; i++) pad[i] = block[i] ^ 0x5c;
+    SHA256_Init(&k->outer);
+    SHA256_Update(&k->outer, pad, MAC_BLOCK_SIZE);
+
+    memset(block, 0, sizeof(block));
+    memset(pad, 0, sizeof(pad));
+}
+
+/**
+ * Compute HMAC-SHA256 of a message with a precomputed key.
+ * The key is not modified, so one key can serve any number of callers.
+ *
+ * @param k Key from mac_key_init
+ * @param msg Message
+ * @param len Message length
+ * @param out Buffer receiving MAC_SIZE bytes
+ */
+void mac_compute(const mac_key_t *k, const uint8_t *msg, size_t len, uint8_t *out) {
+    SHA256_CTX ctx = k->inner;
+    uint8_t inner_digest[MAC_SIZE];
+
+    SHA256_Update(&ctx, msg, len);
+    SHA256_Final(inner_digest, &ctx);
+
+    ctx = k->outer;
+    SHA256_Update(&ctx, inner_digest, MAC_SIZE);
+    SHA256_Final(out, &ctx);
+    memset(&ctx, 0, sizeof(ctx));
+}
+
+/**
+ * Compute HMAC(msg) and HMAC(msg || label) in one pass. The inner hash of
+ * the shared message is computed once and forked before the label, so the
+ * second, domain-separated MAC costs only the label and the finalization.
+ *
+ * @param k Key from mac_key_init
+ * @param msg Shared message
+ * @param len Message length
+ * @param label Domain-separation label appended for the second MAC
+ * @param label_len Label length
+ * @param out Receives HMAC(msg), MAC_SIZE bytes
+ * @param out_labeled Receives HMAC(msg || label), MAC_SIZE bytes
+ */
+void mac_compute_pair(const mac_key_t *k, const uint8_t *msg, size_t len, const uint8_t *label, size_t label_len,
+                      uint8_t *out, uint8_t *out_labeled) {
+    SHA256_CTX ctx = k->inner, labeled;
+    uint8_t inner_digest[MAC_SIZE];
+
+    SHA256_Update(&ctx, msg, len);
+    labeled = ctx; // Fork after the shared message
+
+    SHA256_Final(inner_digest, &ctx);
+    ctx = k->outer;
+    SHA256_Update(&ctx, inner_digest, MAC_SIZE);
+    SHA256_Final(out, &ctx);
+
+    SHA256_Update(&labeled, label, label_len);
+    SHA256_Final(inner_digest, &labeled);
+    ctx = k->outer;
+    SHA256_Update(&ctx, inner_digest, MAC_SIZE);
+    SHA256_Final(out_labeled, &ctx);
+    memset(&ctx, 0, sizeof(ctx));
+    memset(&labeled, 0, sizeof(labeled));
+}
+
+/**
+ * HKDF-Extract (RFC 5869): PRK = HMAC(salt, IKM), returned as a precomputed
+ * key so that every later expansion skips the PRK key schedule.
+ *
+ * @param salt Salt (may be empty)
+ * @param salt_len Salt length
+ * @param ikm Input keying material (e.g. a master secret)
+ * @param ikm_len IKM length
+ * @param prk Receives the pseudorandom key
+ */
+void mac_hkdf_extract(const uint8_t *salt, size_t salt_len, const uint8_t *ikm, size_t ikm_len, mac_key_t *prk) {
+    mac_key_t salt_key;
+    uint8_t raw[MAC_SIZE];
+
+    mac_key_init(&salt_key, salt, salt_len);
+    mac_compute(&salt_key, ikm, ikm_len, raw);
+    mac_key_init(prk, raw, MAC_SIZE);
+
+    memset(&salt_key, 0, sizeof(salt_key));
+    memset(raw, 0, sizeof(raw));
+}
+
+/**
+ * HKDF-Expand (RFC 5869) for a single output block: OKM = HMAC(PRK, info || 0x01).
+ *
+ * @param prk Pseudorandom key from mac_hkdf_extract
+ * @param info Context label binding the output to its use
+ * @param info_len Label length (at most MAC_HKDF_MAX_INFO)
+ * @param okm Buffer receiving MAC_SIZE bytes
+ */
+void mac_hkdf_expand(const mac_key_t *prk, const uint8_t *info, size_t info_len, uint8_t *okm) {
+    uint8_t input[MAC_HKDF_MAX_INFO + 1];
+    if (info_len > MAC_HKDF_MAX_INFO) info_len = MAC_HKDF_MAX_INFO;
+
+    memcpy(input, info, info_len);
+    input[info_len] = 0x01; // Block counter T(1)
+    mac_compute(prk, input, info_len + 1, okm);
+}
@@ -0,0 +1,26 @@
+#ifndef MAC_H
+#define MAC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <openssl/sha.h>
+
+#define MAC_SIZE 32  // HMAC-SHA256 output size in bytes
+
+// HMAC-SHA256 key with the ipad/opad blocks already absorbed. Computing a MAC
+// from it skips the two key compressions HMAC() redoes on every call, and a
+// copy of the struct is all another context needs to use the same key.
+typedef struct {
+    SHA256_CTX inner;  // State after hashing key ^ ipad
+    SHA256_CTX outer;  // State after hashing key ^ opad
+} mac_key_t;
+
+// Function prototypes
+void mac_key_init(mac_key_t *k, const uint8_t *key, size_t key_len);
+void mac_compute(const mac_key_t *k, const uint8_t *msg, size_t len, uint8_t *out);
+void mac_compute_pair(const mac_key_t *k, const uint8_t *msg, size_t len, const uint8_t *label, size_t label_len,
+                      uint8_t *out, uint8_t *out_labeled);
+void mac_hkdf_extract(const uint8_t *salt, size_t salt_len, const uint8_t *ikm, size_t ikm_len, mac_key_t *prk);
+void mac_hkdf_expand(const mac_key_t *prk, const uint8_t *info, size_t info_len, uint8_t *okm);
+
+#endif // MAC_H
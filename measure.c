@@ -0,0 +1,76 @@
+#include <stdint.h>
+#include <string.h>
+#include "measure.h"
+
+/**
+ * Start a new measurement over a list of memory regions.
+ * The region table must stay valid until the measurement completes.
+ *
+ * @param ctx Measurement state to (re)initialize
+ * @param regions Regions to hash, in order
+ * @param nregions Number of regions
+ */
+void measure_begin(measure_ctx_t *ctx, measure_region_t *regions, size_t nregions) {
+    SHA256_Init(&ctx->sha);
+    ctx->regions = regions;
+    ctx->nregions = nregions;
+    ctx->region = 0;
+    ctx->offset = 0;
+    ctx->hashed = 0;
+    ctx->active = 1;
+}
+
+/**
+ * Hash at most max_bytes more of the measured regions.
+ * Each call does a bounded amount of work and returns, so the caller can
+ * interleave the measurement with time-critical tasks. Regions with a cached
+ * digest cost nothing against the budget.
+ *
+ * @param ctx Measurement in progress
+ * @param max_bytes Upper bound on bytes hashed in this slice
+ * @return 1 once every region has been hashed, 0 if more slices are needed
+ */
+int measure_step(measure_ctx_t *ctx, size_t max_bytes) {
+    while (ctx->region < ctx->nregions) {
+        measure_region_t *r = &ctx->regions[ctx->region];
+
+        if (r->cached) { // Contents known unchanged: reuse the digest
+            SHA256_Update(&ctx->sha, r->digest, MEASURE_DIGEST_SIZE);
+            ctx->region++;
+            continue;
+        }
+        if (max_bytes == 0) break;
+
+        if (ctx->offset == 0) SHA256_Init(&ctx->region_sha);
+        size_t chunk = r->len - ctx->offset;
+        if (chunk > max_bytes) chunk = max_bytes;
+
+        SHA256_Update(&ctx->region_sha, r->base + ctx->offset, chunk);
+        ctx->offset += chunk;
+        ctx->hashed += chunk;
+        max_bytes -= chunk;
+
+        if (ctx->offset == r->len) { // Region done, move on to the next one
+            SHA256_Final(r->digest, &ctx->region_sha);
+            SHA256_Update(&ctx->sha, r->digest, MEASURE_DIGEST_SIZE);
+            r->cached = r->cacheable;
+            ctx->region++;
+            ctx->offset = 0;
+        }
+    }
+    return ctx->region == ctx->nregions;
+}
+
+/**
+ * Finish a completed measurement and output the digest.
+ * The hash state is wiped afterwards.
+ *
+ * @param ctx Measurement for which measure_step returned 1
+ * @param digest Buffer receiving MEASURE_DIGEST_SIZE bytes
+ */
+void measure_finish(measure_ctx_t *ctx, uint8_t *digest) {
+    SHA256_Final(digest, &ctx->sha);
+    memset(&ctx->sha, 0, sizeof(ctx->sha));
+    memset(&ctx->region_sha, 0, sizeof(ctx->region_sha));
+    ctx->active = 0;
+}
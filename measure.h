@@ -0,0 +1,40 @@
+#ifndef MEASURE_H
+#define MEASURE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <openssl/sha.h>
+
+#define MEASURE_DIGEST_SIZE 32        // SHA-256 digest size in bytes
+#define MEASURE_SLICE_BYTES 4096      // Default bytes hashed per scheduler slice
+
+// A contiguous memory range covered by the software measurement. Each region
+// is hashed on its own; the measurement is the hash of the region digests, so
+// a region whose contents are known to be unchanged can reuse its digest.
+typedef struct {
+    const uint8_t *base;
+    size_t len;
+    uint8_t digest[MEASURE_DIGEST_SIZE]; // Last digest of the region
+    int cacheable;                       // Owner revalidates the region: keep its digest
+    int cached;                          // digest is current, skip hashing
+} measure_region_t;
+
+// Resumable measurement state. Plain data only, so it can be placed in the
+// secure region and survive between slices without any heap allocation.
+typedef struct {
+    SHA256_CTX sha;                   // Running digest over the region digests
+    SHA256_CTX region_sha;            // Digest of the region being hashed
+    measure_region_t *regions;        // Regions to measure, in order
+    size_t nregions;
+    size_t region;                    // Index of the region being hashed
+    size_t offset;                    // Bytes of that region already hashed
+    size_t hashed;                    // Bytes actually hashed (cache misses)
+    int active;                       // 1 between measure_begin and completion
+} measure_ctx_t;
+
+// Function prototypes
+void measure_begin(measure_ctx_t *ctx, measure_region_t *regions, size_t nregions);
+int measure_step(measure_ctx_t *ctx, size_t max_bytes);
+void measure_finish(measure_ctx_t *ctx, uint8_t *digest);
+
+#endif // MEASURE_H
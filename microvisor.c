@@ -1,79 +1,669 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
+#include <sched.h>
 #include "microvisor.h"
-#include <openssl/hmac.h>
+#include "selfmeasure.h"
+#include "snapshot.h"
+#include "timing.h"
 
-#define KEY_SIZE 32  // Size of cryptographic keys in bytes
-#define OUTPUT_SIZE 32  // HMAC-SHA256 output size in bytes
-#define SOFTWARE_CODE "ExampleFirmwareV1"  // Dummy software representation
+// An entry point being timed; the cleanup attribute records it on every return path
+typedef struct {
+    mv_call_stats_t *stats;
+    uint64_t start;
+} mv_call_timer_t;
 
-// Securely store keys in `.secure_data` section to prevent unauthorized access
-__attribute__((section(".secure_data"))) volatile uint8_t Kauth[KEY_SIZE];   // Authentication key
-__attribute__((section(".secure_data"))) volatile uint8_t Kattest[KEY_SIZE]; // Attestation key
+static inline void mv_call_exit(mv_call_timer_t *t) {
+    uint64_t cycles = timing_cycles() - t->start;
+    atomic_fetch_add_explicit(&t->stats->calls, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&t->stats->cycles, cycles, memory_order_relaxed);
+    uint64_t max = atomic_load_explicit(&t->stats->max_cycles, memory_order_relaxed);
+    while (cycles > max && !atomic_compare_exchange_weak_explicit(&t->stats->max_cycles, &max, cycles,
+                                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+#ifndef MV_NO_CALL_STATS
+#define MV_ENTRY(mv, call) \
+    mv_call_timer_t mv_call_timer __attribute__((cleanup(mv_call_exit))) = { &(mv)->calls[call], timing_cycles() }
+#else
+#define MV_ENTRY(mv, call) (void)(mv)
+#endif
+
+static const char *const call_names[MV_CALL_COUNT] = {
+    [MV_CALL_GET_SECURE_KEY] = "get_secure_key",
+    [MV_CALL_KEYS_GET] = "microvisor_keys_get",
+    [MV_CALL_KEYS_PUT] = "microvisor_keys_put",
+    [MV_CALL_MAC] = "microvisor_mac",
+    [MV_CALL_MAC_WITH] = "microvisor_mac_with",
+    [MV_CALL_MAC_PAIR_WITH] = "microvisor_mac_pair_with",
+    [MV_CALL_BIND_STATE] = "bind_software_measurement",
+    [MV_CALL_REBIND_STATE] = "microvisor_rebind_state",
+    [MV_CALL_GET_CACHED_STATE] = "get_cached_software_state",
+    [MV_CALL_COMPUTE_MEASUREMENT] = "compute_software_measurement",
+    [MV_CALL_COMPUTE_STATE] = "compute_valid_software_state",
+    [MV_CALL_SET_REGIONS] = "set_measured_regions",
+    [MV_CALL_USE_SELF_MEASUREMENT] = "use_self_measurement",
+    [MV_CALL_START_MEASUREMENT] = "start_software_measurement",
+    [MV_CALL_STEP_MEASUREMENT] = "step_software_measurement",
+    [MV_CALL_FINISH_MEASUREMENT] = "finish_software_measurement",
+    [MV_CALL_MEASUREMENT_STARTED] = "software_measurement_started",
+    [MV_CALL_START_SNAPSHOT] = "start_snapshot_measurement",
+    [MV_CALL_POLL_SNAPSHOT] = "poll_snapshot_measurement",
+    [MV_CALL_CANCEL_SNAPSHOT] = "cancel_snapshot_measurement",
+    [MV_CALL_SET_KEYS] = "microvisor_set_keys",
+    [MV_CALL_USE_KEYS] = "microvisor_use_keys",
+    [MV_CALL_ROTATE_KEYS] = "microvisor_rotate_keys",
+    [MV_CALL_LOAD_KEYS] = "microvisor_load_keys",
+    [MV_CALL_INITIALIZE_KEYS] = "initialize_keys",
+};
+
+/**
+ * Retrieve a securely stored key (either Kauth or Kattest).
+ * The function copies the selected key into the provided output buffer.
+ *
+ * @param mv Microvisor holding the keys
+ * @param key_out Pointer to the buffer where the key will be copied.
+ * @param key_type MV_KEY_AUTH for Kauth (authentication), MV_KEY_ATTEST for Kattest (attestation).
+ */
+void get_secure_key(microvisor_t *mv, uint8_t *key_out, uint8_t key_type) {
+    MV_ENTRY(mv, MV_CALL_GET_SECURE_KEY);
+    mv_keys_ref_t ref;
+    microvisor_keys_get(mv, MV_KEYS_CURRENT, &ref);
+    if (key_type == MV_KEY_AUTH) {
+        memcpy(key_out, ref.keys->kauth, MV_KEY_SIZE);  // Retrieve authentication key
+        if (mv->verbose) hex_dump("[MICROVISOR] Kauth Retrieved", key_out, MV_KEY_SIZE);
+    } else if (key_type == MV_KEY_ATTEST) {
+        memcpy(key_out, ref.keys->kattest, MV_KEY_SIZE);  // Retrieve attestation key
+        if (mv->verbose) hex_dump("[MICROVISOR] Kattest Retrieved", key_out, MV_KEY_SIZE);
+    }
+    microvisor_keys_put(mv, &ref);
+}
 
 /**
- * Load a cryptographic key from a file.
- * This function reads a 32-byte key from a specified binary file into memory.
+ * Pin the current or previous keys for use. Takes no lock: the reader only
+ * announces itself, so a concurrent rotation never blocks it and the slot is
+ * not reused until it is released with microvisor_keys_put.
  *
- * @param key Pointer to the buffer where the key will be stored.
- * @param filename Path to the key file.
+ * @param mv Microvisor holding the keys
+ * @param which MV_KEYS_CURRENT, or MV_KEYS_PREVIOUS for the keys replaced by
+ *              the last rotation while its grace period lasts
+ * @param ref Receives the pinned keys
+ * @return 0 on success, -1 if there are no such keys (nothing is pinned)
  */
-void load_key_from_file(uint8_t *key, const char *filename) {
-    FILE *fp = fopen(filename, "rb"); // Open the key file in binary mode
-    if (fp) {
-        fread(key, 1, KEY_SIZE, fp);  // Read the key into the provided buffer
-        fclose(fp);
+int microvisor_keys_get(microvisor_t *mv, int which, mv_keys_ref_t *ref) {
+    MV_ENTRY(mv, MV_CALL_KEYS_GET);
+    mv_keyring_t *ring = &mv->keys;
+    ref->phase = atomic_load(&ring->phase) & 1;
+    atomic_fetch_add(&ring->readers[ref->phase], 1);
+
+    mv_keys_t *keys = atomic_load(which == MV_KEYS_CURRENT ? &ring->current : &ring->previous);
+    if (keys && which == MV_KEYS_PREVIOUS &&
+        timing_now_ns() >= atomic_load(&ring->expires_ns[keys - ring->slots])) {
+        keys = NULL; // Grace period over
+    }
+    if (!keys) {
+        atomic_fetch_sub(&ring->readers[ref->phase], 1);
+        return -1;
+    }
+    ref->keys = keys;
+    return 0;
+}
+
+/**
+ * Release keys pinned by microvisor_keys_get.
+ *
+ * @param mv Microvisor holding the keys
+ * @param ref Pinned keys; unusable afterwards
+ */
+void microvisor_keys_put(microvisor_t *mv, mv_keys_ref_t *ref) {
+    MV_ENTRY(mv, MV_CALL_KEYS_PUT);
+    atomic_fetch_sub(&mv->keys.readers[ref->phase], 1);
+    ref->keys = NULL;
+}
+
+/**
+ * Wait until every reader that might still use an unpublished slot is gone.
+ * Flips the phase twice so that a reader announcing itself in the old
+ * counter while it is drained is waited for as well.
+ *
+ * @param ring Key ring of the writer
+ */
+static void keys_synchronize(mv_keyring_t *ring) {
+    for (int i = 0; i < 2; i++) {
+        uint32_t old = atomic_fetch_add(&ring->phase, 1) & 1;
+        while (atomic_load(&ring->readers[old]) != 0) sched_yield();
+    }
+}
+
+/**
+ * Find a slot that is neither current nor previous and wait until no reader
+ * holds it any more, so that the writer may fill it in.
+ *
+ * @param ring Key ring of the writer
+ * @return Free slot
+ */
+static mv_keys_t *keys_prepare(mv_keyring_t *ring) {
+    mv_keys_t *current = atomic_load(&ring->current);
+    mv_keys_t *previous = atomic_load(&ring->previous);
+    mv_keys_t *slot = ring->slots;
+    while (slot == current || slot == previous) slot++;
+    keys_synchronize(ring);
+    return slot;
+}
+
+/**
+ * Make a prepared slot the current keys. The keys it replaces stay
+ * acceptable as previous keys for grace_ms.
+ *
+ * @param ring Key ring of the writer
+ * @param slot Slot filled in after keys_prepare
+ * @param grace_ms Grace period of the replaced keys (0: drop them now)
+ */
+static void keys_publish(mv_keyring_t *ring, mv_keys_t *slot, uint32_t grace_ms) {
+    mv_keys_t *old = atomic_load(&ring->current);
+    slot->epoch = atomic_load(&ring->epoch) + 1;
+    if (old && grace_ms) {
+        atomic_store(&ring->expires_ns[old - ring->slots], timing_now_ns() + (uint64_t)grace_ms * 1000000);
+        atomic_store(&ring->previous, old);
     } else {
-        perror("Error loading key");  // Print error message if file cannot be opened
+        atomic_store(&ring->previous, NULL);
     }
+    atomic_store(&ring->current, slot); // Readers switch over here
+    atomic_store(&ring->epoch, slot->epoch);
 }
 
 /**
- * Retrieve a securely stored key (either Kauth or Kattest).
- * The function copies the selected key into the provided output buffer.
+ * Compute an HMAC with one of the microvisor's keys without handing the key
+ * out. Uses the precomputed contexts, so no key schedule runs per call.
  *
- * @param key_out Pointer to the buffer where the key will be copied.
- * @param key_type 0 for Kauth (authentication), 1 for Kattest (attestation).
+ * @param mv Microvisor holding the keys
+ * @param key_type MV_KEY_AUTH or MV_KEY_ATTEST
+ * @param msg Message to authenticate
+ * @param len Message length
+ * @param out Buffer receiving MAC_SIZE bytes
+ */
+void microvisor_mac(microvisor_t *mv, uint8_t key_type, const uint8_t *msg, size_t len, uint8_t *out) {
+    MV_ENTRY(mv, MV_CALL_MAC);
+    mv_keys_ref_t ref;
+    microvisor_keys_get(mv, MV_KEYS_CURRENT, &ref);
+    microvisor_mac_with(mv, ref.keys, key_type, msg, len, out);
+    microvisor_keys_put(mv, &ref);
+}
+
+/**
+ * Compute an HMAC with a pinned key pair.
+ *
+ * @param mv Microvisor the keys were pinned from
+ * @param keys Keys from microvisor_keys_get
+ * @param key_type MV_KEY_AUTH or MV_KEY_ATTEST
+ * @param msg Message to authenticate
+ * @param len Message length
+ * @param out Buffer receiving MAC_SIZE bytes
  */
-void get_secure_key(uint8_t *key_out, uint8_t key_type) {
-    if (key_type == 0) {
-        memcpy(key_out, (const uint8_t *)Kauth, KEY_SIZE);  // Retrieve authentication key
-        hex_dump("[MICROVISOR] Kauth Retrieved", key_out, KEY_SIZE);
-    } else if (key_type == 1) {
-        memcpy(key_out, (const uint8_t *)Kattest, KEY_SIZE);  // Retrieve attestation key
-        hex_dump("[MICROVISOR] Kattest Retrieved", key_out, KEY_SIZE);
+void microvisor_mac_with(microvisor_t *mv, const mv_keys_t *keys, uint8_t key_type,
+                         const uint8_t *msg, size_t len, uint8_t *out) {
+    MV_ENTRY(mv, MV_CALL_MAC_WITH);
+    if (key_type == MV_KEY_AUTH) {
+        if (mv->verbose) hex_dump("[MICROVISOR] Kauth Retrieved", keys->kauth, MV_KEY_SIZE);
+        mac_compute(&keys->kauth_mac, msg, len, out);
+    } else {
+        if (mv->verbose) hex_dump("[MICROVISOR] Kattest Retrieved", keys->kattest, MV_KEY_SIZE);
+        mac_compute(&keys->kattest_mac, msg, len, out);
     }
 }
 
+/**
+ * Compute two Kauth MACs over one message in a single pass: HMAC(msg) and
+ * the domain-separated HMAC(msg || label).
+ *
+ * @param mv Microvisor the keys were pinned from
+ * @param keys Keys from microvisor_keys_get
+ * @param msg Shared message
+ * @param len Message length
+ * @param label Domain-separation label
+ * @param label_len Label length
+ * @param out Receives HMAC(Kauth, msg)
+ * @param out_labeled Receives HMAC(Kauth, msg || label)
+ */
+void microvisor_mac_pair_with(microvisor_t *mv, const mv_keys_t *keys, const uint8_t *msg, size_t len,
+                              const uint8_t *label, size_t label_len, uint8_t *out, uint8_t *out_labeled) {
+    MV_ENTRY(mv, MV_CALL_MAC_PAIR_WITH);
+    if (mv->verbose) hex_dump("[MICROVISOR] Kauth Retrieved", keys->kauth, MV_KEY_SIZE);
+    mac_compute_pair(&keys->kauth_mac, msg, len, label, label_len, out, out_labeled);
+}
+
+/**
+ * Bind a software measurement digest to this device using the attestation key.
+ * VS = HMAC(Kattest, measurement digest). The verifier uses this to turn an
+ * expected (golden) measurement into the VS it should see.
+ *
+ * @param mv Microvisor holding Kattest
+ * @param digest MEASURE_DIGEST_SIZE-byte digest of the measured regions
+ * @param state Buffer where the valid software state will be stored
+ */
+void bind_software_measurement(microvisor_t *mv, const uint8_t *digest, uint8_t *state) {
+    MV_ENTRY(mv, MV_CALL_BIND_STATE);
+    mv_keys_ref_t ref;
+    microvisor_keys_get(mv, MV_KEYS_CURRENT, &ref);
+    microvisor_mac_with(mv, ref.keys, MV_KEY_ATTEST, digest, MEASURE_DIGEST_SIZE, state);
+    microvisor_keys_put(mv, &ref);
+    if (mv->verbose) hex_dump("[MICROVISOR] Computed Valid Software State (VS)", state, MV_STATE_SIZE);
+}
+
+/**
+ * Bind a fresh measurement with the current keys and remember the VS for
+ * requests that accept a bounded age.
+ *
+ * @param mv Microvisor owning the cache
+ * @param digest Measurement digest (may be the cached one, to bind it again)
+ * @param state Buffer where the valid software state will be stored (not the cache)
+ * @param measured_ns When the measurement started
+ */
+static void cache_software_state(microvisor_t *mv, const uint8_t *digest, uint8_t *state, uint64_t measured_ns) {
+    mv_keys_ref_t ref;
+    microvisor_keys_get(mv, MV_KEYS_CURRENT, &ref);
+    microvisor_mac_with(mv, ref.keys, MV_KEY_ATTEST, digest, MEASURE_DIGEST_SIZE, state);
+    if (mv->verbose) hex_dump("[MICROVISOR] Computed Valid Software State (VS)", state, MV_STATE_SIZE);
+
+    if (digest != mv->cache.digest) memcpy(mv->cache.digest, digest, MEASURE_DIGEST_SIZE);
+    memcpy(mv->cache.state, state, MV_STATE_SIZE);
+    mv->cache.epoch = ref.keys->epoch;
+    mv->cache.measured_ns = measured_ns;
+    mv->cache.valid = 1;
+    microvisor_keys_put(mv, &ref);
+}
+
+/**
+ * Get the VS a prover answers with under a particular key pair. If state is
+ * the cached VS but was bound to other keys (a rotation happened since the
+ * measurement), its digest is bound again; otherwise state is used as is.
+ *
+ * @param mv Microvisor owning the cache
+ * @param state VS produced by this microvisor
+ * @param keys Pinned keys the answer will be computed with
+ * @param out Buffer receiving MV_STATE_SIZE bytes
+ */
+void microvisor_rebind_state(microvisor_t *mv, const uint8_t *state, const mv_keys_t *keys, uint8_t *out) {
+    MV_ENTRY(mv, MV_CALL_REBIND_STATE);
+    if (mv->cache.valid && mv->cache.epoch != keys->epoch &&
+        memcmp(state, mv->cache.state, MV_STATE_SIZE) == 0) {
+        mac_compute(&keys->kattest_mac, mv->cache.digest, MEASURE_DIGEST_SIZE, out);
+    } else {
+        memcpy(out, state, MV_STATE_SIZE);
+    }
+}
+
+/**
+ * Return the cached VS if its measurement started no earlier than
+ * not_before_ns, i.e. if it is fresh enough for the request at hand.
+ *
+ * @param mv Microvisor owning the cache
+ * @param state Buffer where the cached VS will be stored
+ * @param not_before_ns Oldest acceptable measurement start (timing_now_ns clock)
+ * @param measured_ns Receives when the cached measurement started
+ * @return 1 if a fresh enough VS was returned, 0 if a new measurement is needed
+ */
+int get_cached_software_state(microvisor_t *mv, uint8_t *state, uint64_t not_before_ns, uint64_t *measured_ns) {
+    MV_ENTRY(mv, MV_CALL_GET_CACHED_STATE);
+    if (!mv->cache.valid || mv->cache.measured_ns < not_before_ns) return 0;
+    if (mv->cache.epoch != atomic_load(&mv->keys.epoch)) { // Keys rotated: no need to measure again
+        cache_software_state(mv, mv->cache.digest, state, mv->cache.measured_ns);
+    } else {
+        memcpy(state, mv->cache.state, MV_STATE_SIZE);
+    }
+    *measured_ns = mv->cache.measured_ns;
+    return 1;
+}
+
+/**
+ * Bring the region table up to date before a measurement starts.
+ * Self-measurement re-enumerates the loaded segments and drops the cached
+ * digests of any that were relocated or modified.
+ *
+ * @param mv Microvisor about to measure
+ */
+static void refresh_measured_regions(microvisor_t *mv) {
+    if (mv->self) {
+        mv->nregions = selfmeasure_refresh(mv->self, &mv->regions);
+    }
+}
+
+/**
+ * Compute the raw software measurement (digest of the measured regions)
+ * without binding it to Kattest. Used to provision golden values.
+ *
+ * @param mv Microvisor whose regions are measured
+ * @param digest Buffer receiving MEASURE_DIGEST_SIZE bytes
+ */
+void compute_software_measurement(microvisor_t *mv, uint8_t *digest) {
+    MV_ENTRY(mv, MV_CALL_COMPUTE_MEASUREMENT);
+    measure_ctx_t ctx;
+
+    refresh_measured_regions(mv);
+    measure_begin(&ctx, mv->regions, mv->nregions);
+    measure_step(&ctx, SIZE_MAX);
+    measure_finish(&ctx, digest);
+}
+
 /**
  * Compute a valid software state hash using the attestation key.
- * This simulates integrity verification by hashing a predefined software code.
+ * Measures all regions in one go; use the start/step/finish functions below
+ * when the measurement must not block other work.
  *
+ * @param mv Microvisor to attest
  * @param state Buffer where the computed valid state hash will be stored.
  */
-void compute_valid_software_state(uint8_t *state) {
-    uint8_t key[KEY_SIZE];  // Buffer to store the attestation key
-    get_secure_key(key, 1);  // Retrieve Kattest
+void compute_valid_software_state(microvisor_t *mv, uint8_t *state) {
+    MV_ENTRY(mv, MV_CALL_COMPUTE_STATE);
+    uint8_t digest[MEASURE_DIGEST_SIZE];
+    uint64_t start = timing_now_ns();
+    compute_software_measurement(mv, digest);
+    cache_software_state(mv, digest, state, start);
+}
 
-    // Compute HMAC(Kattest, SOFTWARE_CODE)
-    unsigned int len = 0;
-    HMAC(EVP_sha256(), key, KEY_SIZE, (uint8_t*)SOFTWARE_CODE, strlen(SOFTWARE_CODE), state, &len);
+/**
+ * Select the memory regions covered by the software measurement.
+ * The table must stay valid for as long as measurements may run.
+ *
+ * @param mv Microvisor to configure
+ * @param regions Regions to measure, in order
+ * @param nregions Number of regions
+ */
+void set_measured_regions(microvisor_t *mv, measure_region_t *regions, size_t nregions) {
+    MV_ENTRY(mv, MV_CALL_SET_REGIONS);
+    mv->regions = regions;
+    mv->nregions = nregions;
+    mv->self = NULL;
+}
 
-    hex_dump("[MICROVISOR] Computed Valid Software State (VS)", state, OUTPUT_SIZE);
+/**
+ * Measure the prover's own loaded code: the executable and read-only
+ * segments of the program and its shared libraries. Unchanged segments are
+ * not re-hashed, so steady-state measurements are cheap.
+ *
+ * @param mv Microvisor to configure
+ * @param self Segment table from selfmeasure_init, owned by the caller
+ */
+void use_self_measurement(microvisor_t *mv, selfmeasure_t *self) {
+    MV_ENTRY(mv, MV_CALL_USE_SELF_MEASUREMENT);
+    mv->self = self;
+}
+
+/**
+ * Start a time-sliced software measurement.
+ * Any measurement already in progress is abandoned.
+ *
+ * @param mv Microvisor to measure
+ */
+void start_software_measurement(microvisor_t *mv) {
+    MV_ENTRY(mv, MV_CALL_START_MEASUREMENT);
+    refresh_measured_regions(mv);
+    measure_begin(&mv->sliced, mv->regions, mv->nregions);
+    mv->sliced_start_ns = timing_now_ns();
+}
+
+/**
+ * Report when the time-sliced measurement in progress started.
+ *
+ * @param mv Microvisor being measured
+ * @return Start time (timing_now_ns clock), or 0 if none is in progress
+ */
+uint64_t software_measurement_started(microvisor_t *mv) {
+    MV_ENTRY(mv, MV_CALL_MEASUREMENT_STARTED);
+    return mv->sliced.active ? mv->sliced_start_ns : 0;
+}
+
+/**
+ * Advance the time-sliced measurement by at most max_bytes.
+ *
+ * @param mv Microvisor being measured
+ * @param max_bytes Upper bound on bytes hashed in this slice
+ * @return 1 once the measurement is complete, 0 if more slices are needed
+ */
+int step_software_measurement(microvisor_t *mv, size_t max_bytes) {
+    MV_ENTRY(mv, MV_CALL_STEP_MEASUREMENT);
+    return measure_step(&mv->sliced, max_bytes);
+}
+
+/**
+ * Finish a completed time-sliced measurement and produce VS.
+ *
+ * @param mv Microvisor being measured
+ * @param state Buffer where the valid software state will be stored
+ */
+void finish_software_measurement(microvisor_t *mv, uint8_t *state) {
+    MV_ENTRY(mv, MV_CALL_FINISH_MEASUREMENT);
+    uint8_t digest[MEASURE_DIGEST_SIZE];
+    measure_finish(&mv->sliced, digest);
+    cache_software_state(mv, digest, state, mv->sliced_start_ns);
+}
+
+/**
+ * Snapshot the measured regions (fork/COW) and hash them in the background.
+ * The caller is stopped only while the snapshot is taken; the application
+ * can keep modifying its memory while the consistent copy is measured.
+ *
+ * @param mv Microvisor to measure
+ * @return Descriptor that becomes readable when the digest is ready, or -1
+ */
+int start_snapshot_measurement(microvisor_t *mv) {
+    MV_ENTRY(mv, MV_CALL_START_SNAPSHOT);
+    refresh_measured_regions(mv);
+    if (snapshot_begin(&mv->snapshot, mv->regions, mv->nregions) == -1) {
+        return -1;
+    }
+    return mv->snapshot.fd;
+}
+
+/**
+ * Collect the result of a background snapshot measurement and produce VS.
+ *
+ * @param mv Microvisor being measured
+ * @param state Buffer where the valid software state will be stored
+ * @param pause_ns Receives how long the caller was paused for the snapshot
+ * @param total_ns Receives the time from snapshot to digest
+ * @return 1 when VS is ready, 0 if still running, -1 if the measurement failed
+ */
+int poll_snapshot_measurement(microvisor_t *mv, uint8_t *state, uint64_t *pause_ns, uint64_t *total_ns) {
+    MV_ENTRY(mv, MV_CALL_POLL_SNAPSHOT);
+    uint8_t digest[MEASURE_DIGEST_SIZE];
+    int done = snapshot_poll(&mv->snapshot, digest);
+    if (done != 1) return done;
+
+    *pause_ns = mv->snapshot.pause_ns;
+    *total_ns = mv->snapshot.total_ns;
+    cache_software_state(mv, digest, state, mv->snapshot.start_ns); // Contents are from the fork instant
+    return 1;
+}
+
+/**
+ * Abandon a background snapshot measurement started with
+ * start_snapshot_measurement; its descriptor is closed.
+ *
+ * @param mv Microvisor being measured
+ */
+void cancel_snapshot_measurement(microvisor_t *mv) {
+    MV_ENTRY(mv, MV_CALL_CANCEL_SNAPSHOT);
+    snapshot_cancel(&mv->snapshot);
+}
+
+/**
+ * Prepare an empty microvisor that measures the dummy firmware.
+ * Keys must be installed with initialize_keys or microvisor_set_keys.
+ *
+ * @param mv Microvisor to initialize
+ */
+void microvisor_init(microvisor_t *mv) {
+    static const uint8_t no_key[MV_KEY_SIZE];
+    memset(mv, 0, sizeof(*mv));
+    microvisor_set_keys(mv, no_key, no_key); // Valid contexts until real keys arrive
+    mv->default_region.base = (const uint8_t *)SOFTWARE_CODE;
+    mv->default_region.len = sizeof(SOFTWARE_CODE) - 1;
+    mv->regions = &mv->default_region;
+    mv->nregions = 1;
+}
+
+/**
+ * Build a key pair with its HMAC contexts precomputed.
+ *
+ * @param keys Key pair to fill in
+ * @param kauth MV_KEY_SIZE-byte authentication key
+ * @param kattest MV_KEY_SIZE-byte attestation key
+ */
+void mv_keys_init(mv_keys_t *keys, const uint8_t *kauth, const uint8_t *kattest) {
+    memcpy(keys->kauth, kauth, MV_KEY_SIZE);
+    memcpy(keys->kattest, kattest, MV_KEY_SIZE);
+    mac_key_init(&keys->kauth_mac, kauth, MV_KEY_SIZE);
+    mac_key_init(&keys->kattest_mac, kattest, MV_KEY_SIZE);
+}
+
+/**
+ * Install keys that were provisioned by other means (e.g. derived per device).
+ * The old keys stop being accepted at once; use microvisor_rotate_keys for a
+ * grace period.
+ *
+ * @param mv Microvisor receiving the keys
+ * @param kauth MV_KEY_SIZE-byte authentication key
+ * @param kattest MV_KEY_SIZE-byte attestation key
+ */
+void microvisor_set_keys(microvisor_t *mv, const uint8_t *kauth, const uint8_t *kattest) {
+    MV_ENTRY(mv, MV_CALL_SET_KEYS);
+    microvisor_rotate_keys(mv, kauth, kattest, 0);
+}
+
+/**
+ * Install a key pair whose contexts are already precomputed, e.g. from a key
+ * cache. Only copies; no key schedule runs.
+ *
+ * @param mv Microvisor receiving the keys
+ * @param keys Key pair from mv_keys_init
+ */
+void microvisor_use_keys(microvisor_t *mv, const mv_keys_t *keys) {
+    MV_ENTRY(mv, MV_CALL_USE_KEYS);
+    mv_keys_t *slot = keys_prepare(&mv->keys);
+    *slot = *keys;
+    keys_publish(&mv->keys, slot, 0);
+}
+
+/**
+ * Replace the keys while attestations are in flight. The key schedule runs
+ * here, in the caller's thread, before the new keys are published with a
+ * single pointer swap; readers are never blocked. Requests made with the old
+ * keys are still accepted for grace_ms (see MV_KEYS_PREVIOUS). A cached VS
+ * is re-bound to the new Kattest on next use rather than measured again.
+ * Only one thread may install keys at a time.
+ *
+ * @param mv Microvisor receiving the keys
+ * @param kauth MV_KEY_SIZE-byte authentication key
+ * @param kattest MV_KEY_SIZE-byte attestation key
+ * @param grace_ms How long the replaced keys remain acceptable (0: not at all)
+ */
+void microvisor_rotate_keys(microvisor_t *mv, const uint8_t *kauth, const uint8_t *kattest, uint32_t grace_ms) {
+    MV_ENTRY(mv, MV_CALL_ROTATE_KEYS);
+    mv_keys_t *slot = keys_prepare(&mv->keys);
+    mv_keys_init(slot, kauth, kattest);
+    keys_publish(&mv->keys, slot, grace_ms);
+}
+
+/**
+ * Install a device's keys from a keystore.
+ *
+ * @param mv Microvisor receiving the keys
+ * @param ks Open keystore
+ * @param device_id Device whose keys to load
+ * @return 0 on success, -1 if the keystore has no keys for the device
+ */
+int microvisor_load_keys(microvisor_t *mv, const keystore_t *ks, uint32_t device_id) {
+    MV_ENTRY(mv, MV_CALL_LOAD_KEYS);
+    uint8_t kauth[MV_KEY_SIZE], kattest[MV_KEY_SIZE];
+    int found = keystore_lookup(ks, device_id, kauth, kattest) == 0;
+    if (found) microvisor_set_keys(mv, kauth, kattest);
+    memset(kauth, 0, sizeof(kauth));
+    memset(kattest, 0, sizeof(kattest));
+    return found ? 0 : -1;
 }
 
 /**
  * Initialize cryptographic keys at system startup.
  * Loads Kauth and Kattest from external files into secure memory.
+ *
+ * @param mv Microvisor receiving the keys
  */
-void initialize_keys() {
-    load_key_from_file((uint8_t *)Kauth, "kauth.key");   // Load authentication key from file
-    load_key_from_file((uint8_t *)Kattest, "kattest.key"); // Load attestation key from file
+void initialize_keys(microvisor_t *mv) {
+    MV_ENTRY(mv, MV_CALL_INITIALIZE_KEYS);
+    keystore_t ks;
+    keystore_open_files(&ks, "kauth.key", "kattest.key"); // Load keys from files
+    microvisor_load_keys(mv, &ks, 0);
+    keystore_close(&ks);
 
     // Log the loaded keys for debugging purposes
-    hex_dump("[MICROVISOR] Loaded Kauth", (uint8_t *)Kauth, KEY_SIZE);
-    hex_dump("[MICROVISOR] Loaded Kattest", (uint8_t *)Kattest, KEY_SIZE);
+    if (mv->verbose) {
+        mv_keys_ref_t ref;
+        microvisor_keys_get(mv, MV_KEYS_CURRENT, &ref);
+        hex_dump("[MICROVISOR] Loaded Kauth", ref.keys->kauth, MV_KEY_SIZE);
+        hex_dump("[MICROVISOR] Loaded Kattest", ref.keys->kattest, MV_KEY_SIZE);
+        microvisor_keys_put(mv, &ref);
+    }
+}
+
+/**
+ * Read the accumulated cost of one entry point. The cycle counts include the
+ * entry points it calls and the timing itself (two rdtscp and the atomic
+ * updates, a few dozen cycles).
+ *
+ * @param mv Microvisor
+ * @param call Entry point (MV_CALL_*)
+ * @param calls Receives the number of calls
+ * @param cycles Receives the total cycles spent in them
+ * @param max_cycles Receives the most expensive call
+ */
+void microvisor_call_stats(microvisor_t *mv, mv_call_t call, uint64_t *calls, uint64_t *cycles, uint64_t *max_cycles) {
+    *calls = atomic_load_explicit(&mv->calls[call].calls, memory_order_relaxed);
+    *cycles = atomic_load_explicit(&mv->calls[call].cycles, memory_order_relaxed);
+    *max_cycles = atomic_load_explicit(&mv->calls[call].max_cycles, memory_order_relaxed);
+}
+
+/**
+ * Name of an entry point, for reports.
+ *
+ * @param call Entry point (MV_CALL_*)
+ * @return Function name
+ */
+const char *microvisor_call_name(mv_call_t call) {
+    return call < MV_CALL_COUNT ? call_names[call] : "?";
+}
+
+/**
+ * Print the cost of every entry point that was called: count, mean and
+ * maximum in cycles, and the mean in microseconds.
+ *
+ * @param mv Microvisor
+ * @param log_tag Prefix of each line (e.g. "[PROVER]")
+ */
+void microvisor_print_call_stats(microvisor_t *mv, const char *log_tag) {
+    double per_ns = timing_cycles_per_ns();
+    printf("%s %-30s %10s %12s %12s %10s\n", log_tag, "microvisor entry point", "calls", "mean cyc", "max cyc", "mean us");
+    for (int i = 0; i < MV_CALL_COUNT; i++) {
+        uint64_t calls, cycles, max_cycles;
+        microvisor_call_stats(mv, (mv_call_t)i, &calls, &cycles, &max_cycles);
+        if (calls == 0) continue;
+        printf("%s %-30s %10llu %12.0f %12llu %10.2f\n", log_tag, call_names[i], (unsigned long long)calls,
+               (double)cycles / calls, (unsigned long long)max_cycles, cycles / per_ns / calls / 1e3);
+    }
+}
+
+/**
+ * Start the per-entry-point accounting over.
+ *
+ * @param mv Microvisor
+ */
+void microvisor_reset_call_stats(microvisor_t *mv) {
+    for (int i = 0; i < MV_CALL_COUNT; i++) {
+        atomic_store_explicit(&mv->calls[i].calls, 0, memory_order_relaxed);
+        atomic_store_explicit(&mv->calls[i].cycles, 0, memory_order_relaxed);
+        atomic_store_explicit(&mv->calls[i].max_cycles, 0, memory_order_relaxed);
+    }
 }
 
 /**
@@ -84,7 +674,7 @@ void initialize_keys() {
  * @param data Pointer to the buffer to be printed.
  * @param len Length of the data buffer.
  */
-void hex_dump(const char *label, uint8_t *data, size_t len) {
+void hex_dump(const char *label, const uint8_t *data, size_t len) {
     printf("%s: ", label);
     for (size_t i = 0; i < len; i++) {
         printf("%02X ", data[i]);  // Print each byte as a two-digit hexadecimal number
@@ -92,3 +682,20 @@ void hex_dump(const char *label, uint8_t *data, size_t len) {
     printf("\n");
 }
 
+/**
+ * Parses a hexadecimal string into a fixed-size byte buffer.
+ *
+ * @param hex Input string (exactly 2 * len hex digits)
+ * @param out Destination buffer
+ * @param len Number of bytes to parse
+ * @return 0 on success, -1 if the string is malformed
+ */
+int parse_hex(const char *hex, uint8_t *out, size_t len) {
+    if (strlen(hex) != 2 * len) return -1;
+    for (size_t i = 0; i < len; i++) {
+        unsigned int byte;
+        if (sscanf(hex + 2 * i, "%2x", &byte) != 1) return -1;
+        out[i] = (uint8_t)byte;
+    }
+    return 0;
+}
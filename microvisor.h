@@ -3,12 +3,157 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdatomic.h>
+#include "keystore.h"
+#include "mac.h"
+#include "measure.h"
+#include "selfmeasure.h"
+#include "snapshot.h"
+
+#define SOFTWARE_CODE "ExampleFirmwareV1"  // Dummy software representation
+#define MV_KEY_SIZE 32                     // Size of cryptographic keys in bytes
+#define MV_STATE_SIZE 32                   // Size of the valid software state (VS)
+
+#define MV_KEY_AUTH 0    // Kauth: authenticates requests and reports
+#define MV_KEY_ATTEST 1  // Kattest: binds the software measurement (VS)
+
+#define MV_KEYS_CURRENT 0   // Keys installed last
+#define MV_KEYS_PREVIOUS 1  // Keys they replaced, only until the grace period ends
+#define MV_KEY_SLOTS 3      // Current, previous, and one being prepared
+
+// A device's key pair, with HMAC contexts precomputed so that using the keys
+// costs no key schedule. Copying the struct hands the keys to a microvisor.
+typedef struct {
+    uint8_t kauth[MV_KEY_SIZE];    // Authentication key
+    uint8_t kattest[MV_KEY_SIZE];  // Attestation key
+    mac_key_t kauth_mac;
+    mac_key_t kattest_mac;
+    uint32_t epoch;                // Set by the microvisor when the keys are installed
+} mv_keys_t;
+
+// Installed keys, RCU style. Readers never lock: they announce themselves in
+// one of two reader counters and use a slot in place. Writers prepare new keys
+// in a free slot, publish it with a pointer swap and wait for the announced
+// readers before reusing a slot. Writers must be serialized by the caller.
+typedef struct {
+    mv_keys_t slots[MV_KEY_SLOTS];
+    _Atomic(mv_keys_t *) current;
+    _Atomic(mv_keys_t *) previous;             // Still accepted until its expiry (NULL: none)
+    _Atomic uint64_t expires_ns[MV_KEY_SLOTS]; // End of the grace period of a replaced slot
+    _Atomic uint32_t epoch;                    // Epoch of the current keys
+    _Atomic uint32_t phase;                    // Selects the counter new readers announce in
+    _Atomic uint32_t readers[2];
+} mv_keyring_t;
+
+// Keys pinned by microvisor_keys_get, usable until microvisor_keys_put
+typedef struct {
+    const mv_keys_t *keys;
+    uint32_t phase;
+} mv_keys_ref_t;
+
+// Microvisor entry points with per-call cycle accounting
+typedef enum {
+    MV_CALL_GET_SECURE_KEY,
+    MV_CALL_KEYS_GET,
+    MV_CALL_KEYS_PUT,
+    MV_CALL_MAC,
+    MV_CALL_MAC_WITH,
+    MV_CALL_MAC_PAIR_WITH,
+    MV_CALL_BIND_STATE,
+    MV_CALL_REBIND_STATE,
+    MV_CALL_GET_CACHED_STATE,
+    MV_CALL_COMPUTE_MEASUREMENT,
+    MV_CALL_COMPUTE_STATE,
+    MV_CALL_SET_REGIONS,
+    MV_CALL_USE_SELF_MEASUREMENT,
+    MV_CALL_START_MEASUREMENT,
+    MV_CALL_STEP_MEASUREMENT,
+    MV_CALL_FINISH_MEASUREMENT,
+    MV_CALL_MEASUREMENT_STARTED,
+    MV_CALL_START_SNAPSHOT,
+    MV_CALL_POLL_SNAPSHOT,
+    MV_CALL_CANCEL_SNAPSHOT,
+    MV_CALL_SET_KEYS,
+    MV_CALL_USE_KEYS,
+    MV_CALL_ROTATE_KEYS,
+    MV_CALL_LOAD_KEYS,
+    MV_CALL_INITIALIZE_KEYS,
+    MV_CALL_COUNT
+} mv_call_t;
+
+// Cost of one entry point, in timing_cycles() units. Updated with relaxed
+// atomics, since keys may be used and rotated from several threads.
+typedef struct {
+    _Atomic uint64_t calls;
+    _Atomic uint64_t cycles;      // Total, including nested entry points
+    _Atomic uint64_t max_cycles;
+} mv_call_stats_t;
+
+// Most recent VS with the time its measurement started, for freshness-bounded reuse.
+// The digest is kept so the VS can be re-bound after a key rotation.
+typedef struct {
+    uint8_t digest[MEASURE_DIGEST_SIZE];
+    uint8_t state[MV_STATE_SIZE];
+    uint32_t epoch;        // Keys the state is bound to
+    uint64_t measured_ns;  // Start of the measurement (contents are at least this new)
+    int valid;
+} mv_measurement_cache_t;
+
+// One device's secure world: its keys and everything derived from them. All
+// state lives in this object, so several independent microvisors can run in
+// one process; a single instance must not be used by two threads at once,
+// except that keys may be rotated from another thread at any time. The keys
+// point into the object, so it must not be copied or moved after init.
+// Callers place it in secure memory (the `.secure_data` section).
+typedef struct {
+    mv_keyring_t keys;                   // Kauth and Kattest
+    measure_region_t default_region;     // The dummy firmware
+    measure_region_t *regions;           // Memory covered by the software measurement
+    size_t nregions;
+    selfmeasure_t *self;                 // Loaded-segment table when self-measuring
+    measure_ctx_t sliced;                // Hash state of the time-sliced measurement
+    uint64_t sliced_start_ns;
+    snapshot_t snapshot;                 // Copy-on-write measurement in the background
+    mv_measurement_cache_t cache;
+    mv_call_stats_t calls[MV_CALL_COUNT]; // Per entry point cost (build with -DMV_NO_CALL_STATS to omit)
+    int verbose;                         // Log keys and states with hex_dump
+} microvisor_t;
 
 // Function prototypes
-void get_secure_key(uint8_t *key_out, uint8_t key_type);
-void compute_valid_software_state(uint8_t *state);
-void hex_dump(const char *label, uint8_t *data, size_t len);
-void initialize_keys();
+void microvisor_init(microvisor_t *mv);
+void mv_keys_init(mv_keys_t *keys, const uint8_t *kauth, const uint8_t *kattest);
+void microvisor_set_keys(microvisor_t *mv, const uint8_t *kauth, const uint8_t *kattest);
+void microvisor_use_keys(microvisor_t *mv, const mv_keys_t *keys);
+void microvisor_rotate_keys(microvisor_t *mv, const uint8_t *kauth, const uint8_t *kattest, uint32_t grace_ms);
+int microvisor_keys_get(microvisor_t *mv, int which, mv_keys_ref_t *ref);
+void microvisor_keys_put(microvisor_t *mv, mv_keys_ref_t *ref);
+void microvisor_mac(microvisor_t *mv, uint8_t key_type, const uint8_t *msg, size_t len, uint8_t *out);
+void microvisor_mac_with(microvisor_t *mv, const mv_keys_t *keys, uint8_t key_type,
+                         const uint8_t *msg, size_t len, uint8_t *out);
+void microvisor_mac_pair_with(microvisor_t *mv, const mv_keys_t *keys, const uint8_t *msg, size_t len,
+                              const uint8_t *label, size_t label_len, uint8_t *out, uint8_t *out_labeled);
+void microvisor_rebind_state(microvisor_t *mv, const uint8_t *state, const mv_keys_t *keys, uint8_t *out);
+int microvisor_load_keys(microvisor_t *mv, const keystore_t *ks, uint32_t device_id);
+void initialize_keys(microvisor_t *mv);
+void get_secure_key(microvisor_t *mv, uint8_t *key_out, uint8_t key_type);
+void compute_valid_software_state(microvisor_t *mv, uint8_t *state);
+void compute_software_measurement(microvisor_t *mv, uint8_t *digest);
+void bind_software_measurement(microvisor_t *mv, const uint8_t *digest, uint8_t *state);
+void set_measured_regions(microvisor_t *mv, measure_region_t *regions, size_t nregions);
+void use_self_measurement(microvisor_t *mv, selfmeasure_t *self);
+void start_software_measurement(microvisor_t *mv);
+int step_software_measurement(microvisor_t *mv, size_t max_bytes);
+void finish_software_measurement(microvisor_t *mv, uint8_t *state);
+uint64_t software_measurement_started(microvisor_t *mv);
+int get_cached_software_state(microvisor_t *mv, uint8_t *state, uint64_t not_before_ns, uint64_t *measured_ns);
+int start_snapshot_measurement(microvisor_t *mv);
+int poll_snapshot_measurement(microvisor_t *mv, uint8_t *state, uint64_t *pause_ns, uint64_t *total_ns);
+void cancel_snapshot_measurement(microvisor_t *mv);
+void microvisor_call_stats(microvisor_t *mv, mv_call_t call, uint64_t *calls, uint64_t *cycles, uint64_t *max_cycles);
+const char *microvisor_call_name(mv_call_t call);
+void microvisor_print_call_stats(microvisor_t *mv, const char *log_tag);
+void microvisor_reset_call_stats(microvisor_t *mv);
+void hex_dump(const char *label, const uint8_t *data, size_t len);
+int parse_hex(const char *hex, uint8_t *out, size_t len);
 
 #endif // MICROVISOR_H
-
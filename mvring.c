@@ -0,0 +1,217 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include "mvring.h"
+#include "secarena.h"
+
+/*
+ * Out-of-process microvisor.
+ *
+ * microvisor.c runs in a child process that alone holds the keys. Callers
+ * reach it only through a shared-memory ring pair, io_uring style: requests
+ * are written into submission slots and made visible by publishing the tail
+ * index; the microvisor writes results into completion slots the same way.
+ * Ringing a doorbell (an eventfd write) is the boundary crossing: it costs a
+ * system call and, when the other side sleeps, a context switch. Each
+ * doorbell covers every request queued since the previous one, so the
+ * crossing is paid per batch rather than per request.
+ */
+
+static void ring_doorbell(int fd) {
+    uint64_t one = 1;
+    while (write(fd, &one, sizeof(one)) == -1 && errno == EINTR) {
+    }
+}
+
+static int wait_doorbell(int fd) {
+    uint64_t count;
+    ssize_t n;
+    while ((n = read(fd, &count, sizeof(count))) == -1 && errno == EINTR) {
+    }
+    return n == (ssize_t)sizeof(count) ? 0 : -1;
+}
+
+/**
+ * Serve one request. The caller can rewrite its slot at any time, so the
+ * entry is copied out once and only the copy is checked and used.
+ */
+static void serve(microvisor_t *mv, const mvring_sqe_t *shared_sqe, mvring_cqe_t *cqe) {
+    mvring_sqe_t sqe;
+    memcpy(&sqe, shared_sqe, sizeof(sqe));
+    cqe->user = sqe.user;
+    cqe->status = 0;
+    if (sqe.op == MVRING_OP_MAC && sqe.len <= MVRING_MSG_MAX &&
+        (sqe.key_type == MV_KEY_AUTH || sqe.key_type == MV_KEY_ATTEST)) {
+        microvisor_mac(mv, (uint8_t)sqe.key_type, sqe.msg, sqe.len, cqe->out);
+    } else if (sqe.op == MVRING_OP_STATE) {
+        compute_valid_software_state(mv, cqe->out);
+    } else {
+        cqe->status = -1;
+        memset(cqe->out, 0, sizeof(cqe->out));
+    }
+}
+
+/**
+ * Microvisor process: sleep on the submission doorbell, drain every queued
+ * request, post the completions and ring the completion doorbell once.
+ */
+static void serve_ring(microvisor_t *mv, mvring_shared_t *sh, int sq_doorbell, int cq_doorbell) {
+    uint32_t head = atomic_load_explicit(&sh->sq_head, memory_order_relaxed);
+    uint32_t cq_tail = atomic_load_explicit(&sh->cq_tail, memory_order_relaxed);
+    while (wait_doorbell(sq_doorbell) == 0) {
+        uint32_t tail = atomic_load_explicit(&sh->sq_tail, memory_order_acquire);
+        if (head == tail) continue;
+        while (head != tail) {
+            // The caller never has more than MVRING_ENTRIES in flight, so the slot is free
+            serve(mv, &sh->sq[head % MVRING_ENTRIES], &sh->cq[cq_tail % MVRING_ENTRIES]);
+            head++;
+            cq_tail++;
+        }
+        atomic_store_explicit(&sh->sq_head, head, memory_order_release);
+        atomic_store_explicit(&sh->cq_tail, cq_tail, memory_order_release);
+        ring_doorbell(cq_doorbell);
+    }
+}
+
+// The child's microvisor: its keys get the guard pages and locking of .secure_data
+__attribute__((section(".secure_data"))) static microvisor_t ring_mv;
+
+/**
+ * Close the doorbells and unmap the ring, whichever of them exist.
+ *
+ * @param r Ring handle
+ */
+static void release_ring(mvring_t *r) {
+    if (r->sq_doorbell != -1) close(r->sq_doorbell);
+    if (r->cq_doorbell != -1) close(r->cq_doorbell);
+    if (r->shared != MAP_FAILED) munmap(r->shared, sizeof(mvring_shared_t));
+    memset(r, 0, sizeof(*r));
+}
+
+/**
+ * Start a microvisor process holding the given keys and measuring the given
+ * regions. The keys stay in the caller too unless it wipes its copy. The
+ * child is killed when the caller exits. The caller must be linked with
+ * memory.ld: the child keeps the keys in `.secure_data`.
+ *
+ * @param r Handle to initialize
+ * @param kauth MV_KEY_SIZE-byte authentication key
+ * @param kattest MV_KEY_SIZE-byte attestation key
+ * @param regions Memory the VS covers (NULL: the dummy firmware); the child
+ *                measures its copy-on-write view of it
+ * @param nregions Number of regions
+ * @return 0 on success, -1 on failure
+ */
+int mvring_start(mvring_t *r, const uint8_t *kauth, const uint8_t *kattest, measure_region_t *regions, size_t nregions) {
+    memset(r, 0, sizeof(*r));
+    r->shared = mmap(NULL, sizeof(mvring_shared_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    r->sq_doorbell = r->cq_doorbell = -1;
+    if (r->shared == MAP_FAILED) {
+        perror("[MVRING] Failed to map the ring");
+        release_ring(r);
+        return -1;
+    }
+    r->sq_doorbell = eventfd(0, EFD_CLOEXEC);
+    r->cq_doorbell = eventfd(0, EFD_CLOEXEC);
+    if (r->sq_doorbell == -1 || r->cq_doorbell == -1) {
+        perror("[MVRING] Failed to create doorbells");
+        release_ring(r);
+        return -1;
+    }
+
+    // Arms the guard pages the child inherits; fails if .secure_data was not laid out
+    if (secarena_protect_section(NULL, NULL) == -1) {
+        release_ring(r);
+        return -1;
+    }
+
+    pid_t parent = getpid();
+    r->pid = fork();
+    if (r->pid == -1) {
+        perror("[MVRING] Failed to fork the microvisor");
+        release_ring(r);
+        return -1;
+    }
+    if (r->pid == 0) {
+        // Without this the child would wait on the doorbell forever once the caller is gone
+        if (prctl(PR_SET_PDEATHSIG, SIGKILL) == -1 || getppid() != parent) _exit(1);
+        secarena_protect_section(NULL, NULL); // Memory locks are not inherited across fork
+        microvisor_init(&ring_mv);
+        microvisor_set_keys(&ring_mv, kauth, kattest);
+        if (regions) set_measured_regions(&ring_mv, regions, nregions);
+        serve_ring(&ring_mv, r->shared, r->sq_doorbell, r->cq_doorbell);
+        _exit(0);
+    }
+    return 0;
+}
+
+/**
+ * Get the next free submission slot. Nothing is visible to the microvisor
+ * until mvring_submit.
+ *
+ * @param r Ring handle
+ * @return Slot to fill in, or NULL if MVRING_ENTRIES requests are in flight
+ */
+mvring_sqe_t *mvring_get_sqe(mvring_t *r) {
+    if (r->in_flight == MVRING_ENTRIES) return NULL;
+    r->in_flight++;
+    return &r->shared->sq[r->sq_tail++ % MVRING_ENTRIES];
+}
+
+/**
+ * Publish every slot filled since the last call and ring the doorbell once.
+ *
+ * @param r Ring handle
+ */
+void mvring_submit(mvring_t *r) {
+    if (atomic_load_explicit(&r->shared->sq_tail, memory_order_relaxed) == r->sq_tail) return;
+    atomic_store_explicit(&r->shared->sq_tail, r->sq_tail, memory_order_release);
+    ring_doorbell(r->sq_doorbell);
+    r->doorbells++;
+}
+
+/**
+ * Collect completions.
+ *
+ * @param r Ring handle
+ * @param out Receives up to max completions, in submission order
+ * @param max Capacity of out
+ * @param wait If nonzero and nothing has completed, block until something has
+ * @return Number of completions copied
+ */
+size_t mvring_reap(mvring_t *r, mvring_cqe_t *out, size_t max, int wait) {
+    mvring_shared_t *sh = r->shared;
+    uint32_t head = atomic_load_explicit(&sh->cq_head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&sh->cq_tail, memory_order_acquire);
+    while (head == tail && wait && r->in_flight) {
+        r->waits++;
+        if (wait_doorbell(r->cq_doorbell) == -1) return 0;
+        tail = atomic_load_explicit(&sh->cq_tail, memory_order_acquire);
+    }
+
+    size_t n = 0;
+    while (n < max && head != tail) out[n++] = sh->cq[head++ % MVRING_ENTRIES];
+    atomic_store_explicit(&sh->cq_head, head, memory_order_release);
+    r->in_flight -= n;
+    return n;
+}
+
+/**
+ * Stop the microvisor process and unmap the ring.
+ *
+ * @param r Ring handle
+ */
+void mvring_stop(mvring_t *r) {
+    if (r->pid > 0) {
+        kill(r->pid, SIGTERM);
+        waitpid(r->pid, NULL, 0);
+    }
+    release_ring(r);
+}
@@ -0,0 +1,64 @@
+#ifndef MVRING_H
+#define MVRING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <sys/types.h>
+#include "microvisor.h"
+
+#define MVRING_ENTRIES 256   // Submission and completion slots (power of two)
+#define MVRING_MSG_MAX 128   // Largest message a MAC request carries
+
+// Operations the microvisor process serves
+#define MVRING_OP_MAC 1      // HMAC of msg with key_type
+#define MVRING_OP_STATE 2    // Valid software state (measurement bound to Kattest)
+
+// Submission queue entry, filled in by the caller
+typedef struct {
+    uint32_t op;
+    uint32_t key_type;       // MV_KEY_AUTH or MV_KEY_ATTEST (MVRING_OP_MAC)
+    uint32_t len;
+    uint64_t user;           // Returned unchanged in the completion
+    uint8_t msg[MVRING_MSG_MAX];
+} mvring_sqe_t;
+
+// Completion queue entry, filled in by the microvisor process
+typedef struct {
+    uint64_t user;
+    int32_t status;          // 0, or -1 for a malformed request
+    uint8_t out[MAC_SIZE];   // MAC or VS
+} mvring_cqe_t;
+
+// Shared between the caller and the microvisor process. Each index has one
+// writer: the caller produces sq_tail and consumes cq_head, the microvisor
+// the other two. Indices run freely and wrap modulo MVRING_ENTRIES.
+typedef struct {
+    _Atomic uint32_t sq_head;
+    _Atomic uint32_t sq_tail;
+    _Atomic uint32_t cq_head;
+    _Atomic uint32_t cq_tail;
+    mvring_sqe_t sq[MVRING_ENTRIES];
+    mvring_cqe_t cq[MVRING_ENTRIES];
+} mvring_shared_t;
+
+// Caller's handle on a microvisor running in its own process
+typedef struct {
+    mvring_shared_t *shared;
+    int sq_doorbell;          // eventfd: requests were submitted
+    int cq_doorbell;          // eventfd: completions were posted
+    pid_t pid;
+    uint32_t sq_tail;         // Caller's copy, published by mvring_submit
+    uint32_t in_flight;       // Submitted, not yet reaped
+    uint64_t doorbells;       // Boundary crossings towards the microvisor
+    uint64_t waits;           // Times the caller blocked for completions
+} mvring_t;
+
+// Function prototypes
+int mvring_start(mvring_t *r, const uint8_t *kauth, const uint8_t *kattest, measure_region_t *regions, size_t nregions);
+mvring_sqe_t *mvring_get_sqe(mvring_t *r);
+void mvring_submit(mvring_t *r);
+size_t mvring_reap(mvring_t *r, mvring_cqe_t *out, size_t max, int wait);
+void mvring_stop(mvring_t *r);
+
+#endif // MVRING_H
@@ -2,156 +2,805 @@
 #include <string.h>
 #include <stdio.h>
 #include <unistd.h>
-#include <fcntl.h>
-#include <termios.h>
-#include <openssl/hmac.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include "admit.h"
+#include "keycache.h"
 #include "microvisor.h"
+#include "simple.h"
+#include "sched.h"
+#include "secarena.h"
+#include "swatt.h"
+#include "trace.h"
+#include "uart.h"
 
-#define NONCE_SIZE 32  // Size of nonce (random challenge) in bytes
-#define OUTPUT_SIZE 32 // HMAC-SHA256 output size in bytes
-#define KEY_SIZE 32    // Cryptographic key size in bytes
-#define COUNTER_SIZE 4 // Counter size (32-bit integer)
+#define PROVER_MAX_LINKS 8 // Serial links served by one event loop
 
-// Monotonic counter for the Prover, stored securely
-__attribute__((section(".secure_data"))) volatile uint32_t C_P = 0;
+// Secure world and protocol state of this prover, stored securely
+__attribute__((section(".secure_data"))) static microvisor_t mv;
+__attribute__((section(".secure_data"))) static simple_prover_t provers[PROVER_MAX_LINKS]; // One C_P per link
+
+static volatile sig_atomic_t dump_call_stats; // Set by SIGUSR1
 
 /**
- * Opens a simulated UART connection for communication with the Verifier.
- * Uses pseudo-terminals (pts) to simulate real hardware UART.
+ * Requests a printout of the microvisor's per-entry-point cost.
  *
- * @param device Path to the UART device (e.g., /dev/pts/X)
- * @return File descriptor for the opened UART connection, or -1 on failure
+ * @param sig Signal number (unused)
  */
-int open_uart(const char *device) {
-    int fd = open(device, O_RDWR | O_NOCTTY | O_NDELAY); // Open UART in read-write mode
-    if (fd == -1) {
-        perror("[PROVER] Failed to open UART");
-        return -1;
-    }
+static void on_sigusr1(int sig) {
+    (void)sig;
+    dump_call_stats = 1;
+}
+
+// Where this device's keys come from; read again on SIGHUP to rotate them
+typedef struct {
+    const char *master_file;    // Derive from this master secret (NULL: not used)
+    const char *keystore_file;  // Look up in this keystore (NULL: not used)
+    uint32_t device_id;
+    uint32_t grace_ms;          // How long replaced keys stay acceptable
+} key_source_t;
 
-    struct termios options;
-    tcgetattr(fd, &options);
-    cfsetispeed(&options, B115200); // Set baud rate
-    cfsetospeed(&options, B115200);
-    options.c_cflag = CS8 | CLOCAL | CREAD; // 8-bit data, enable receiver
-    tcsetattr(fd, TCSANOW, &options); // Apply settings
+// What the measurement engine is currently working for
+typedef enum {
+    MEASURE_IDLE,        // Nothing in progress
+    MEASURE_BACKGROUND,  // Idle-time pre-measurement refreshing the cached VS
+    MEASURE_REQUEST,     // Measurement pending requests are waiting for
+} measure_mode_t;
 
-    tcflush(fd, TCIOFLUSH); // Clear any pending data
-    return fd;
+#define PROVER_TX_SIZE (8 * FRAME_MAX_SIZE) // Reports queued on a link that drains slowly
+
+// One serial link to a verifier. Every verifier keeps its own counter, so
+// each link has its own C_P and its own admission control; the microvisor
+// and its cached VS are shared by all links.
+typedef struct {
+    const char *device;
+    char tag[32];                   // Log prefix
+    int fd;
+    simple_prover_t *prover;        // C_P of the verifier on this link
+    frame_rx_t rx;                  // Frames being received from the UART
+    uint64_t skipped_logged;        // Resynchronization bytes already reported
+    simple_request_t request;       // The complete request, decoded
+    uint64_t request_ns;            // When the pending request was complete
+    uint64_t not_before_ns;         // Oldest measurement start the pending request accepts
+    int waiting;                    // Request waits for a measurement; further input stays unread
+    admit_t *admit;                 // Admission control of the link (NULL: off)
+    uint64_t dropped_logged;        // Dropped requests already reported
+    uint8_t tx[PROVER_TX_SIZE];     // Reports the UART has not taken yet
+    size_t tx_len;
+    uint64_t tx_dropped;            // Reports dropped because tx was full
+    uint32_t events;                // Current epoll interest
+    uint64_t answered;
+} prover_link_t;
+
+// Request handling state shared by the scheduler tasks
+typedef struct {
+    prover_link_t *links;
+    size_t nlinks;
+    size_t open_links;              // Links still connected; the prover exits when none are left
+    int epoll_fd;                   // The links' readiness; the scheduler sleeps on it
+    uint32_t ready;                 // Links that may have frames buffered (bit per link)
+    uint32_t device_id;             // Passed to the tracepoints
+    microvisor_t *mv;
+    size_t slice_bytes;             // Measurement bytes hashed per scheduler slice
+    measure_mode_t measuring;
+    uint32_t slices;                // Slices spent on the current measurement
+    uint64_t measure_start_ns;
+    int use_snapshot;               // Measure a fork/COW snapshot in the background
+    int snapshot_fd;                // Readable when the snapshot digest is ready (-1: none)
+    int premeasure;                 // Answer from the cached VS when it is fresh enough
+    sched_t *sched;
+    sched_task_t *control;          // Simulated control loop task (NULL if disabled)
+} prover_state_t;
+
+/**
+ * Logs that the link is ready for the next attestation request.
+ *
+ * @param l Link
+ */
+static void wait_for_request(prover_link_t *l) {
+    printf("%s Waiting for attestation request...\n", l->tag);
 }
 
 /**
- * Computes an HMAC for the Prover using the received attestation request.
- * The HMAC is computed over { C_V, Valid Software State, Nonce } using Kauth.
+ * Registers for input unless the link waits for a measurement, and for
+ * output while reports are queued.
  *
- * @param C_V Counter value received from the Verifier
- * @param nonce Pointer to the received nonce
- * @param output Buffer to store the computed HMAC
+ * @param st Prover state
+ * @param l Link
  */
-void compute_prover_hmac(uint32_t C_V, uint8_t *nonce, uint8_t *output) {
-    uint8_t key[KEY_SIZE];
-    uint8_t valid_state[KEY_SIZE];
-    uint8_t hmac_input[COUNTER_SIZE + KEY_SIZE + NONCE_SIZE];
+static void link_update_events(prover_state_t *st, prover_link_t *l) {
+    if (l->fd == -1) return;
+    uint32_t events = (l->waiting ? 0 : EPOLLIN) | (l->tx_len ? EPOLLOUT : 0);
+    if (events == l->events) return;
+
+    struct epoll_event ev = { .events = events, .data.u32 = (uint32_t)(l - st->links) };
+    epoll_ctl(st->epoll_fd, EPOLL_CTL_MOD, l->fd, &ev);
+    l->events = events;
+}
 
-    get_secure_key(key, 0);  // Retrieve authentication key (Kauth)
-    compute_valid_software_state(valid_state); // Compute valid software state (VS)
+/**
+ * Takes a link whose peer has hung up out of the loop. A dead link would
+ * otherwise report hangup on every pass and keep the scheduler from sleeping.
+ * A request it was waiting with is dropped.
+ *
+ * @param st Prover state
+ * @param l Link
+ * @param why Reason for the log
+ */
+static void link_close(prover_state_t *st, prover_link_t *l, const char *why) {
+    epoll_ctl(st->epoll_fd, EPOLL_CTL_DEL, l->fd, NULL);
+    close(l->fd);
+    l->fd = -1;
+    l->waiting = 0;
+    l->tx_len = 0;
+    l->events = 0;
+    st->open_links--;
+    printf("%s %s: %s, link closed\n", l->tag, l->device, why);
+}
 
-    // Construct HMAC input: { C_V || Valid Software State || Nonce }
-    memcpy(hmac_input, &C_V, COUNTER_SIZE);
-    memcpy(hmac_input + COUNTER_SIZE, valid_state, KEY_SIZE);
-    memcpy(hmac_input + COUNTER_SIZE + KEY_SIZE, nonce, NONCE_SIZE);
+/**
+ * Writes as much of the link's queued output as the UART takes without
+ * blocking. The rest goes out when epoll reports room.
+ *
+ * @param l Link
+ */
+static void link_flush(prover_link_t *l) {
+    while (l->tx_len) {
+        ssize_t n = write(l->fd, l->tx, l->tx_len);
+        if (n < 0 && errno != EAGAIN && errno != EINTR) l->tx_len = 0; // Link gone: nobody to send to
+        if (n <= 0) return;
+        memmove(l->tx, l->tx + n, l->tx_len - n);
+        l->tx_len -= n;
+    }
+}
+
+/**
+ * Queues a report frame on a link and sends what the UART takes right away.
+ * A link that drains slowly keeps its backlog here instead of stalling the
+ * others.
+ *
+ * @param st Prover state
+ * @param l Link
+ * @param report Report to send
+ */
+static void link_send_report(prover_state_t *st, prover_link_t *l, const simple_report_t *report) {
+    uint8_t buf[SIMPLE_REPORT_SIZE];
+    if (l->fd == -1) return;
+    simple_encode_report(report, buf);
+    if (PROVER_TX_SIZE - l->tx_len < FRAME_OVERHEAD + sizeof(buf)) {
+        l->tx_dropped++; // The verifier is not reading; it times out and retries
+        return;
+    }
+    l->tx_len += frame_encode(FRAME_REPORT, buf, sizeof(buf), l->tx + l->tx_len);
+    link_flush(l);
+    link_update_events(st, l);
+}
+
+/**
+ * Verifies the link's pending request against the measured VS and sends the report.
+ *
+ * @param st Prover state
+ * @param l Link with a pending request
+ * @param valid_state Valid software state (VS) to answer with
+ */
+static void answer_request(prover_state_t *st, prover_link_t *l, const uint8_t *valid_state) {
+    simple_report_t report;
+    uint32_t counter = l->prover->counter;
+    TRACE3(mac_start, st->device_id, l->request.counter, 1);
+    int status = simple_prover_answer(l->prover, &l->request, valid_state, &report);
+    TRACE4(mac_done, st->device_id, l->request.counter, 1, status);
+    if (status == SIMPLE_OK) {
+        TRACE3(counter_update, st->device_id, counter, l->prover->counter);
+        link_send_report(st, l, &report);
+        printf("%s  Attestation SUCCESS!\n", l->tag);
+    } else {
+        printf("%s  Attestation FAILED!\n", l->tag);
+    }
+    l->answered++;
+
+    uint64_t response_ns = timing_now_ns() - l->request_ns;
+    TRACE4(report_send, st->device_id, l->request.counter, status, response_ns);
+    printf("%s Response time: %.1fus\n", l->tag, response_ns / 1e3);
+    if (st->control) lat_stats_print("[PROVER] Control loop release latency", &st->control->lateness);
+    wait_for_request(l);
+}
+
+/**
+ * When the measurement in progress started: its contents are at least that new.
+ *
+ * @param st Prover state
+ */
+static uint64_t measurement_started(prover_state_t *st) {
+    return st->snapshot_fd != -1 ? st->measure_start_ns : software_measurement_started(st->mv);
+}
 
-    unsigned int len = 0;
-    HMAC(EVP_sha256(), key, KEY_SIZE, hmac_input, sizeof(hmac_input), output, &len);
+/**
+ * Starts a measurement for the requests waiting on it: a snapshot in a child
+ * process, or VS in bounded slices, so other tasks keep running meanwhile.
+ * A snapshot the scheduler cannot wake up for is abandoned for slices.
+ *
+ * @param st Prover state
+ */
+static void start_request_measurement(prover_state_t *st) {
+    st->measuring = MEASURE_REQUEST;
+    st->slices = 0;
+    st->measure_start_ns = timing_now_ns();
 
-    hex_dump("[PROVER] Computed HMAC", output, OUTPUT_SIZE);
+    st->snapshot_fd = st->use_snapshot ? start_snapshot_measurement(st->mv) : -1;
+    if (st->snapshot_fd != -1 && sched_watch_fd(st->sched, st->snapshot_fd) == -1) {
+        static int warned;
+        if (!warned) printf("[PROVER] Scheduler cannot watch the snapshot, measuring in slices\n");
+        warned = 1;
+        cancel_snapshot_measurement(st->mv);
+        st->snapshot_fd = -1;
+    }
+    if (st->snapshot_fd == -1) {
+        start_software_measurement(st->mv); // Abandons any pre-measurement in progress
+    }
 }
 
 /**
- * Reads a fixed number of bytes from UART safely.
- * Ensures all expected bytes are received before returning.
+ * Answers every waiting request that accepts a measurement started at
+ * started_ns. Requests that need a newer one get a new measurement.
  *
- * @param fd UART file descriptor
- * @param buffer Pointer to the destination buffer
- * @param size Number of bytes to read
+ * @param st Prover state
+ * @param valid_state VS just measured
+ * @param started_ns When that measurement started
  */
-void safe_uart_read(int fd, uint8_t *buffer, size_t size) {
-    size_t received = 0;
-    while (received < size) {
-        ssize_t bytes_read = read(fd, buffer + received, size - received);
-        if (bytes_read > 0) {
-            received += bytes_read;
+static void answer_waiting(prover_state_t *st, const uint8_t *valid_state, uint64_t started_ns) {
+    int still_waiting = 0;
+    for (size_t i = 0; i < st->nlinks; i++) {
+        prover_link_t *l = &st->links[i];
+        if (!l->waiting) continue;
+        if (l->not_before_ns > started_ns) {
+            still_waiting = 1;
+            continue;
         }
+        l->waiting = 0;
+        answer_request(st, l, valid_state);
+        link_update_events(st, l);
+        st->ready |= 1u << i; // The next request may already be buffered
     }
+    if (still_waiting) start_request_measurement(st);
 }
 
 /**
- * Writes a fixed number of bytes to UART safely.
- * Ensures all bytes are transmitted before returning.
+ * Receives the link's next request frame without blocking. Garbage and
+ * damaged frames are skipped by the frame receiver; frames of other types or
+ * sizes are dropped here.
  *
- * @param fd UART file descriptor
- * @param buffer Pointer to the data to be sent
- * @param size Number of bytes to write
+ * @param l Link
+ * @return 1 if a request was decoded into l->request, 0 if the UART had nothing
+ *         more, -1 if the peer has hung up
  */
-void safe_uart_write(int fd, uint8_t *buffer, size_t size) {
-    size_t sent = 0;
-    while (sent < size) {
-        ssize_t bytes_written = write(fd, buffer + sent, size - sent);
-        if (bytes_written > 0) {
-            sent += bytes_written;
+static int receive_request(prover_link_t *l) {
+    frame_t frame;
+    while (1) {
+        while (frame_rx_next(&l->rx, &frame)) {
+            if (frame.type != FRAME_REQUEST || frame.length != SIMPLE_REQUEST_SIZE) continue;
+            simple_decode_request(frame.payload, &l->request);
+            return 1;
+        }
+        if (l->rx.skipped != l->skipped_logged) {
+            printf("%s Resynchronized: skipped %llu bytes (%llu CRC errors so far)\n", l->tag,
+                   (unsigned long long)(l->rx.skipped - l->skipped_logged),
+                   (unsigned long long)l->rx.crc_errors);
+            l->skipped_logged = l->rx.skipped;
         }
+
+        size_t space;
+        uint8_t *tail = frame_rx_space(&l->rx, &space);
+        ssize_t n = read(l->fd, tail, space);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) return -1; // EOF, or EIO from a PTY without master
+        if (n < 0) return 0;
+        frame_rx_commit(&l->rx, n);
     }
 }
 
-int main() {
-    initialize_keys(); // Load cryptographic keys at startup
+/**
+ * Handles at most one request from a link.
+ * Once a complete, fresh request is in, answers it from the cached VS if that
+ * is younger than the verifier's bound, joins a measurement in progress that
+ * is recent enough, or waits for a new one. Further input from the link stays
+ * buffered until the request is answered.
+ *
+ * @param st Prover state
+ * @param l Link
+ * @return 1 if a request was handled, 0 if the link had nothing to read
+ */
+static int link_task(prover_state_t *st, prover_link_t *l) {
+    if (l->waiting || l->fd == -1) return 0;
 
-    int uart_fd = open_uart("/dev/pts/8"); // Open simulated UART connection
-    if (uart_fd == -1) return -1; // Exit if UART cannot be opened
+    int received = receive_request(l);
+    if (received == -1) link_close(st, l, "peer hung up");
+    if (received != 1) return 0;
+    l->request_ns = timing_now_ns();
 
-    while (1) { // Continuous loop to handle multiple attestation requests
-        uint32_t C_V;
-        uint8_t valid_state[KEY_SIZE], nonce[NONCE_SIZE], received_hmac[OUTPUT_SIZE];
+    uint32_t max_age_ms = l->request.max_age_ms;
+    TRACE3(request_receive, st->device_id, l->request.counter, max_age_ms);
+    printf("%s Received C_V: %u (max measurement age %ums)\n", l->tag, l->request.counter, max_age_ms);
 
-        printf("[PROVER] Waiting for attestation request...\n");
+    // Check counter freshness before spending any measurement work on the request
+    simple_report_t report;
+    if (simple_prover_check_request(l->prover, &l->request, &report) == SIMPLE_ERR_REPLAY) {
+        TRACE3(request_reject, st->device_id, l->request.counter, SIMPLE_ERR_REPLAY);
+        printf("%s  C_P >= C_V, rejecting attestation request\n", l->tag);
+        link_send_report(st, l, &report); // Report failure (0 flag)
+        wait_for_request(l);
+        return 1;
+    }
 
-        // Read attestation request: { C_V, Valid Software State, Nonce, HMAC }
-        safe_uart_read(uart_fd, (uint8_t *)&C_V, COUNTER_SIZE);
-        safe_uart_read(uart_fd, valid_state, KEY_SIZE);
-        safe_uart_read(uart_fd, nonce, NONCE_SIZE);
-        safe_uart_read(uart_fd, received_hmac, OUTPUT_SIZE);
+    // Bounded work per forged frame: admission, then one HMAC, never a measurement
+    if (l->admit) {
+        int admitted = admit_request(l->admit, l->request_ns);
+        if (admitted != ADMIT_OK) {
+            TRACE3(request_drop, st->device_id, l->request.counter, admitted);
+            return 1; // Dropped silently: logging every frame of a flood costs too
+        }
+        uint64_t dropped = l->admit->dropped_rate + l->admit->dropped_penalty;
+        if (dropped != l->dropped_logged) {
+            printf("%s Admission control dropped %llu requests (rate %llu, penalty %llu)\n", l->tag,
+                   (unsigned long long)(dropped - l->dropped_logged),
+                   (unsigned long long)l->admit->dropped_rate, (unsigned long long)l->admit->dropped_penalty);
+            l->dropped_logged = dropped;
+        }
+    }
+    TRACE3(mac_start, st->device_id, l->request.counter, 0);
+    int authentic = simple_prover_authenticate(l->prover, &l->request) == SIMPLE_OK;
+    TRACE4(mac_done, st->device_id, l->request.counter, 0, authentic ? SIMPLE_OK : SIMPLE_ERR_MAC);
+    if (l->admit) admit_result(l->admit, authentic, l->request_ns);
+    if (!authentic) {
+        TRACE3(request_reject, st->device_id, l->request.counter, SIMPLE_ERR_MAC);
+        printf("%s  Attestation FAILED! (request not authentic)\n", l->tag);
+        wait_for_request(l);
+        return 1;
+    }
 
-        printf("[PROVER] Received C_V: %u\n", C_V);
+    // Measurements that started at or after this instant are fresh enough
+    uint64_t max_age_ns = (uint64_t)max_age_ms * 1000000;
+    l->not_before_ns = l->request_ns > max_age_ns ? l->request_ns - max_age_ns : 0;
 
-        // Check counter freshness: Reject if C_P >= C_V (prevents replay attacks)
-        if (C_P >= C_V) {
-            printf("[PROVER]  C_P >= C_V, rejecting attestation request\n");
-            uint8_t report[1 + OUTPUT_SIZE] = {0}; // Report failure (0 flag)
-            safe_uart_write(uart_fd, report, sizeof(report));
-            continue; // Skip processing this request
+    if (st->premeasure) {
+        uint8_t valid_state[MV_STATE_SIZE];
+        uint64_t measured_ns;
+        if (get_cached_software_state(st->mv, valid_state, l->not_before_ns, &measured_ns)) {
+            printf("%s Using pre-measured VS (age %.1fms)\n", l->tag, (l->request_ns - measured_ns) / 1e6);
+            answer_request(st, l, valid_state);
+            return 1;
         }
+    }
 
-        // Compute expected HMAC using received parameters
-        uint8_t expected_hmac[OUTPUT_SIZE];
-        compute_prover_hmac(C_V, nonce, expected_hmac);
+    l->waiting = 1;
+    link_update_events(st, l);
+    if (st->measuring != MEASURE_IDLE && measurement_started(st) >= l->not_before_ns) {
+        if (st->measuring == MEASURE_BACKGROUND) { // Pre-measurement in flight is recent enough: wait for it
+            st->measuring = MEASURE_REQUEST;
+            st->measure_start_ns = software_measurement_started(st->mv);
+        }
+        return 1;
+    }
+    if (st->measuring != MEASURE_REQUEST) start_request_measurement(st);
+    return 1; // Else answered by the next measurement, once the one in progress is done
+}
 
-        // Verify received HMAC against the expected value
-        if (memcmp(received_hmac, expected_hmac, OUTPUT_SIZE) == 0) {
-            // Update prover counter to match verifier counter
-            C_P = C_V;
+/**
+ * Scheduler task: serves every link that is readable, or writable with
+ * reports queued, without blocking. Each link gets at most one request per
+ * pass, so a busy or slow link cannot hold up the others.
+ *
+ * @param arg Prover state
+ * @return 1 if a request was handled or no link is left, 0 if no link had anything to read
+ */
+static int uart_task(void *arg) {
+    prover_state_t *st = arg;
+    struct epoll_event events[PROVER_MAX_LINKS];
+    uint32_t ready = st->ready;
+    st->ready = 0;
+
+    int n = epoll_wait(st->epoll_fd, events, PROVER_MAX_LINKS, 0);
+    for (int i = 0; i < n; i++) {
+        prover_link_t *l = &st->links[events[i].data.u32];
+        if (events[i].events & EPOLLOUT) {
+            link_flush(l);
+            link_update_events(st, l);
+        }
+        if ((events[i].events & (EPOLLERR | EPOLLHUP)) && l->waiting) {
+            link_close(st, l, "peer hung up"); // Input is not read while waiting: nothing else notices
+        } else if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+            ready |= 1u << events[i].data.u32; // Reading reports a hangup once the input is drained
+        }
+    }
 
-            // Prepare successful attestation report
-            uint8_t report[1 + OUTPUT_SIZE] = {1}; // Success flag (1)
-            compute_prover_hmac(C_P, nonce, report + 1); // Compute final HMAC
-            safe_uart_write(uart_fd, report, sizeof(report)); // Send report
+    int busy = 0;
+    for (size_t i = 0; i < st->nlinks; i++) {
+        if (!((ready >> i) & 1) || !link_task(st, &st->links[i])) continue;
+        st->ready |= 1u << i; // More frames may be buffered: look again on the next pass
+        busy = 1;
+    }
+    return busy || !st->open_links; // Nothing left to sleep on: return to main instead
+}
 
-            printf("[PROVER]  Attestation SUCCESS!\n");
-        } else {
-            printf("[PROVER]  Attestation FAILED!\n");
+/**
+ * Scheduler task: advances the software measurement by one slice (or checks
+ * on the background snapshot). Once it completes, answers the requests
+ * waiting for it or, for a pre-measurement, just leaves the result in the cache.
+ *
+ * @param arg Prover state
+ * @return 1 while a sliced measurement still has work left or requests were just answered
+ */
+static int measurement_task(void *arg) {
+    prover_state_t *st = arg;
+    uint8_t valid_state[MV_STATE_SIZE];
+    if (st->measuring == MEASURE_IDLE) return 0;
+
+    if (st->snapshot_fd != -1) {
+        uint64_t pause_ns, total_ns;
+        int done = poll_snapshot_measurement(st->mv, valid_state, &pause_ns, &total_ns);
+        if (done == 0) return 0; // Child still hashing: sleep until snapshot_fd is readable
+
+        sched_unwatch_fd(st->sched, st->snapshot_fd);
+        st->snapshot_fd = -1;
+        if (done == -1) { // Snapshot lost: measure inline instead
+            start_software_measurement(st->mv);
+            return 1;
         }
+        st->measuring = MEASURE_IDLE;
+        printf("[PROVER] Snapshot measurement: paused %.1fus, total %.1fus\n",
+               pause_ns / 1e3, total_ns / 1e3);
+        answer_waiting(st, valid_state, st->measure_start_ns);
+        return 1;
     }
 
-    close(uart_fd); // Close UART connection (never reached in infinite loop)
+    st->slices++;
+    if (!step_software_measurement(st->mv, st->slice_bytes)) return 1;
+
+    uint64_t started_ns = software_measurement_started(st->mv);
+    finish_software_measurement(st->mv, valid_state); // Also refreshes the cached VS
+    measure_mode_t mode = st->measuring;
+    st->measuring = MEASURE_IDLE;
+    if (mode == MEASURE_BACKGROUND) return 0;
+
+    printf("[PROVER] Measurement took %.1fus in %u slices\n",
+           (timing_now_ns() - st->measure_start_ns) / 1e3, st->slices);
+    answer_waiting(st, valid_state, started_ns);
+    return 1;
+}
+
+/**
+ * Prints each link's counter and traffic.
+ *
+ * @param st Prover state
+ */
+static void print_link_stats(prover_state_t *st) {
+    for (size_t i = 0; i < st->nlinks; i++) {
+        prover_link_t *l = &st->links[i];
+        printf("%s %s: C_P %u, %llu requests answered, %llu frames received, %zu bytes queued, "
+               "%llu reports dropped\n", l->tag, l->device, l->prover->counter, (unsigned long long)l->answered,
+               (unsigned long long)l->rx.frames, l->tx_len, (unsigned long long)l->tx_dropped);
+    }
+}
+
+/**
+ * Scheduler task (periodic): starts an idle-time pre-measurement so the
+ * cached VS never gets older than one period. Skipped while a request is
+ * being measured; its result refreshes the cache anyway.
+ *
+ * @param arg Prover state
+ * @return 0 (periodic task)
+ */
+static int premeasure_task(void *arg) {
+    prover_state_t *st = arg;
+    if (st->measuring != MEASURE_IDLE) return 0;
+
+    st->measuring = MEASURE_BACKGROUND;
+    st->slices = 0;
+    st->measure_start_ns = timing_now_ns();
+    start_software_measurement(st->mv);
     return 0;
 }
 
+/**
+ * Scheduler task: one step of a simulated real-time control loop.
+ * Stands in for the application work attestation must not delay; the
+ * scheduler records how late each step starts.
+ *
+ * @param arg Simulated plant state (double)
+ * @return 0 (periodic task)
+ */
+static int control_task(void *arg) {
+    volatile double *plant = arg;
+    *plant += 0.1 * (1.0 - *plant); // Proportional step towards the setpoint
+    return 0;
+}
+
+/**
+ * Serves time-bounded software-based attestation (SWATT mode).
+ * Used on devices without isolation hardware: each request is a framed nonce,
+ * answered with the memory traversal checksum as fast as possible. There is
+ * no logging between receiving the nonce and sending the checksum, since any
+ * extra work counts against the verifier's response-time bound. A challenge
+ * damaged on the wire fails its CRC and goes unanswered; the next one is
+ * read in step.
+ *
+ * @param uart_fd UART file descriptor
+ */
+void run_timed_attestation(int uart_fd) {
+    static uint8_t image[SWATT_IMAGE_SIZE] __attribute__((aligned(64)));
+    static frame_rx_t rx;
+    swatt_build_image(image, sizeof(image)); // Stand-in for the prover's memory
+    frame_rx_init(&rx);
+
+    while (1) {
+        uint8_t checksum[SWATT_OUTPUT_SIZE];
+        frame_t frame;
+
+        printf("[PROVER] Waiting for timed attestation challenge...\n");
+        do {
+            uart_read_frame_until(uart_fd, &rx, &frame, UINT64_MAX);
+        } while (frame.type != FRAME_SWATT_CHALLENGE || frame.length != SWATT_NONCE_SIZE);
+
+        swatt_checksum(image, sizeof(image), frame.payload, SWATT_ITERATIONS, checksum);
+        uart_write_frame(uart_fd, FRAME_SWATT_CHECKSUM, checksum, SWATT_OUTPUT_SIZE);
+
+        hex_dump("[PROVER] Sent Checksum", checksum, SWATT_OUTPUT_SIZE);
+    }
+}
+
+/**
+ * Reads the device's key pair from its key source: the keystore, the master
+ * secret, or kauth.key/kattest.key.
+ *
+ * @param src Key source
+ * @param kauth Buffer receiving Kauth
+ * @param kattest Buffer receiving Kattest
+ * @return 0 on success, -1 if the keys could not be read
+ */
+static int read_device_keys(const key_source_t *src, uint8_t *kauth, uint8_t *kattest) {
+    keystore_t store;
+    if (src->master_file) {
+        // Stands in for factory provisioning: the device only ever holds its own keys
+        uint8_t master[MV_KEY_SIZE];
+        mac_key_t prk;
+        mv_keys_t keys;
+        if (load_key_from_file(master, src->master_file) == -1) return -1;
+        keycache_root(&prk, master, sizeof(master));
+        keycache_derive(&prk, src->device_id, &keys);
+        memcpy(kauth, keys.kauth, MV_KEY_SIZE);
+        memcpy(kattest, keys.kattest, MV_KEY_SIZE);
+        memset(master, 0, sizeof(master));
+        memset(&prk, 0, sizeof(prk));
+        memset(&keys, 0, sizeof(keys));
+        return 0;
+    }
+    if (src->keystore_file) {
+        if (keystore_open(&store, src->keystore_file) == -1) return -1;
+    } else {
+        keystore_open_files(&store, "kauth.key", "kattest.key");
+    }
+    int found = keystore_lookup(&store, src->keystore_file ? src->device_id : 0, kauth, kattest);
+    keystore_close(&store);
+    return found;
+}
+
+/**
+ * Rotates the keys whenever SIGHUP arrives. Runs in its own thread, so the
+ * key schedule happens off the attestation path; requests in flight keep
+ * using the keys they pinned and never wait for the rotation.
+ *
+ * @param arg Key source (key_source_t)
+ * @return Never returns
+ */
+static void *key_rotation_thread(void *arg) {
+    const key_source_t *src = arg;
+    sigset_t hup;
+    sigemptyset(&hup);
+    sigaddset(&hup, SIGHUP);
+
+    while (1) {
+        uint8_t kauth[MV_KEY_SIZE], kattest[MV_KEY_SIZE];
+        int sig;
+        if (sigwait(&hup, &sig) != 0) continue;
+
+        if (read_device_keys(src, kauth, kattest) == 0) {
+            microvisor_rotate_keys(&mv, kauth, kattest, src->grace_ms);
+            printf("[PROVER] Keys rotated, previous keys accepted for %ums\n", src->grace_ms);
+        } else {
+            fprintf(stderr, "[PROVER] Key rotation failed, keeping the current keys\n");
+        }
+        memset(kauth, 0, sizeof(kauth));
+        memset(kattest, 0, sizeof(kattest));
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    int timed = 0;                             // -t: time-bounded software-based attestation
+    uint32_t control_period_us = 0;            // -c: simulated control loop period (0: off)
+    size_t slice_bytes = MEASURE_SLICE_BYTES;  // -S: measurement bytes per scheduler slice
+    int use_snapshot = 0;                      // -f: measure a fork/COW snapshot in the background
+    int self_measure = 0;                      // -s: measure the prover's own loaded segments
+    uint32_t premeasure_ms = 0;                // -p: idle-time re-measurement period (0: off)
+    static key_source_t keysrc;                // -K/-k/-i: where the keys come from
+    int rotate = 0;                            // -r: rotate keys on SIGHUP with this grace period
+    uint32_t admit_rate = 0;                   // -A: requests authenticated per second (0: no admission control)
+    const char *devices[PROVER_MAX_LINKS];     // -l: serial links to serve (default /dev/pts/8)
+    size_t ndevices = 0;
+    int opt;
+    while ((opt = getopt(argc, argv, "tc:S:fsp:K:k:i:r:A:l:")) != -1) {
+        if (opt == 'l' && ndevices < PROVER_MAX_LINKS) {
+            devices[ndevices++] = optarg;
+        } else if (opt == 't') {
+            timed = 1;
+        } else if (opt == 'f') {
+            use_snapshot = 1;
+        } else if (opt == 's') {
+            self_measure = 1;
+        } else if (opt == 'c') {
+            control_period_us = (uint32_t)strtoul(optarg, NULL, 10);
+        } else if (opt == 'S') {
+            slice_bytes = (size_t)strtoul(optarg, NULL, 10);
+        } else if (opt == 'p') {
+            premeasure_ms = (uint32_t)strtoul(optarg, NULL, 10);
+        } else if (opt == 'K') {
+            keysrc.master_file = optarg;
+        } else if (opt == 'k') {
+            keysrc.keystore_file = optarg;
+        } else if (opt == 'i') {
+            keysrc.device_id = (uint32_t)strtoul(optarg, NULL, 10);
+        } else if (opt == 'A') {
+            admit_rate = (uint32_t)strtoul(optarg, NULL, 10);
+        } else if (opt == 'r') {
+            rotate = 1;
+            keysrc.grace_ms = (uint32_t)strtoul(optarg, NULL, 10);
+        } else {
+            fprintf(stderr, "Usage: %s [-t] [-c control_period_us] [-S slice_bytes] [-f] [-s] [-p premeasure_ms] "
+                            "[-K master_key_file | -k keystore_file] [-i device_id] [-r grace_ms] [-A admit_per_s] "
+                            "[-l device]...\n", argv[0]);
+            return -1;
+        }
+    }
+    if (slice_bytes == 0) slice_bytes = MEASURE_SLICE_BYTES;
+    if (ndevices == 0) devices[ndevices++] = "/dev/pts/8"; // Simulated UART connection
+
+    static prover_link_t links[PROVER_MAX_LINKS];
+    for (size_t i = 0; i < ndevices; i++) {
+        links[i].device = devices[i];
+        links[i].fd = open_uart(devices[i], "[PROVER]");
+        if (links[i].fd == -1) return -1; // Exit if a UART cannot be opened
+        if (ndevices == 1) snprintf(links[i].tag, sizeof(links[i].tag), "[PROVER]");
+        else snprintf(links[i].tag, sizeof(links[i].tag), "[PROVER link %zu]", i);
+    }
+
+    if (timed) {
+        run_timed_attestation(links[0].fd); // No keys to load: nothing can hold them securely
+        return 0;
+    }
+
+    size_t secure_size;
+    int locked;
+    if (secarena_protect_section(&secure_size, &locked) == -1) return -1;
+    printf("[PROVER] Secure data: %zu KiB between guard pages, %s\n", secure_size / 1024,
+           locked ? "locked in RAM" : "NOT locked (raise RLIMIT_MEMLOCK)");
+
+    microvisor_init(&mv);
+    mv.verbose = 1;
+    if (keysrc.keystore_file || keysrc.master_file) {
+        uint8_t kauth[MV_KEY_SIZE], kattest[MV_KEY_SIZE];
+        if (read_device_keys(&keysrc, kauth, kattest) == -1) {
+            fprintf(stderr, "[PROVER] No keys for device %u\n", keysrc.device_id);
+            return -1;
+        }
+        microvisor_set_keys(&mv, kauth, kattest);
+        memset(kauth, 0, sizeof(kauth));
+        memset(kattest, 0, sizeof(kattest));
+        printf("[PROVER] Provisioned keys of device %u%s\n", keysrc.device_id,
+               keysrc.keystore_file ? " from the keystore" : "");
+    } else {
+        initialize_keys(&mv); // Load cryptographic keys at startup
+    }
+    if (rotate) {
+        // Only the rotation thread takes SIGHUP; it inherits the blocked mask
+        sigset_t hup;
+        pthread_t rotation;
+        sigemptyset(&hup);
+        sigaddset(&hup, SIGHUP);
+        pthread_sigmask(SIG_BLOCK, &hup, NULL);
+        if (pthread_create(&rotation, NULL, key_rotation_thread, &keysrc) != 0) {
+            fprintf(stderr, "[PROVER] Failed to start the key rotation thread\n");
+            return -1;
+        }
+        printf("[PROVER] Rotating keys on SIGHUP (grace period %ums)\n", keysrc.grace_ms);
+    }
+    for (size_t i = 0; i < ndevices; i++) {
+        simple_prover_init(&provers[i], &mv);
+        provers[i].verbose = 1;
+    }
+
+    if (self_measure) {
+        // VS now reflects the running binary; the verifier needs its digest as golden value
+        static __attribute__((section(".secure_data"))) selfmeasure_t self;
+        uint8_t digest[MEASURE_DIGEST_SIZE];
+        selfmeasure_init(&self);
+        use_self_measurement(&mv, &self);
+        compute_software_measurement(&mv, digest);
+        if (self.skipped) { // The digest would vouch for code it never covered
+            fprintf(stderr, "[PROVER] Self-measurement cannot cover all loaded segments\n");
+            return -1;
+        }
+        hex_dump("[PROVER] Self-measurement digest (verifier -m)", digest, MEASURE_DIGEST_SIZE);
+    }
+
+    // Interleave request handling and measurement with the application tasks
+    static uint64_t control_samples[1024];
+    static double plant = 0.0;
+    sched_t sched;
+    static admit_t admission[PROVER_MAX_LINKS];
+    if (admit_rate) {
+        printf("[PROVER] Admission control: %u requests/s per link, penalty %u..%ums after failed MACs\n",
+               admit_rate, ADMIT_PENALTY_BASE_MS, ADMIT_PENALTY_MAX_MS);
+    }
+    prover_state_t state = {
+        .links = links, .nlinks = ndevices, .open_links = ndevices, .device_id = keysrc.device_id, .mv = &mv, .slice_bytes = slice_bytes,
+        .use_snapshot = use_snapshot, .snapshot_fd = -1, .premeasure = premeasure_ms != 0, .sched = &sched,
+    };
+
+    // All links in one epoll set: the scheduler sleeps until any of them has input
+    state.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (state.epoll_fd == -1) {
+        perror("[PROVER] Failed to create epoll instance");
+        return -1;
+    }
+    for (size_t i = 0; i < ndevices; i++) {
+        prover_link_t *l = &links[i];
+        struct epoll_event ev = { .events = EPOLLIN, .data.u32 = (uint32_t)i };
+        if (epoll_ctl(state.epoll_fd, EPOLL_CTL_ADD, l->fd, &ev) == -1) {
+            perror("[PROVER] Failed to watch link");
+            return -1;
+        }
+        l->events = EPOLLIN;
+        l->prover = &provers[i];
+        if (admit_rate) {
+            admit_init(&admission[i], admit_rate, 0, timing_now_ns());
+            l->admit = &admission[i];
+        }
+        frame_rx_init(&l->rx);
+    }
+    if (ndevices > 1) {
+        for (size_t i = 0; i < ndevices; i++) printf("%s Serving %s\n", links[i].tag, links[i].device);
+    }
+    sched_task_t tasks[4];
+    size_t ntasks = 0;
+    tasks[ntasks++] = (sched_task_t){ "uart", uart_task, &state, 0 };
+    tasks[ntasks++] = (sched_task_t){ "measure", measurement_task, &state, 0 };
+    if (premeasure_ms) {
+        tasks[ntasks++] = (sched_task_t){ "premeasure", premeasure_task, &state, (uint64_t)premeasure_ms * 1000000 };
+    }
+    for (size_t i = 0; i < ntasks; i++) lat_stats_init(&tasks[i].lateness, NULL, 0);
+    if (control_period_us) {
+        tasks[ntasks] = (sched_task_t){ "control", control_task, (void *)&plant, (uint64_t)control_period_us * 1000 };
+        lat_stats_init(&tasks[ntasks].lateness, control_samples, sizeof(control_samples) / sizeof(control_samples[0]));
+        state.control = &tasks[ntasks++];
+    }
+
+    sched_init(&sched, tasks, ntasks, state.epoll_fd);
+    if (premeasure_ms) premeasure_task(&state); // Have a cached VS before the first request
+    for (size_t i = 0; i < ndevices; i++) wait_for_request(&links[i]);
+    signal(SIGUSR1, on_sigusr1);
+    while (state.open_links) { // Handle attestation requests as long as a verifier is connected
+        sched_run_once(&sched);
+        if (dump_call_stats) {
+            dump_call_stats = 0;
+            microvisor_print_call_stats(&mv, "[PROVER]");
+            print_link_stats(&state);
+        }
+    }
+
+    fprintf(stderr, "[PROVER] All links closed, exiting\n");
+    print_link_stats(&state);
+    close(state.epoll_fd);
+    return 1;
+}
+
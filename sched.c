@@ -0,0 +1,112 @@
+#define _GNU_SOURCE // ppoll
+#include <stdint.h>
+#include <poll.h>
+#include "sched.h"
+
+/**
+ * Initialize a cooperative scheduler over a fixed task table.
+ * Periodic tasks are first released one period from now. Each task's
+ * lateness recorder must already be initialized by the caller.
+ *
+ * @param sched Scheduler to initialize
+ * @param tasks Task table (owned by the caller)
+ * @param ntasks Number of tasks
+ * @param wait_fd Descriptor whose readability wakes the scheduler when idle
+ *                (-1: none; more can be added with sched_watch_fd)
+ */
+void sched_init(sched_t *sched, sched_task_t *tasks, size_t ntasks, int wait_fd) {
+    uint64_t now = timing_now_ns();
+    for (size_t i = 0; i < ntasks; i++) {
+        tasks[i].next_ns = now + tasks[i].period_ns;
+    }
+    sched->tasks = tasks;
+    sched->ntasks = ntasks;
+    sched->nwait = 0;
+    if (wait_fd >= 0) sched_watch_fd(sched, wait_fd);
+}
+
+/**
+ * Add a descriptor whose readability wakes the scheduler from an idle sleep.
+ * Tasks waiting on I/O other than the main link register their descriptor
+ * here and return 0 instead of spinning.
+ *
+ * @param sched Scheduler
+ * @param fd Descriptor to watch
+ * @return 0 on success, -1 if SCHED_MAX_WAIT_FDS are already watched
+ */
+int sched_watch_fd(sched_t *sched, int fd) {
+    if (sched->nwait == SCHED_MAX_WAIT_FDS) return -1;
+    sched->wait_fds[sched->nwait++] = fd;
+    return 0;
+}
+
+/**
+ * Stop watching a descriptor added with sched_watch_fd.
+ *
+ * @param sched Scheduler
+ * @param fd Descriptor to remove
+ */
+void sched_unwatch_fd(sched_t *sched, int fd) {
+    for (size_t i = 0; i < sched->nwait; i++) {
+        if (sched->wait_fds[i] == fd) {
+            sched->wait_fds[i] = sched->wait_fds[--sched->nwait];
+            return;
+        }
+    }
+}
+
+/**
+ * Run every periodic task that is due, then one slice of every background
+ * task. Periodic tasks are checked first on every pass, so the latency they
+ * see is bounded by the longest single background slice. When no background
+ * task has work left, sleep on the watched descriptors until the next
+ * periodic release.
+ *
+ * @param sched Scheduler to run
+ */
+void sched_run_once(sched_t *sched) {
+    int busy = 0;
+    uint64_t now = timing_now_ns();
+
+    for (size_t i = 0; i < sched->ntasks; i++) {
+        sched_task_t *t = &sched->tasks[i];
+        if (t->period_ns == 0 || now < t->next_ns) continue;
+
+        lat_stats_record(&t->lateness, now - t->next_ns);
+        t->run(t->arg);
+
+        // Skip releases that were missed entirely instead of bursting to catch up
+        while (t->next_ns <= now) t->next_ns += t->period_ns;
+        now = timing_now_ns();
+    }
+
+    for (size_t i = 0; i < sched->ntasks; i++) {
+        sched_task_t *t = &sched->tasks[i];
+        if (t->period_ns == 0) busy |= t->run(t->arg);
+    }
+    if (busy) return;
+
+    // Idle: sleep until the descriptor is readable or the next periodic release
+    uint64_t wake_ns = UINT64_MAX;
+    for (size_t i = 0; i < sched->ntasks; i++) {
+        sched_task_t *t = &sched->tasks[i];
+        if (t->period_ns != 0 && t->next_ns < wake_ns) wake_ns = t->next_ns;
+    }
+    if (sched->nwait == 0 && wake_ns == UINT64_MAX) return;
+
+    struct timespec timeout, *tp = NULL;
+    if (wake_ns != UINT64_MAX) {
+        now = timing_now_ns();
+        uint64_t wait = wake_ns > now ? wake_ns - now : 0;
+        timeout.tv_sec = wait / 1000000000ull;
+        timeout.tv_nsec = wait % 1000000000ull;
+        tp = &timeout;
+    }
+
+    struct pollfd pfds[SCHED_MAX_WAIT_FDS];
+    for (size_t i = 0; i < sched->nwait; i++) {
+        pfds[i].fd = sched->wait_fds[i];
+        pfds[i].events = POLLIN;
+    }
+    ppoll(pfds, sched->nwait, tp, NULL);
+}
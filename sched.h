@@ -0,0 +1,34 @@
+#ifndef SCHED_H
+#define SCHED_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "timing.h"
+
+// A cooperatively scheduled task. run() must do a bounded amount of work and
+// return: 1 if it has more work ready right away, 0 if it is idle.
+typedef struct {
+    const char *name;
+    int (*run)(void *arg);
+    void *arg;
+    uint64_t period_ns;   // 0: background task, run whenever it has work
+    uint64_t next_ns;     // Next release time of a periodic task
+    lat_stats_t lateness; // Release-to-start delay of a periodic task
+} sched_task_t;
+
+#define SCHED_MAX_WAIT_FDS 8 // Descriptors the scheduler can sleep on at once
+
+typedef struct {
+    sched_task_t *tasks;
+    size_t ntasks;
+    int wait_fds[SCHED_MAX_WAIT_FDS]; // Descriptors whose readability ends an idle sleep
+    size_t nwait;
+} sched_t;
+
+// Function prototypes
+void sched_init(sched_t *sched, sched_task_t *tasks, size_t ntasks, int wait_fd);
+void sched_run_once(sched_t *sched);
+int sched_watch_fd(sched_t *sched, int fd);
+void sched_unwatch_fd(sched_t *sched, int fd);
+
+#endif // SCHED_H
@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "secarena.h"
+
+/*
+ * Secure memory on a hosted system.
+ *
+ * On the target, `.secure_data` is RAM only the microvisor can reach. Here the
+ * best a process can do is keep its secrets off the disk and away from stray
+ * pointers: mlock keeps the pages out of swap and faults them in up front, so
+ * the hot path never takes a page fault; MADV_DONTDUMP keeps them out of core
+ * dumps; PROT_NONE pages on both sides turn a linear overrun into a fault
+ * instead of a silent read or write of key material.
+ */
+
+// Bounds of `.secure_data`, defined by memory.ld. Weak, so binaries linked
+// without the script still link; the symbols are then NULL.
+extern uint8_t __secure_data_start[] __attribute__((weak));
+extern uint8_t __secure_data_end[] __attribute__((weak));
+
+static size_t page_size(void) {
+    return (size_t)sysconf(_SC_PAGESIZE);
+}
+
+/**
+ * Lock and hide a page-aligned range that holds secrets.
+ *
+ * @return 1 if the range is locked, 0 if only prefaulted
+ */
+static int lock_range(uint8_t *base, size_t size) {
+    madvise(base, size, MADV_DONTDUMP);
+    if (mlock(base, size) == 0) return 1;
+    for (size_t i = 0; i < size; i += page_size()) ((volatile uint8_t *)base)[i] = base[i];
+    return 0;
+}
+
+/**
+ * Map an arena between two guard pages and lock it.
+ * A failed mlock (RLIMIT_MEMLOCK) is not fatal: the arena still works, but
+ * a.locked stays 0 so the caller can warn.
+ *
+ * @param a Arena to set up
+ * @param size Usable bytes, rounded up to whole pages
+ * @return 0 on success, -1 if the memory could not be mapped
+ */
+int secarena_create(secarena_t *a, size_t size) {
+    size_t page = page_size();
+    memset(a, 0, sizeof(*a));
+    size = (size + page - 1) / page * page;
+    if (size == 0) size = page;
+
+    uint8_t *map = mmap(NULL, size + 2 * page, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) {
+        perror("[SECARENA] Failed to map arena");
+        return -1;
+    }
+    if (mprotect(map + page, size, PROT_READ | PROT_WRITE) == -1) {
+        perror("[SECARENA] Failed to unprotect arena");
+        munmap(map, size + 2 * page);
+        return -1;
+    }
+    a->base = map + page;
+    a->size = size;
+    a->locked = lock_range(a->base, size);
+    return 0;
+}
+
+/**
+ * Take memory from the arena. It is zeroed and never returned individually;
+ * secarena_destroy releases everything at once.
+ *
+ * @param a Arena from secarena_create
+ * @param size Bytes needed
+ * @param align Alignment, a power of two
+ * @return The memory, or NULL if the arena is full
+ */
+void *secarena_alloc(secarena_t *a, size_t size, size_t align) {
+    size_t offset = (a->used + align - 1) & ~(align - 1);
+    if (!a->base || offset > a->size || size > a->size - offset) return NULL;
+    a->used = offset + size;
+    return a->base + offset;
+}
+
+/**
+ * Wipe and unmap an arena, guard pages included.
+ *
+ * @param a Arena from secarena_create (unmapped arenas are ignored)
+ */
+void secarena_destroy(secarena_t *a) {
+    if (a->base) {
+        size_t page = page_size();
+        explicit_bzero(a->base, a->size);
+        if (a->locked) munlock(a->base, a->size);
+        munmap(a->base - page, a->size + 2 * page);
+    }
+    memset(a, 0, sizeof(*a));
+}
+
+/**
+ * Lock the `.secure_data` section laid out by memory.ld and arm the guard
+ * pages the script reserves around it. Call once at startup, before keys are
+ * loaded.
+ *
+ * @param size Receives the section size in bytes (may be NULL)
+ * @param locked Receives 1 if the section is locked in RAM (may be NULL)
+ * @return 0 on success, -1 if the binary was not linked with memory.ld
+ */
+int secarena_protect_section(size_t *size, int *locked) {
+    size_t page = page_size();
+    uint8_t *start = __secure_data_start, *end = __secure_data_end;
+    if (!start || !end || ((uintptr_t)start | (uintptr_t)end) % page) {
+        fprintf(stderr, "[SECARENA] .secure_data is not page-aligned (link with -T memory.ld)\n");
+        return -1;
+    }
+
+    if (mprotect(start - page, page, PROT_NONE) == -1 || mprotect(end, page, PROT_NONE) == -1) {
+        perror("[SECARENA] Failed to arm guard pages");
+        return -1;
+    }
+    int is_locked = lock_range(start, (size_t)(end - start));
+    if (size) *size = (size_t)(end - start);
+    if (locked) *locked = is_locked;
+    return 0;
+}
@@ -0,0 +1,24 @@
+#ifndef SECARENA_H
+#define SECARENA_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Page-aligned memory for keys and derived state. The usable pages sit between
+// two inaccessible guard pages, are locked in RAM (no swap, no page faults on
+// use) and are left out of core dumps. Allocation is a bump pointer, so what is
+// allocated together stays contiguous.
+typedef struct {
+    uint8_t *base;     // First usable byte, NULL when not mapped
+    size_t size;       // Usable bytes, a multiple of the page size
+    size_t used;
+    int locked;        // mlock succeeded (else the pages are only prefaulted)
+} secarena_t;
+
+// Function prototypes
+int secarena_create(secarena_t *a, size_t size);
+void *secarena_alloc(secarena_t *a, size_t size, size_t align);
+void secarena_destroy(secarena_t *a);
+int secarena_protect_section(size_t *size, int *locked);
+
+#endif // SECARENA_H
@@ -0,0 +1,174 @@
+#define _GNU_SOURCE // dl_iterate_phdr
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <link.h>
+#include <sys/stat.h>
+#include "selfmeasure.h"
+
+/*
+ * Self-measurement of the code that is actually running.
+ *
+ * The measured regions are the executable and read-only PT_LOAD segments of
+ * every object loaded into the process (the program itself and its shared
+ * libraries), enumerated with dl_iterate_phdr. Text and rodata carry no
+ * relocations, so their contents do not depend on where ASLR placed them.
+ *
+ * Hashing megabytes of libraries on every request would be wasteful, so each
+ * segment keeps its digest and is only re-hashed when it may have changed:
+ *  - relocated: the object was (re)loaded at another address or with another
+ *    size (dlopen/dlclose), so there is no previous digest to reuse;
+ *  - replaced on disk: the backing file's device/inode/mtime changed;
+ *  - modified in memory: a private file mapping that is written to gets an
+ *    anonymous copy-on-write page. /proc/self/pagemap shows every present page
+ *    of an unmodified segment as file-backed, so one 8-byte entry per page
+ *    (instead of 4 KiB of hashing) proves the segment is untouched.
+ * Without pagemap access nothing can be proven, and every segment is hashed.
+ */
+
+#define PAGEMAP_PRESENT (1ull << 63)
+#define PAGEMAP_SWAPPED (1ull << 62)
+#define PAGEMAP_FILE    (1ull << 61)
+#define PAGEMAP_BATCH   512 // Entries read per pread
+
+/**
+ * dl_iterate_phdr callback: collect the non-writable PT_LOAD segments of one
+ * loaded object. The vDSO is skipped; it is supplied by the kernel, not by
+ * the prover's software.
+ */
+static int scan_object(struct dl_phdr_info *info, size_t size, void *arg) {
+    selfmeasure_t *scan = arg;
+    const char *name = info->dlpi_name ? info->dlpi_name : "";
+    if (strncmp(name, "linux-vdso", 10) == 0 || strncmp(name, "linux-gate", 10) == 0) return 0;
+
+    for (int i = 0; i < info->dlpi_phnum; i++) {
+        const ElfW(Phdr) *ph = &info->dlpi_phdr[i];
+        if (ph->p_type != PT_LOAD || (ph->p_flags & PF_W) || ph->p_memsz == 0) continue;
+        if (scan->scan_count == SELFMEASURE_MAX_SEGMENTS) { // Table full: count what is left out
+            scan->skipped++;
+            continue;
+        }
+
+        measure_region_t *r = &scan->scan_regions[scan->scan_count];
+        segment_origin_t *o = &scan->scan_origins[scan->scan_count];
+        memset(r, 0, sizeof(*r));
+        memset(o, 0, sizeof(*o));
+        r->base = (const uint8_t *)(info->dlpi_addr + ph->p_vaddr);
+        r->len = ph->p_memsz;
+        snprintf(o->path, sizeof(o->path), "%s", name);
+        scan->scan_count++;
+    }
+    return 0;
+}
+
+/**
+ * Look up the identity of the file backing a segment.
+ *
+ * @param o Origin whose path is set; dev/ino/mtime are filled in
+ * @return 0 on success, -1 if the file cannot be examined
+ */
+static int stat_origin(segment_origin_t *o) {
+    struct stat st;
+    if (stat(o->path[0] ? o->path : "/proc/self/exe", &st) == -1) return -1;
+    o->dev = st.st_dev;
+    o->ino = st.st_ino;
+    o->mtime = st.st_mtim;
+    return 0;
+}
+
+static int same_origin(const segment_origin_t *a, const segment_origin_t *b) {
+    return strcmp(a->path, b->path) == 0 && a->dev == b->dev && a->ino == b->ino &&
+           a->mtime.tv_sec == b->mtime.tv_sec && a->mtime.tv_nsec == b->mtime.tv_nsec;
+}
+
+/**
+ * Check that no page of a segment has been written since it was mapped.
+ *
+ * @param self Segment table owning the pagemap descriptor
+ * @param r Segment to check
+ * @return 1 if every page is still the original file page, 0 otherwise
+ */
+static int segment_unmodified(selfmeasure_t *self, const measure_region_t *r) {
+    if (self->pagemap_fd == -2) self->pagemap_fd = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+    if (self->pagemap_fd < 0) return 0;
+
+    uintptr_t page_size = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t page = (uintptr_t)r->base / page_size;
+    uintptr_t last = ((uintptr_t)r->base + r->len - 1) / page_size;
+    uint64_t entries[PAGEMAP_BATCH];
+
+    while (page <= last) {
+        size_t n = last - page + 1 < PAGEMAP_BATCH ? last - page + 1 : PAGEMAP_BATCH;
+        ssize_t want = (ssize_t)(n * sizeof(uint64_t));
+        if (pread(self->pagemap_fd, entries, want, (off_t)(page * sizeof(uint64_t))) != want) return 0;
+
+        for (size_t i = 0; i < n; i++) {
+            // Swapped or present-but-anonymous: the page was copied on write
+            if (entries[i] & PAGEMAP_SWAPPED) return 0;
+            if ((entries[i] & PAGEMAP_PRESENT) && !(entries[i] & PAGEMAP_FILE)) return 0;
+        }
+        page += n;
+    }
+    return 1;
+}
+
+/**
+ * Prepare an empty segment table. Nothing is cached until the first refresh.
+ *
+ * @param self Segment table to initialize
+ */
+void selfmeasure_init(selfmeasure_t *self) {
+    memset(self, 0, sizeof(*self));
+    self->pagemap_fd = -2;
+}
+
+/**
+ * Enumerate the process's executable and read-only segments and decide which
+ * cached digests are still valid. Call before every measurement, and never
+ * while a measurement over the returned table is in progress.
+ *
+ * @param self Segment table from selfmeasure_init
+ * @param regions Receives the segment table to pass to the measurement engine
+ * @return Number of segments in the table; self->skipped counts those that did
+ *         not fit and are left out of the measurement
+ */
+size_t selfmeasure_refresh(selfmeasure_t *self, measure_region_t **regions) {
+    size_t was_skipped = self->skipped;
+    self->scan_count = 0;
+    self->skipped = 0;
+    dl_iterate_phdr(scan_object, self);
+    if (self->skipped && self->skipped != was_skipped) {
+        fprintf(stderr, "[SELFMEASURE] %zu segments beyond the first %d are NOT measured\n",
+                self->skipped, SELFMEASURE_MAX_SEGMENTS);
+    }
+
+    for (size_t i = 0; i < self->scan_count; i++) {
+        measure_region_t *r = &self->scan_regions[i];
+        segment_origin_t *o = &self->scan_origins[i];
+        int identified = stat_origin(o) == 0;
+
+        // Reuse the digest of the same segment (same object, address and size)
+        for (size_t j = 0; j < self->count; j++) {
+            const measure_region_t *prev = &self->segments[j];
+            if (prev->cached && prev->base == r->base && prev->len == r->len &&
+                identified && same_origin(&self->origins[j], o)) {
+                memcpy(r->digest, prev->digest, MEASURE_DIGEST_SIZE);
+                r->cached = 1;
+                break;
+            }
+        }
+
+        // The digest stays valid only while the pages provably match the file
+        r->cacheable = identified && segment_unmodified(self, r);
+        if (!r->cacheable) r->cached = 0;
+    }
+
+    memcpy(self->segments, self->scan_regions, self->scan_count * sizeof(measure_region_t));
+    memcpy(self->origins, self->scan_origins, self->scan_count * sizeof(segment_origin_t));
+    self->count = self->scan_count;
+
+    *regions = self->segments;
+    return self->count;
+}
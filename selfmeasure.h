@@ -0,0 +1,37 @@
+#ifndef SELFMEASURE_H
+#define SELFMEASURE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+#include <sys/types.h>
+#include "measure.h"
+
+#define SELFMEASURE_MAX_SEGMENTS 64 // Executable/read-only segments tracked
+
+// Where a segment's contents come from
+typedef struct {
+    char path[256];       // Backing object ("" for the main program)
+    dev_t dev;
+    ino_t ino;
+    struct timespec mtime;
+} segment_origin_t;
+
+// Segment table and cached digests of one self-measuring microvisor. VS is
+// derived from it, so the owner places it in secure memory.
+typedef struct {
+    measure_region_t segments[SELFMEASURE_MAX_SEGMENTS];
+    segment_origin_t origins[SELFMEASURE_MAX_SEGMENTS];
+    size_t count;
+    measure_region_t scan_regions[SELFMEASURE_MAX_SEGMENTS]; // Scratch for the next refresh
+    segment_origin_t scan_origins[SELFMEASURE_MAX_SEGMENTS];
+    size_t scan_count;
+    size_t skipped;       // Segments the last refresh found no room for: NOT measured
+    int pagemap_fd;       // -2: not opened yet, -1: unavailable
+} selfmeasure_t;
+
+// Function prototypes
+void selfmeasure_init(selfmeasure_t *self);
+size_t selfmeasure_refresh(selfmeasure_t *self, measure_region_t **regions);
+
+#endif // SELFMEASURE_H
@@ -0,0 +1,610 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/random.h>
+#include <openssl/crypto.h>
+#include "simple.h"
+
+/*
+ * Protocol core shared by the prover and the verifier binaries.
+ *
+ * Everything here works on caller-owned contexts and byte buffers: no
+ * globals, no I/O. Moving bytes over a UART (or anything else) is left to
+ * the caller, so one process can run any number of independent sessions.
+ */
+
+static void put_le32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t get_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+/**
+ * Serializes the part of a request covered by the HMAC: { C_V || VS || Nonce || MaxAge }.
+ *
+ * @param counter C_V
+ * @param vs Valid software state
+ * @param nonce Request nonce
+ * @param max_age_ms Accepted measurement age
+ * @param buf Buffer of SIMPLE_MAC_INPUT_SIZE bytes
+ */
+static void encode_mac_input(uint32_t counter, const uint8_t *vs, const uint8_t *nonce,
+                             uint32_t max_age_ms, uint8_t *buf) {
+    put_le32(buf, counter);
+    memcpy(buf + SIMPLE_COUNTER_SIZE, vs, MV_STATE_SIZE);
+    memcpy(buf + SIMPLE_COUNTER_SIZE + MV_STATE_SIZE, nonce, SIMPLE_NONCE_SIZE);
+    put_le32(buf + SIMPLE_COUNTER_SIZE + MV_STATE_SIZE + SIMPLE_NONCE_SIZE, max_age_ms);
+}
+
+/**
+ * Serializes an attestation request into its wire format.
+ * Integers are little-endian, matching what the original x86 build sent.
+ *
+ * @param req Request to encode
+ * @param buf Buffer of SIMPLE_REQUEST_SIZE bytes
+ */
+void simple_encode_request(const simple_request_t *req, uint8_t *buf) {
+    encode_mac_input(req->counter, req->vs, req->nonce, req->max_age_ms, buf);
+    memcpy(buf + SIMPLE_MAC_INPUT_SIZE, req->mac, SIMPLE_MAC_SIZE);
+}
+
+/**
+ * Parses an attestation request from its wire format.
+ *
+ * @param buf SIMPLE_REQUEST_SIZE bytes as received
+ * @param req Request to fill in
+ */
+void simple_decode_request(const uint8_t *buf, simple_request_t *req) {
+    req->counter = get_le32(buf);
+    memcpy(req->vs, buf + SIMPLE_COUNTER_SIZE, MV_STATE_SIZE);
+    memcpy(req->nonce, buf + SIMPLE_COUNTER_SIZE + MV_STATE_SIZE, SIMPLE_NONCE_SIZE);
+    req->max_age_ms = get_le32(buf + SIMPLE_COUNTER_SIZE + MV_STATE_SIZE + SIMPLE_NONCE_SIZE);
+    memcpy(req->mac, buf + SIMPLE_MAC_INPUT_SIZE, SIMPLE_MAC_SIZE);
+}
+
+/**
+ * Serializes an attestation report into its wire format.
+ *
+ * @param report Report to encode
+ * @param buf Buffer of SIMPLE_REPORT_SIZE bytes
+ */
+void simple_encode_report(const simple_report_t *report, uint8_t *buf) {
+    buf[0] = report->status;
+    memcpy(buf + 1, report->mac, SIMPLE_MAC_SIZE);
+}
+
+/**
+ * Parses an attestation report from its wire format.
+ *
+ * @param buf SIMPLE_REPORT_SIZE bytes as received
+ * @param report Report to fill in
+ */
+void simple_decode_report(const uint8_t *buf, simple_report_t *report) {
+    report->status = buf[0];
+    memcpy(report->mac, buf + 1, SIMPLE_MAC_SIZE);
+}
+
+/**
+ * Computes the protocol HMAC over { C_V, Valid Software State, Nonce, MaxAge } using Kauth.
+ *
+ * @param mv Microvisor holding Kauth
+ * @param counter Counter value (C_V)
+ * @param vs Valid software state
+ * @param nonce Request nonce
+ * @param max_age_ms Accepted measurement age in milliseconds
+ * @param output Buffer to store the computed HMAC
+ */
+void simple_compute_mac(microvisor_t *mv, uint32_t counter, const uint8_t *vs,
+                        const uint8_t *nonce, uint32_t max_age_ms, uint8_t *output) {
+    uint8_t hmac_input[SIMPLE_MAC_INPUT_SIZE];
+
+    encode_mac_input(counter, vs, nonce, max_age_ms, hmac_input);
+    microvisor_mac(mv, MV_KEY_AUTH, hmac_input, sizeof(hmac_input), output); // Keyed with Kauth
+}
+
+/**
+ * Computes the request HMAC and the HMAC of the successful report in one
+ * pass. The report MAC covers the same fields plus SIMPLE_REPORT_LABEL, so a
+ * report tag can never be mistaken for a request tag. The prover's counter
+ * equals C_V once it accepts the request, so both sides can compute it from
+ * the request.
+ *
+ * @param mv Microvisor the keys were pinned from
+ * @param keys Pinned keys holding Kauth
+ * @param req Request (counter, nonce and max age are used)
+ * @param vs Valid software state
+ * @param request_mac Receives the request HMAC
+ * @param report_mac Receives the report HMAC
+ */
+static void compute_macs(microvisor_t *mv, const mv_keys_t *keys, const simple_request_t *req,
+                         const uint8_t *vs, uint8_t *request_mac, uint8_t *report_mac) {
+    static const uint8_t label[] = SIMPLE_REPORT_LABEL;
+    uint8_t hmac_input[SIMPLE_MAC_INPUT_SIZE];
+
+    encode_mac_input(req->counter, vs, req->nonce, req->max_age_ms, hmac_input);
+    microvisor_mac_pair_with(mv, keys, hmac_input, sizeof(hmac_input), label, sizeof(label) - 1,
+                             request_mac, report_mac);
+}
+
+/**
+ * Generates a random nonce for an attestation request.
+ *
+ * @param nonce Buffer receiving SIMPLE_NONCE_SIZE bytes
+ * @return 0 on success, -1 if no randomness was available
+ */
+int simple_generate_nonce(uint8_t *nonce) {
+    size_t filled = 0;
+    while (filled < SIMPLE_NONCE_SIZE) {
+        ssize_t n = getrandom(nonce + filled, SIMPLE_NONCE_SIZE - filled, 0);
+        if (n <= 0) return -1;
+        filled += (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * Prepares the prover side of a session.
+ *
+ * @param p Prover context
+ * @param mv Microvisor with keys loaded; it must outlive the context
+ */
+void simple_prover_init(simple_prover_t *p, microvisor_t *mv) {
+    memset(p, 0, sizeof(*p));
+    p->mv = mv;
+}
+
+/**
+ * Checks counter freshness before any measurement work is spent on a request.
+ * A stale request is answered with a failure report right away.
+ *
+ * @param p Prover context
+ * @param req Decoded request
+ * @param report Receives the failure report to send if the request is rejected
+ * @return SIMPLE_OK, or SIMPLE_ERR_REPLAY if C_P >= C_V
+ */
+int simple_prover_check_request(simple_prover_t *p, const simple_request_t *req, simple_report_t *report) {
+    if (p->counter >= req->counter) { // Prevents replay attacks
+        memset(report, 0, sizeof(*report));
+        return SIMPLE_ERR_REPLAY;
+    }
+    return SIMPLE_OK;
+}
+
+/**
+ * Cheap authenticity check before any measurement: verifies the request HMAC
+ * over the VS the verifier claims instead of the prover's own. A forged
+ * request fails here for the cost of one HMAC and never triggers a
+ * measurement; whether the claimed VS is the prover's is still decided by
+ * simple_prover_answer, which then needs no second request HMAC. Accepts the
+ * previous keys during a grace period.
+ *
+ * @param p Prover context
+ * @param req Request that passed simple_prover_check_request
+ * @return SIMPLE_OK, or SIMPLE_ERR_MAC if the request was not made with Kauth
+ */
+int simple_prover_authenticate(simple_prover_t *p, const simple_request_t *req) {
+    uint8_t hmac_input[SIMPLE_MAC_INPUT_SIZE];
+    uint8_t expected_hmac[SIMPLE_MAC_SIZE];
+    int status = SIMPLE_ERR_MAC;
+
+    encode_mac_input(req->counter, req->vs, req->nonce, req->max_age_ms, hmac_input);
+    for (int which = MV_KEYS_CURRENT; which <= MV_KEYS_PREVIOUS && status != SIMPLE_OK; which++) {
+        mv_keys_ref_t ref;
+        if (microvisor_keys_get(p->mv, which, &ref) == -1) continue;
+        mac_compute(&ref.keys->kauth_mac, hmac_input, sizeof(hmac_input), expected_hmac);
+        if (CRYPTO_memcmp(req->mac, expected_hmac, SIMPLE_MAC_SIZE) == 0) {
+            status = SIMPLE_OK;
+            p->authenticated = *req;
+            p->auth_epoch = ref.keys->epoch;
+        }
+        microvisor_keys_put(p->mv, &ref);
+    }
+    return status;
+}
+
+/**
+ * Tells whether req is the request simple_prover_authenticate accepted last.
+ *
+ * @param p Prover context
+ * @param req Request about to be answered
+ * @return 1 if every field matches, 0 otherwise
+ */
+static int is_authenticated(const simple_prover_t *p, const simple_request_t *req) {
+    const simple_request_t *a = &p->authenticated;
+    return p->auth_epoch != 0 && a->counter == req->counter && a->max_age_ms == req->max_age_ms &&
+           memcmp(a->vs, req->vs, MV_STATE_SIZE) == 0 && memcmp(a->nonce, req->nonce, SIMPLE_NONCE_SIZE) == 0 &&
+           memcmp(a->mac, req->mac, SIMPLE_MAC_SIZE) == 0;
+}
+
+/**
+ * Answers a request simple_prover_authenticate has already verified. Its HMAC
+ * covers the claimed VS, so comparing that with the measured VS under the
+ * same keys stands in for recomputing the request HMAC; only the report tag
+ * is computed.
+ *
+ * @param p Prover context
+ * @param req Request accepted by simple_prover_authenticate
+ * @param vs Valid software state measured for this request
+ * @param ref Keys that authenticated the request
+ * @param report Receives the report to send (only on success)
+ * @return SIMPLE_OK, or SIMPLE_ERR_MAC if the measured VS is not the claimed one
+ */
+static int answer_authenticated(simple_prover_t *p, const simple_request_t *req, const uint8_t *vs,
+                                const mv_keys_ref_t *ref, simple_report_t *report) {
+    static const uint8_t label[] = SIMPLE_REPORT_LABEL;
+    uint8_t state[MV_STATE_SIZE];
+    uint8_t report_input[SIMPLE_MAC_INPUT_SIZE + sizeof(label) - 1];
+
+    microvisor_rebind_state(p->mv, vs, ref->keys, state); // VS under these keys' Kattest
+    if (CRYPTO_memcmp(state, req->vs, MV_STATE_SIZE) != 0) return SIMPLE_ERR_MAC;
+
+    // Update prover counter to match verifier counter
+    p->counter = req->counter;
+
+    // Successful attestation report, tagged under C_P (== C_V) with the report label
+    encode_mac_input(req->counter, state, req->nonce, req->max_age_ms, report_input);
+    memcpy(report_input + SIMPLE_MAC_INPUT_SIZE, label, sizeof(label) - 1);
+    report->status = 1;
+    microvisor_mac_with(p->mv, ref->keys, MV_KEY_AUTH, report_input, sizeof(report_input), report->mac);
+    if (p->verbose) hex_dump("[PROVER] Computed Report HMAC", report->mac, SIMPLE_MAC_SIZE);
+    return SIMPLE_OK;
+}
+
+/**
+ * Verifies a request with one key pair and, if it matches, builds the report
+ * with the same keys, so the verifier can check it with the keys it used.
+ *
+ * @param p Prover context
+ * @param req Request that passed simple_prover_check_request
+ * @param vs Valid software state measured for this request
+ * @param which MV_KEYS_CURRENT or MV_KEYS_PREVIOUS
+ * @param report Receives the report to send (only on success)
+ * @return SIMPLE_OK, or SIMPLE_ERR_MAC if there are no such keys or the HMAC does not match
+ */
+static int answer_with_keys(simple_prover_t *p, const simple_request_t *req, const uint8_t *vs,
+                            int which, simple_report_t *report) {
+    uint8_t state[MV_STATE_SIZE];
+    uint8_t expected_hmac[SIMPLE_MAC_SIZE], report_hmac[SIMPLE_MAC_SIZE];
+    mv_keys_ref_t ref;
+    if (microvisor_keys_get(p->mv, which, &ref) == -1) return SIMPLE_ERR_MAC;
+
+    microvisor_rebind_state(p->mv, vs, ref.keys, state); // VS under these keys' Kattest
+    compute_macs(p->mv, ref.keys, req, state, expected_hmac, report_hmac); // Check and report tag at once
+    if (p->verbose) hex_dump("[PROVER] Computed HMAC", expected_hmac, SIMPLE_MAC_SIZE);
+
+    int status = SIMPLE_ERR_MAC;
+    if (CRYPTO_memcmp(req->mac, expected_hmac, SIMPLE_MAC_SIZE) == 0) {
+        // Update prover counter to match verifier counter
+        p->counter = req->counter;
+
+        // Successful attestation report, tagged under C_P (== C_V) with the report label
+        report->status = 1;
+        memcpy(report->mac, report_hmac, SIMPLE_MAC_SIZE);
+        if (p->verbose) hex_dump("[PROVER] Computed Report HMAC", report->mac, SIMPLE_MAC_SIZE);
+        status = SIMPLE_OK;
+    }
+    memset(report_hmac, 0, sizeof(report_hmac));
+    microvisor_keys_put(p->mv, &ref);
+    return status;
+}
+
+/**
+ * Verifies a fresh request against the prover's measured VS and builds the report.
+ * During the grace period after a key rotation, requests made with the
+ * previous keys are accepted too. A request that simple_prover_authenticate
+ * just accepted is answered under the keys that accepted it, for one HMAC.
+ * On success the prover counter advances to C_V.
+ *
+ * @param p Prover context
+ * @param req Request that passed simple_prover_check_request
+ * @param vs Valid software state measured for this request
+ * @param report Receives the report to send (only on success)
+ * @return SIMPLE_OK, or SIMPLE_ERR_MAC if the request HMAC does not match
+ */
+int simple_prover_answer(simple_prover_t *p, const simple_request_t *req, const uint8_t *vs, simple_report_t *report) {
+    if (is_authenticated(p, req)) {
+        uint32_t epoch = p->auth_epoch;
+        p->auth_epoch = 0;
+        for (int which = MV_KEYS_CURRENT; which <= MV_KEYS_PREVIOUS; which++) {
+            mv_keys_ref_t ref;
+            if (microvisor_keys_get(p->mv, which, &ref) == -1) continue;
+            int found = ref.keys->epoch == epoch;
+            int status = found ? answer_authenticated(p, req, vs, &ref, report) : SIMPLE_ERR_MAC;
+            microvisor_keys_put(p->mv, &ref);
+            if (!found) continue;
+            if (status == SIMPLE_OK && which == MV_KEYS_PREVIOUS && p->verbose)
+                printf("[PROVER] Request authenticated with the previous keys (grace period)\n");
+            return status;
+        }
+        // Those keys expired while the request was measured: check it again from scratch
+    }
+
+    int status = answer_with_keys(p, req, vs, MV_KEYS_CURRENT, report);
+    if (status == SIMPLE_ERR_MAC && answer_with_keys(p, req, vs, MV_KEYS_PREVIOUS, report) == SIMPLE_OK) {
+        if (p->verbose) printf("[PROVER] Request authenticated with the previous keys (grace period)\n");
+        status = SIMPLE_OK;
+    }
+    return status;
+}
+
+/**
+ * Prepares the verifier side of a session.
+ *
+ * @param v Verifier context
+ * @param mv Microvisor with keys loaded; it must outlive the context
+ */
+void simple_verifier_init(simple_verifier_t *v, microvisor_t *mv) {
+    memset(v, 0, sizeof(*v));
+    v->mv = mv;
+}
+
+/**
+ * Computes the valid software state (VS) the prover is expected to have.
+ * With a golden measurement configured it is bound to Kattest directly;
+ * otherwise the verifier measures its own copy of the software.
+ *
+ * @param v Verifier context
+ * @param state Buffer where the expected VS will be stored
+ */
+void simple_verifier_expected_state(simple_verifier_t *v, uint8_t *state) {
+    if (v->expected_measurement) {
+        bind_software_measurement(v->mv, v->expected_measurement, state);
+    } else {
+        compute_valid_software_state(v->mv, state);
+    }
+}
+
+/**
+ * Builds the next attestation request: fresh nonce, incremented counter
+ * (C_V = C_V + 1), expected VS and the HMAC over them.
+ *
+ * @param v Verifier context
+ * @param req Request to fill in
+ * @return SIMPLE_OK, or -1 if no nonce could be generated
+ */
+int simple_verifier_build_request(simple_verifier_t *v, simple_request_t *req) {
+    if (simple_generate_nonce(req->nonce) == -1) return -1;
+    if (v->verbose) hex_dump("[VERIFIER] Generated Nonce", req->nonce, SIMPLE_NONCE_SIZE);
+
+    v->counter++; // Ensures freshness
+    req->counter = v->counter;
+    req->max_age_ms = v->max_age_ms;
+    simple_verifier_expected_state(v, req->vs);
+    simple_compute_mac(v->mv, req->counter, req->vs, req->nonce, req->max_age_ms, req->mac);
+    if (v->verbose) hex_dump("[VERIFIER] Computed HMAC", req->mac, SIMPLE_MAC_SIZE);
+    return SIMPLE_OK;
+}
+
+/**
+ * Prepares an empty pregeneration queue.
+ *
+ * @param q Queue to initialize
+ * @param slots Storage for capacity requests, owned by the caller
+ * @param capacity Requests kept ready ahead of time
+ */
+void simple_pregen_init(simple_pregen_t *q, simple_pregen_slot_t *slots, size_t capacity) {
+    q->slots = slots;
+    q->capacity = capacity;
+    q->head = 0;
+    q->count = 0;
+}
+
+/**
+ * Fills the pregeneration queue with the session's next requests, so that
+ * sending one later needs no computation. The batch shares the work that is
+ * the same for every request: one pinned key pair, one expected VS and one
+ * getrandom call per SIMPLE_PREGEN_CHUNK nonces, so the stack use does not
+ * grow with the queue. Each request also gets its expected report HMAC.
+ * Requests take consecutive counters, so they must be sent in queue order;
+ * a request that is dropped only leaves a gap, which the prover accepts.
+ *
+ * @param v Verifier context
+ * @param q Queue to top up
+ * @return Number of requests generated, or -1 if no keys are installed or no
+ *         nonces were available
+ *         (a partial batch is kept if nonces run out midway)
+ */
+int simple_verifier_pregenerate(simple_verifier_t *v, simple_pregen_t *q) {
+    size_t n = q->capacity - q->count;
+    uint8_t vs[MV_STATE_SIZE];
+    uint8_t nonces[SIMPLE_PREGEN_CHUNK * SIMPLE_NONCE_SIZE];
+    mv_keys_ref_t ref;
+    if (n == 0) return 0;
+
+    if (microvisor_keys_get(v->mv, MV_KEYS_CURRENT, &ref) == -1) return -1;
+    simple_verifier_expected_state(v, vs);
+    for (size_t i = 0; i < n; i++) {
+        size_t chunk = i % SIMPLE_PREGEN_CHUNK;
+        if (chunk == 0) { // Nonces for the next requests of the batch, one call per chunk
+            size_t want = (n - i < SIMPLE_PREGEN_CHUNK ? n - i : SIMPLE_PREGEN_CHUNK) * SIMPLE_NONCE_SIZE;
+            for (size_t filled = 0; filled < want; ) {
+                ssize_t got = getrandom(nonces + filled, want - filled, 0);
+                if (got <= 0) {
+                    microvisor_keys_put(v->mv, &ref);
+                    return i ? (int)i : -1;
+                }
+                filled += (size_t)got;
+            }
+        }
+        simple_pregen_slot_t *slot = &q->slots[(q->head + q->count) % q->capacity];
+        simple_request_t *req = &slot->request;
+
+        v->counter++; // Ensures freshness
+        req->counter = v->counter;
+        req->max_age_ms = v->max_age_ms;
+        memcpy(req->vs, vs, MV_STATE_SIZE);
+        memcpy(req->nonce, nonces + chunk * SIMPLE_NONCE_SIZE, SIMPLE_NONCE_SIZE);
+        compute_macs(v->mv, ref.keys, req, req->vs, req->mac, slot->report_mac);
+        if (v->verbose) hex_dump("[VERIFIER] Pregenerated HMAC", req->mac, SIMPLE_MAC_SIZE);
+        simple_encode_request(req, slot->frame);
+        slot->epoch = ref.keys->epoch;
+        q->count++;
+    }
+    microvisor_keys_put(v->mv, &ref);
+    return (int)n;
+}
+
+/**
+ * Takes the next pregenerated request for sending and arms the report check
+ * with its precomputed HMAC. Requests built with keys that have since been
+ * replaced are discarded.
+ *
+ * @param v Verifier context
+ * @param q Queue filled by simple_verifier_pregenerate
+ * @param req Receives the decoded request (for checking the report)
+ * @return Encoded request, valid until the queue is refilled, or NULL if
+ *         none is ready and the caller must build one itself
+ */
+const uint8_t *simple_verifier_take_request(simple_verifier_t *v, simple_pregen_t *q, simple_request_t *req) {
+    if (q->count == 0) return NULL;
+    simple_pregen_slot_t *slot = &q->slots[q->head];
+    if (slot->epoch != atomic_load(&v->mv->keys.epoch)) { // Keys changed: the batch is stale
+        q->count = 0;
+        return NULL;
+    }
+    q->head = (q->head + 1) % q->capacity;
+    q->count--;
+
+    *req = slot->request;
+    memcpy(v->expected_report, slot->report_mac, SIMPLE_MAC_SIZE);
+    v->expected_counter = req->counter;
+    return slot->frame;
+}
+
+/**
+ * Precomputes the HMAC of the report that answers a request. Call it once
+ * the request is sent, while the prover is busy: checking the report then
+ * costs only a constant-time comparison.
+ *
+ * @param v Verifier context
+ * @param req Request just sent
+ */
+void simple_verifier_expect_report(simple_verifier_t *v, const simple_request_t *req) {
+    mv_keys_ref_t ref;
+    microvisor_keys_get(v->mv, MV_KEYS_CURRENT, &ref);
+    uint8_t request_mac[SIMPLE_MAC_SIZE];
+    compute_macs(v->mv, ref.keys, req, req->vs, request_mac, v->expected_report);
+    microvisor_keys_put(v->mv, &ref);
+    v->expected_counter = req->counter;
+}
+
+/**
+ * Checks the prover's report for a request: the success flag and the HMAC.
+ * Uses the HMAC precomputed by simple_verifier_expect_report when there is
+ * one for this request.
+ *
+ * @param v Verifier context
+ * @param req Request the report answers
+ * @param report Decoded report
+ * @return SIMPLE_OK, SIMPLE_ERR_REPORT if the prover reported failure, or
+ *         SIMPLE_ERR_REPORT_MAC if the report is not authentic
+ */
+int simple_verifier_check_report(simple_verifier_t *v, const simple_request_t *req, const simple_report_t *report) {
+    if (report->status != 1) return SIMPLE_ERR_REPORT;
+    if (v->expected_counter != req->counter) simple_verifier_expect_report(v, req);
+    v->expected_counter = 0; // Invalidate the precomputed tag
+
+    if (CRYPTO_memcmp(report->mac, v->expected_report, SIMPLE_MAC_SIZE) != 0) return SIMPLE_ERR_REPORT_MAC;
+    return SIMPLE_OK;
+}
+
+/**
+ * Prepares an empty report pipeline.
+ *
+ * @param p Pipeline to initialize
+ * @param sink Called with the result of every report
+ * @param ctx First argument of the sink
+ */
+void simple_report_pipeline_init(simple_report_pipeline_t *p, simple_report_sink_t sink, void *ctx) {
+    memset(p, 0, sizeof(*p));
+    p->sink = sink;
+    p->sink_ctx = ctx;
+}
+
+/**
+ * Queues a received report for verification. A full batch is verified
+ * right away; otherwise call simple_report_pipeline_flush once no more
+ * reports are ready.
+ *
+ * @param p Report pipeline
+ * @param v Session that sent the request
+ * @param req Request the report answers; must stay valid until the sink runs
+ * @param report_buf Encoded report (SIMPLE_REPORT_SIZE bytes)
+ * @param user Passed to the sink with the result
+ */
+void simple_report_pipeline_push(simple_report_pipeline_t *p, simple_verifier_t *v, const simple_request_t *req,
+                                 const uint8_t *report_buf, void *user) {
+    simple_report_job_t *job = &p->jobs[p->count++];
+    job->verifier = v;
+    job->request = req;
+    job->user = user;
+    simple_decode_report(report_buf, &job->report);
+    if (p->count == SIMPLE_REPORT_BATCH) simple_report_pipeline_flush(p);
+}
+
+// Four 64-bit lanes: one report HMAC per vector
+typedef uint64_t simple_tag_vec_t __attribute__((vector_size(SIMPLE_MAC_SIZE)));
+
+/**
+ * Compares n pairs of tags without data-dependent branches or early exits:
+ * every pair costs the same whether it matches or not. The compiler maps
+ * the vector type onto whatever SIMD registers the target has.
+ *
+ * @param a First tags
+ * @param b Second tags
+ * @param n Number of pairs
+ * @param differ Receives, per pair, 0 if the tags are equal, nonzero otherwise
+ */
+static void compare_tags(const uint8_t (*a)[SIMPLE_MAC_SIZE], const uint8_t (*b)[SIMPLE_MAC_SIZE],
+                         size_t n, uint64_t *differ) {
+    for (size_t i = 0; i < n; i++) {
+        simple_tag_vec_t va, vb;
+        memcpy(&va, a[i], sizeof(va));
+        memcpy(&vb, b[i], sizeof(vb));
+        simple_tag_vec_t x = va ^ vb;
+        differ[i] = x[0] | x[1] | x[2] | x[3];
+    }
+}
+
+/**
+ * Verifies every queued report and hands the results to the sink. Expected
+ * tags precomputed by simple_verifier_expect_report or a pregenerated
+ * request are used as they are; missing ones are computed first. The tags
+ * are then compared as one batch.
+ *
+ * @param p Report pipeline
+ */
+void simple_report_pipeline_flush(simple_report_pipeline_t *p) {
+    uint8_t expected[SIMPLE_REPORT_BATCH][SIMPLE_MAC_SIZE];
+    uint8_t received[SIMPLE_REPORT_BATCH][SIMPLE_MAC_SIZE];
+    uint64_t differ[SIMPLE_REPORT_BATCH];
+    size_t n = p->count;
+    if (n == 0) return;
+
+    // Gather: expected and received tags side by side
+    for (size_t i = 0; i < n; i++) {
+        simple_report_job_t *job = &p->jobs[i];
+        simple_verifier_t *v = job->verifier;
+        if (v->expected_counter != job->request->counter) simple_verifier_expect_report(v, job->request);
+        v->expected_counter = 0; // Invalidate the precomputed tag
+        memcpy(expected[i], v->expected_report, SIMPLE_MAC_SIZE);
+        memcpy(received[i], job->report.mac, SIMPLE_MAC_SIZE);
+    }
+
+    compare_tags(expected, received, n, differ);
+
+    // Emit: same result codes as simple_verifier_check_report
+    p->count = 0;
+    p->reports += n;
+    p->batches++;
+    for (size_t i = 0; i < n; i++) {
+        int status = p->jobs[i].report.status != 1 ? SIMPLE_ERR_REPORT
+                   : differ[i] ? SIMPLE_ERR_REPORT_MAC : SIMPLE_OK;
+        p->sink(p->sink_ctx, p->jobs[i].user, status);
+    }
+}
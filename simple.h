@@ -0,0 +1,131 @@
+#ifndef SIMPLE_H
+#define SIMPLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "microvisor.h"
+
+#define SIMPLE_NONCE_SIZE 32   // Size of nonce (random challenge) in bytes
+#define SIMPLE_MAC_SIZE 32     // HMAC-SHA256 output size in bytes
+#define SIMPLE_COUNTER_SIZE 4  // Counter size (32-bit integer)
+#define SIMPLE_MAX_AGE_SIZE 4  // Accepted measurement age in milliseconds (32-bit integer)
+#define SIMPLE_MAC_INPUT_SIZE (SIMPLE_COUNTER_SIZE + MV_STATE_SIZE + SIMPLE_NONCE_SIZE + SIMPLE_MAX_AGE_SIZE)
+#define SIMPLE_REQUEST_SIZE (SIMPLE_MAC_INPUT_SIZE + SIMPLE_MAC_SIZE) // { C_V, VS, Nonce, MaxAge, HMAC }
+#define SIMPLE_REPORT_SIZE (1 + SIMPLE_MAC_SIZE)                      // { Flag, HMAC }
+#define SIMPLE_REPORT_LABEL "SIMPLE report" // Appended to the MAC input of reports
+
+// Result codes of the protocol functions
+#define SIMPLE_OK 0
+#define SIMPLE_ERR_REPLAY -1   // Request counter not newer than the prover's (C_P >= C_V)
+#define SIMPLE_ERR_MAC -2      // Request HMAC does not match the prover's VS
+#define SIMPLE_ERR_REPORT -3   // Prover reported a failed attestation
+#define SIMPLE_ERR_REPORT_MAC -4 // Report HMAC does not match the request
+
+// Attestation request: { C_V, VS, Nonce, MaxAge, HMAC }
+typedef struct {
+    uint32_t counter;                  // C_V
+    uint8_t vs[MV_STATE_SIZE];         // Valid software state expected by the verifier
+    uint8_t nonce[SIMPLE_NONCE_SIZE];
+    uint32_t max_age_ms;               // Oldest measurement the prover may answer with
+    uint8_t mac[SIMPLE_MAC_SIZE];      // HMAC(Kauth, C_V || VS || Nonce || MaxAge)
+} simple_request_t;
+
+// Attestation report: { Flag, HMAC }
+typedef struct {
+    uint8_t status;                    // 1: attestation succeeded, 0: failed
+    uint8_t mac[SIMPLE_MAC_SIZE];      // HMAC(Kauth, C_P || VS || Nonce || MaxAge || SIMPLE_REPORT_LABEL)
+} simple_report_t;
+
+// Prover side of one protocol instance. Contexts share nothing, so each
+// thread can drive its own; a single context is not thread-safe.
+typedef struct {
+    microvisor_t *mv;     // Secure world holding Kauth and producing VS
+    uint32_t counter;     // C_P: counter of the last accepted request
+    simple_request_t authenticated; // Last request simple_prover_authenticate accepted
+    uint32_t auth_epoch;  // Epoch of the keys that accepted it (0: none pending)
+    int verbose;          // Log MACs with hex_dump
+} simple_prover_t;
+
+// Verifier side of one protocol instance (same threading rules as the prover)
+typedef struct {
+    microvisor_t *mv;                     // Holds the keys shared with the prover
+    uint32_t counter;                     // C_V: counter of the last request sent
+    const uint8_t *expected_measurement;  // Golden measurement digest; NULL: measure locally
+    uint32_t max_age_ms;                  // Measurement age the prover may answer with
+    uint8_t expected_report[SIMPLE_MAC_SIZE]; // Report HMAC, precomputed while the prover works
+    uint32_t expected_counter;            // Request expected_report belongs to (0: none)
+    int verbose;
+} simple_verifier_t;
+
+#define SIMPLE_PREGEN_CHUNK 64  // Nonces drawn per getrandom call while pregenerating
+#define SIMPLE_PREGEN_MAX 4096   // Deepest pregeneration queue the tools accept
+
+// A request built ahead of time, ready to go on the wire
+typedef struct {
+    simple_request_t request;
+    uint8_t frame[SIMPLE_REQUEST_SIZE];        // Encoded request
+    uint8_t report_mac[SIMPLE_MAC_SIZE];       // HMAC the report must carry
+    uint32_t epoch;                            // Keys it was built with
+} simple_pregen_slot_t;
+
+// Requests pregenerated for one verifier session, oldest first. The caller
+// provides the slots, so idle sessions cost no memory beyond their table.
+typedef struct {
+    simple_pregen_slot_t *slots;
+    size_t capacity;
+    size_t head;                               // Oldest request
+    size_t count;
+} simple_pregen_t;
+
+#define SIMPLE_REPORT_BATCH 64  // Reports verified together by the report pipeline
+
+// Receives each verified report: the job's user pointer and its result code
+typedef void (*simple_report_sink_t)(void *ctx, void *user, int status);
+
+// A received report waiting in the pipeline
+typedef struct {
+    simple_verifier_t *verifier;          // Session that sent the request
+    const simple_request_t *request;      // Must stay valid until the sink is called
+    simple_report_t report;
+    void *user;
+} simple_report_job_t;
+
+// Report authentication as a pipeline stage: reports are collected and
+// verified in batches, and every result goes to the sink
+typedef struct {
+    simple_report_job_t jobs[SIMPLE_REPORT_BATCH];
+    size_t count;
+    simple_report_sink_t sink;
+    void *sink_ctx;
+    uint64_t reports;                     // Reports verified so far
+    uint64_t batches;
+} simple_report_pipeline_t;
+
+// Function prototypes
+void simple_encode_request(const simple_request_t *req, uint8_t *buf);
+void simple_decode_request(const uint8_t *buf, simple_request_t *req);
+void simple_encode_report(const simple_report_t *report, uint8_t *buf);
+void simple_decode_report(const uint8_t *buf, simple_report_t *report);
+void simple_compute_mac(microvisor_t *mv, uint32_t counter, const uint8_t *vs,
+                        const uint8_t *nonce, uint32_t max_age_ms, uint8_t *output);
+int simple_generate_nonce(uint8_t *nonce);
+
+void simple_prover_init(simple_prover_t *p, microvisor_t *mv);
+int simple_prover_check_request(simple_prover_t *p, const simple_request_t *req, simple_report_t *report);
+int simple_prover_authenticate(simple_prover_t *p, const simple_request_t *req);
+int simple_prover_answer(simple_prover_t *p, const simple_request_t *req, const uint8_t *vs, simple_report_t *report);
+
+void simple_verifier_init(simple_verifier_t *v, microvisor_t *mv);
+void simple_verifier_expected_state(simple_verifier_t *v, uint8_t *state);
+int simple_verifier_build_request(simple_verifier_t *v, simple_request_t *req);
+void simple_verifier_expect_report(simple_verifier_t *v, const simple_request_t *req);
+void simple_report_pipeline_init(simple_report_pipeline_t *p, simple_report_sink_t sink, void *ctx);
+void simple_report_pipeline_push(simple_report_pipeline_t *p, simple_verifier_t *v, const simple_request_t *req,
+                                 const uint8_t *report_buf, void *user);
+void simple_report_pipeline_flush(simple_report_pipeline_t *p);
+void simple_pregen_init(simple_pregen_t *q, simple_pregen_slot_t *slots, size_t capacity);
+int simple_verifier_pregenerate(simple_verifier_t *v, simple_pregen_t *q);
+const uint8_t *simple_verifier_take_request(simple_verifier_t *v, simple_pregen_t *q, simple_request_t *req);
+int simple_verifier_check_report(simple_verifier_t *v, const simple_request_t *req, const simple_report_t *report);
+
+#endif // SIMPLE_H
@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include "snapshot.h"
+#include "timing.h"
+
+/*
+ * Copy-on-write snapshot measurement.
+ *
+ * Hashing memory that the application keeps modifying yields a digest of no
+ * consistent state, and stopping the application for the whole measurement
+ * is expensive. fork() gives the child a copy-on-write image of the address
+ * space frozen at one instant: the caller is paused only for the page table
+ * copy, then keeps running while the child hashes the snapshot and sends the
+ * digest back over a pipe. Pages the caller writes afterwards are copied by
+ * the kernel on first write, which is the remaining (amortized) cost.
+ */
+
+/**
+ * Snapshot the measured regions and start hashing them in the background.
+ *
+ * @param snap Snapshot state to fill in
+ * @param regions Regions to measure (as seen at the time of the call)
+ * @param nregions Number of regions
+ * @return 0 on success, -1 if the snapshot could not be taken
+ */
+int snapshot_begin(snapshot_t *snap, measure_region_t *regions, size_t nregions) {
+    int fds[2];
+    if (pipe(fds) == -1) {
+        perror("[SNAPSHOT] Failed to create pipe");
+        return -1;
+    }
+
+    snap->start_ns = timing_now_ns();
+    pid_t pid = fork();
+    if (pid == -1) {
+        perror("[SNAPSHOT] Failed to fork");
+        close(fds[0]);
+        close(fds[1]);
+        return -1;
+    }
+
+    if (pid == 0) {
+        // Child: hash the frozen image, hand back only the digest
+        measure_ctx_t ctx;
+        uint8_t digest[MEASURE_DIGEST_SIZE];
+
+        close(fds[0]);
+        measure_begin(&ctx, regions, nregions);
+        measure_step(&ctx, SIZE_MAX);
+        measure_finish(&ctx, digest);
+
+        ssize_t n = write(fds[1], digest, sizeof(digest));
+        _exit(n == (ssize_t)sizeof(digest) ? 0 : 1); // Skip atexit/stdio flushing of the parent's state
+    }
+
+    snap->pause_ns = timing_now_ns() - snap->start_ns;
+    close(fds[1]);
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    snap->pid = pid;
+    snap->fd = fds[0];
+    return 0;
+}
+
+/**
+ * Check whether the background measurement has finished.
+ * Never blocks; poll snap->fd for readability to wait efficiently. The
+ * digest is smaller than PIPE_BUF, so it always arrives in one read.
+ *
+ * @param snap Snapshot started with snapshot_begin
+ * @param digest Buffer receiving MEASURE_DIGEST_SIZE bytes when done
+ * @return 1 when the digest is available, 0 if still running, -1 on failure
+ */
+int snapshot_poll(snapshot_t *snap, uint8_t *digest) {
+    ssize_t n = read(snap->fd, digest, MEASURE_DIGEST_SIZE);
+    if (n == -1 && (errno == EAGAIN || errno == EINTR)) return 0;
+
+    snap->total_ns = timing_now_ns() - snap->start_ns;
+    close(snap->fd);
+    waitpid(snap->pid, NULL, 0); // Child exits right after writing
+    snap->pid = 0;
+    snap->fd = -1;
+
+    if (n != MEASURE_DIGEST_SIZE) {
+        fprintf(stderr, "[SNAPSHOT] Background measurement failed\n");
+        return -1;
+    }
+    return 1;
+}
+
+/**
+ * Abandon a background measurement: kill the child and close the pipe.
+ *
+ * @param snap Snapshot started with snapshot_begin
+ */
+void snapshot_cancel(snapshot_t *snap) {
+    if (snap->pid == 0) return;
+    kill(snap->pid, SIGKILL);
+    waitpid(snap->pid, NULL, 0);
+    close(snap->fd);
+    snap->pid = 0;
+    snap->fd = -1;
+}
@@ -0,0 +1,23 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include "measure.h"
+
+// A copy-on-write snapshot measurement running in a forked child
+typedef struct {
+    pid_t pid;          // Child hashing the snapshot (0 if none)
+    int fd;             // Read end of the pipe carrying the digest
+    uint64_t start_ns;  // When the snapshot was requested
+    uint64_t pause_ns;  // Time the caller was stopped to take the snapshot (fork)
+    uint64_t total_ns;  // Snapshot request to digest received
+} snapshot_t;
+
+// Function prototypes
+int snapshot_begin(snapshot_t *snap, measure_region_t *regions, size_t nregions);
+int snapshot_poll(snapshot_t *snap, uint8_t *digest);
+void snapshot_cancel(snapshot_t *snap);
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,408 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <openssl/crypto.h>
+#include "swarm.h"
+
+/*
+ * Swarm attestation over a spanning tree.
+ *
+ * Attesting N devices one by one costs the verifier N round trips and N
+ * report checks. Here the verifier sends one request to the root of a tree
+ * (daisy-chained UARTs, say), every member relays it to its children,
+ * answers with its own contribution
+ *     m_i = HMAC(Kauth_i, C_S || Nonce || i || VS_i || SWARM_LABEL)
+ * and forwards the XOR of its contribution and its children's aggregates. A
+ * child that does not answer is marked in a bitmap instead, together with
+ * its subtree. The verifier knows every Kauth_i and the golden VS_i, so it
+ * computes the expected contributions while it is idle; checking a healthy
+ * swarm is then one 32-byte comparison, plus one XOR per missing member.
+ *
+ * On a mismatch the verifier drills down: it asks members for the
+ * contribution and aggregate they sent, descends only into subtrees whose
+ * aggregate is wrong and blames a member whose own contribution is wrong, or
+ * whose subtree is wrong although all its parts are right (it forwarded a
+ * bad XOR). One bad member costs about fanout * depth queries.
+ *
+ * The request is authenticated with Kswarm, a key every member holds. A
+ * compromised member can forge requests with it, which makes others measure
+ * but cannot make them answer for software they do not run.
+ */
+
+static void put_le32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t get_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void xor_mac(uint8_t *into, const uint8_t *mac) {
+    for (size_t i = 0; i < MAC_SIZE; i++) into[i] ^= mac[i];
+}
+
+/**
+ * Serializes the MAC input of a contribution:
+ * { C_S || Nonce || Index || VS || SWARM_LABEL }.
+ *
+ * @return Length of the input
+ */
+static size_t encode_contribution(const swarm_request_t *req, uint32_t member, const uint8_t *vs, uint8_t *buf) {
+    put_le32(buf, req->counter);
+    memcpy(buf + SIMPLE_COUNTER_SIZE, req->nonce, SIMPLE_NONCE_SIZE);
+    put_le32(buf + SIMPLE_COUNTER_SIZE + SIMPLE_NONCE_SIZE, member);
+    memcpy(buf + 2 * SIMPLE_COUNTER_SIZE + SIMPLE_NONCE_SIZE, vs, MV_STATE_SIZE);
+    memcpy(buf + 2 * SIMPLE_COUNTER_SIZE + SIMPLE_NONCE_SIZE + MV_STATE_SIZE, SWARM_LABEL, sizeof(SWARM_LABEL) - 1);
+    return 2 * SIMPLE_COUNTER_SIZE + SIMPLE_NONCE_SIZE + MV_STATE_SIZE + sizeof(SWARM_LABEL) - 1;
+}
+
+static void request_mac(const mac_key_t *group, uint32_t counter, const uint8_t *nonce, uint8_t *out) {
+    uint8_t input[SIMPLE_COUNTER_SIZE + SIMPLE_NONCE_SIZE];
+    put_le32(input, counter);
+    memcpy(input + SIMPLE_COUNTER_SIZE, nonce, SIMPLE_NONCE_SIZE);
+    mac_compute(group, input, sizeof(input), out);
+}
+
+/**
+ * Derive Kswarm from the fleet PRK (see keycache.c).
+ *
+ * @param prk PRK from keycache_root
+ * @param group Receives Kswarm with its HMAC context precomputed
+ */
+void swarm_group_key(const mac_key_t *prk, mac_key_t *group) {
+    uint8_t key[MV_KEY_SIZE];
+    mac_hkdf_expand(prk, (const uint8_t *)SWARM_GROUP_INFO, sizeof(SWARM_GROUP_INFO) - 1, key);
+    mac_key_init(group, key, sizeof(key));
+    memset(key, 0, sizeof(key));
+}
+
+/**
+ * Parent of a member in the breadth-first numbered tree.
+ *
+ * @param member Any member but the root
+ * @param fanout Children per member
+ */
+uint32_t swarm_parent(uint32_t member, uint32_t fanout) {
+    return (member - 1) / fanout;
+}
+
+/**
+ * First child of a member; the others follow it. A child exists only if its
+ * index is below the member count.
+ */
+uint32_t swarm_first_child(uint32_t member, uint32_t fanout) {
+    return member * fanout + 1;
+}
+
+/**
+ * Number of hops from the root to the deepest member.
+ */
+uint32_t swarm_depth(uint32_t members, uint32_t fanout) {
+    uint32_t depth = 0;
+    for (uint32_t last = members ? members - 1 : 0; last > 0; last = swarm_parent(last, fanout)) depth++;
+    return depth;
+}
+
+/**
+ * Serializes a swarm request into its wire format.
+ *
+ * @param req Request to encode
+ * @param buf Buffer of SWARM_REQUEST_SIZE bytes
+ */
+void swarm_encode_request(const swarm_request_t *req, uint8_t *buf) {
+    put_le32(buf, req->counter);
+    memcpy(buf + SIMPLE_COUNTER_SIZE, req->nonce, SIMPLE_NONCE_SIZE);
+    memcpy(buf + SIMPLE_COUNTER_SIZE + SIMPLE_NONCE_SIZE, req->mac, SIMPLE_MAC_SIZE);
+}
+
+/**
+ * Parses a swarm request from its wire format.
+ *
+ * @param buf SWARM_REQUEST_SIZE bytes as received
+ * @param req Request to fill in
+ */
+void swarm_decode_request(const uint8_t *buf, swarm_request_t *req) {
+    req->counter = get_le32(buf);
+    memcpy(req->nonce, buf + SIMPLE_COUNTER_SIZE, SIMPLE_NONCE_SIZE);
+    memcpy(req->mac, buf + SIMPLE_COUNTER_SIZE + SIMPLE_NONCE_SIZE, SIMPLE_MAC_SIZE);
+}
+
+/**
+ * Initializes a member context.
+ *
+ * @param m Member to initialize
+ * @param mv Microvisor holding the device's keys
+ * @param group Kswarm; must outlive the member
+ * @param index Position in the tree
+ */
+void swarm_member_init(swarm_member_t *m, microvisor_t *mv, const mac_key_t *group, uint32_t index) {
+    memset(m, 0, sizeof(*m));
+    m->mv = mv;
+    m->group = group;
+    m->index = index;
+}
+
+/**
+ * Checks a swarm request before relaying and answering it. Rejected
+ * requests are neither relayed nor answered.
+ *
+ * @param m Member
+ * @param req Request received from the parent (or the verifier)
+ * @return SIMPLE_OK, SIMPLE_ERR_REPLAY or SIMPLE_ERR_MAC
+ */
+int swarm_member_accept(swarm_member_t *m, const swarm_request_t *req) {
+    uint8_t expected[SIMPLE_MAC_SIZE];
+    if (req->counter <= m->counter) return SIMPLE_ERR_REPLAY;
+    request_mac(m->group, req->counter, req->nonce, expected);
+    if (CRYPTO_memcmp(req->mac, expected, SIMPLE_MAC_SIZE) != 0) return SIMPLE_ERR_MAC;
+    m->counter = req->counter;
+    return SIMPLE_OK;
+}
+
+/**
+ * Starts the member's report with its own contribution. Children's reports
+ * are merged into it as they arrive.
+ *
+ * @param m Member that accepted req
+ * @param req Request of the round
+ * @param vs The member's valid software state
+ * @param report Report to initialize
+ */
+void swarm_member_contribute(swarm_member_t *m, const swarm_request_t *req, const uint8_t *vs, swarm_report_t *report) {
+    uint8_t input[2 * SIMPLE_COUNTER_SIZE + SIMPLE_NONCE_SIZE + MV_STATE_SIZE + sizeof(SWARM_LABEL)];
+    size_t len = encode_contribution(req, m->index, vs, input);
+    microvisor_mac(m->mv, MV_KEY_AUTH, input, len, m->own);
+
+    memcpy(report->agg, m->own, MAC_SIZE);
+    report->answered = 1;
+    memset(report->missing, 0, sizeof(report->missing));
+}
+
+/**
+ * Remembers what the member forwarded, for drill-down queries.
+ *
+ * @param m Member
+ * @param report Report of its whole subtree, as sent to the parent
+ */
+void swarm_member_forward(swarm_member_t *m, const swarm_report_t *report) {
+    memcpy(m->subtree, report->agg, MAC_SIZE);
+}
+
+/**
+ * Merges a child's report into its parent's.
+ *
+ * @param into Parent's report
+ * @param child Report received from the child
+ */
+void swarm_report_merge(swarm_report_t *into, const swarm_report_t *child) {
+    xor_mac(into->agg, child->agg);
+    into->answered += child->answered;
+    for (size_t w = 0; w < SWARM_BITMAP_WORDS; w++) into->missing[w] |= child->missing[w];
+}
+
+/**
+ * Marks a child that did not answer, and everything below it, as missing.
+ * Subtrees are contiguous on every level of the breadth-first numbering.
+ *
+ * @param r Parent's report
+ * @param child Child that did not answer
+ * @param members Members in the swarm
+ * @param fanout Children per member
+ */
+void swarm_report_mark_missing(swarm_report_t *r, uint32_t child, uint32_t members, uint32_t fanout) {
+    for (uint64_t lo = child, hi = child; lo < members; lo = lo * fanout + 1, hi = hi * fanout + fanout) {
+        for (uint64_t j = lo; j <= hi && j < members; j++) r->missing[j / 64] |= 1ull << (j % 64);
+    }
+}
+
+/**
+ * @return 1 if the report marks member as missing
+ */
+int swarm_report_is_missing(const swarm_report_t *r, uint32_t member) {
+    return (r->missing[member / 64] >> (member % 64)) & 1;
+}
+
+/**
+ * Removes the contributions of the missing members below (and including)
+ * root from an expected aggregate.
+ */
+static void exclude_missing(const swarm_verifier_t *v, const swarm_report_t *report, uint32_t root, uint8_t *expected) {
+    for (size_t w = 0; w < SWARM_BITMAP_WORDS; w++) {
+        for (uint64_t bits = report->missing[w]; bits; bits &= bits - 1) {
+            uint32_t j = (uint32_t)(w * 64 + __builtin_ctzll(bits)), k = j;
+            if (j >= v->members) continue;
+            while (k > root) k = swarm_parent(k, v->fanout);
+            if (k == root) xor_mac(expected, v->expected[j]);
+        }
+    }
+}
+
+/**
+ * Initializes a swarm verifier and computes the VS every member should
+ * answer with.
+ *
+ * @param v Verifier to initialize
+ * @param group Kswarm; must outlive the verifier
+ * @param keys Key cache with the members' keys (member i is device i)
+ * @param golden Golden measurement digest of the members' firmware
+ * @param members Swarm size, at most SWARM_MAX_MEMBERS
+ * @param fanout Children per member
+ * @return 0 on success, -1 on bad parameters or if memory could not be allocated
+ */
+int swarm_verifier_init(swarm_verifier_t *v, const mac_key_t *group, keycache_t *keys, const uint8_t *golden,
+                        uint32_t members, uint32_t fanout) {
+    memset(v, 0, sizeof(*v));
+    if (members == 0 || members > SWARM_MAX_MEMBERS || fanout == 0) return -1;
+    v->group = group;
+    v->keys = keys;
+    v->members = members;
+    v->fanout = fanout;
+    v->expected_vs = malloc(members * sizeof(*v->expected_vs));
+    v->expected = malloc(members * sizeof(*v->expected));
+    v->expected_subtree = malloc(members * sizeof(*v->expected_subtree));
+    if (!v->expected_vs || !v->expected || !v->expected_subtree) {
+        swarm_verifier_free(v);
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < members; i++) {
+        const mv_keys_t *k = keycache_get(keys, i);
+        if (!k) {
+            swarm_verifier_free(v);
+            return -1;
+        }
+        mac_compute(&k->kattest_mac, golden, MEASURE_DIGEST_SIZE, v->expected_vs[i]);
+    }
+    return 0;
+}
+
+/**
+ * Releases the verifier's tables.
+ */
+void swarm_verifier_free(swarm_verifier_t *v) {
+    free(v->expected_vs);
+    free(v->expected);
+    free(v->expected_subtree);
+    memset(v, 0, sizeof(*v));
+}
+
+/**
+ * Builds the next round's request and everything needed to check its
+ * report: one MAC per member plus one XOR per member for the subtree
+ * aggregates. Meant for idle time, between rounds.
+ *
+ * @param v Verifier
+ * @return SIMPLE_OK, or -1 if no nonce could be generated or a key is missing
+ */
+int swarm_verifier_prepare(swarm_verifier_t *v) {
+    swarm_request_t *req = &v->request;
+    if (simple_generate_nonce(req->nonce) == -1) return -1;
+    req->counter = ++v->counter;
+    request_mac(v->group, req->counter, req->nonce, req->mac);
+
+    uint8_t input[2 * SIMPLE_COUNTER_SIZE + SIMPLE_NONCE_SIZE + MV_STATE_SIZE + sizeof(SWARM_LABEL)];
+    for (uint32_t i = 0; i < v->members; i++) {
+        const mv_keys_t *k = keycache_get(v->keys, i);
+        if (!k) return -1;
+        size_t len = encode_contribution(req, i, v->expected_vs[i], input);
+        mac_compute(&k->kauth_mac, input, len, v->expected[i]);
+        memcpy(v->expected_subtree[i], v->expected[i], MAC_SIZE);
+    }
+    for (uint32_t i = v->members - 1; i > 0; i--) { // Children come after their parent
+        xor_mac(v->expected_subtree[swarm_parent(i, v->fanout)], v->expected_subtree[i]);
+    }
+    v->prepared = 1;
+    return SIMPLE_OK;
+}
+
+/**
+ * Hands out the prepared request, preparing it now if idle time did not.
+ *
+ * @param v Verifier
+ * @param req Receives the request to send to the root
+ * @return SIMPLE_OK, or -1 if the request could not be built
+ */
+int swarm_verifier_take_request(swarm_verifier_t *v, swarm_request_t *req) {
+    if (!v->prepared && swarm_verifier_prepare(v) == -1) return -1;
+    *req = v->request;
+    v->prepared = 0;
+    return SIMPLE_OK;
+}
+
+// State of one drill-down
+typedef struct {
+    swarm_verifier_t *v;
+    const swarm_report_t *report;
+    swarm_query_t query;
+    void *ctx;
+    uint32_t *suspects;
+    size_t max_suspects;
+    size_t count;
+} drill_t;
+
+static void blame(drill_t *d, uint32_t member) {
+    if (d->count < d->max_suspects) d->suspects[d->count] = member;
+    d->count++;
+}
+
+/**
+ * Localizes the fault below a member whose forwarded aggregate is wrong.
+ */
+static void drill(drill_t *d, uint32_t member, const uint8_t *own) {
+    swarm_verifier_t *v = d->v;
+    size_t before = d->count;
+
+    if (CRYPTO_memcmp(own, v->expected[member], MAC_SIZE) != 0) blame(d, member);
+    uint32_t first = swarm_first_child(member, v->fanout);
+    for (uint64_t c = first; c < (uint64_t)first + v->fanout && c < v->members; c++) {
+        if (swarm_report_is_missing(d->report, (uint32_t)c)) continue;
+
+        uint8_t child_own[MAC_SIZE], child_subtree[MAC_SIZE], expected[MAC_SIZE];
+        v->queries++;
+        if (d->query(d->ctx, (uint32_t)c, child_own, child_subtree) == -1) { // Answered the round, not the query
+            blame(d, (uint32_t)c);
+            continue;
+        }
+        memcpy(expected, v->expected_subtree[c], MAC_SIZE);
+        exclude_missing(v, d->report, (uint32_t)c, expected);
+        if (CRYPTO_memcmp(child_subtree, expected, MAC_SIZE) != 0) drill(d, (uint32_t)c, child_own);
+    }
+    if (d->count == before) blame(d, member); // Every part checks out: the member forwarded a bad XOR
+}
+
+/**
+ * Checks the root's report. A healthy swarm costs one comparison plus one
+ * XOR per missing member; only a mismatch triggers drill-down queries.
+ * Missing members are neither blamed nor vouched for: the caller reads them
+ * from the report's bitmap.
+ *
+ * @param v Verifier that built the request of this round
+ * @param report Aggregate report received from the root
+ * @param query Asks one member about the round (used only on a mismatch)
+ * @param ctx Passed to query
+ * @param suspects Receives members found at fault
+ * @param max_suspects Capacity of suspects
+ * @param nsuspects Receives the number of members at fault (may exceed max_suspects)
+ * @return SIMPLE_OK if every answering member runs the golden software, else SIMPLE_ERR_REPORT_MAC
+ */
+int swarm_verifier_check(swarm_verifier_t *v, const swarm_report_t *report, swarm_query_t query, void *ctx,
+                         uint32_t *suspects, size_t max_suspects, size_t *nsuspects) {
+    uint8_t expected[MAC_SIZE];
+    *nsuspects = 0;
+    if (swarm_report_is_missing(report, 0)) return SIMPLE_ERR_REPORT_MAC;
+
+    memcpy(expected, v->expected_subtree[0], MAC_SIZE);
+    exclude_missing(v, report, 0, expected);
+    if (CRYPTO_memcmp(report->agg, expected, MAC_SIZE) == 0) return SIMPLE_OK;
+
+    drill_t d = { v, report, query, ctx, suspects, max_suspects, 0 };
+    uint8_t own[MAC_SIZE], subtree[MAC_SIZE];
+    v->queries++;
+    if (query(ctx, 0, own, subtree) == -1) blame(&d, 0);
+    else drill(&d, 0, own);
+    *nsuspects = d.count;
+    return SIMPLE_ERR_REPORT_MAC;
+}
@@ -0,0 +1,87 @@
+#ifndef SWARM_H
+#define SWARM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "keycache.h"
+#include "mac.h"
+#include "microvisor.h"
+#include "simple.h"
+
+#define SWARM_MAX_MEMBERS 4096   // Devices in one swarm
+#define SWARM_BITMAP_WORDS (SWARM_MAX_MEMBERS / 64)
+#define SWARM_REQUEST_SIZE (SIMPLE_COUNTER_SIZE + SIMPLE_NONCE_SIZE + SIMPLE_MAC_SIZE) // { C_S, Nonce, HMAC }
+#define SWARM_GROUP_INFO "swarm"          // HKDF info of the key authenticating swarm requests
+#define SWARM_LABEL "SIMPLE swarm report" // Appended to the MAC input of contributions
+
+// Swarm attestation request, relayed unchanged from the root down the tree
+typedef struct {
+    uint32_t counter;                  // C_S: swarm round, shared by all members
+    uint8_t nonce[SIMPLE_NONCE_SIZE];
+    uint8_t mac[SIMPLE_MAC_SIZE];      // HMAC(Kswarm, C_S || Nonce)
+} swarm_request_t;
+
+// Aggregate report of a subtree: one XOR of MACs plus who is missing from it
+typedef struct {
+    uint8_t agg[MAC_SIZE];                  // XOR of the answering members' contributions
+    uint32_t answered;                      // Members included in agg
+    uint64_t missing[SWARM_BITMAP_WORDS];   // Members a parent could not reach
+} swarm_report_t;
+
+// One device's part in the swarm. Members are numbered in breadth-first
+// order, so the tree shape follows from the member count and the fanout.
+typedef struct {
+    microvisor_t *mv;                  // Device keys: Kauth signs the contribution
+    const mac_key_t *group;            // Kswarm, authenticates requests
+    uint32_t index;                    // Position in the tree (0: root)
+    uint32_t counter;                  // C_S of the last accepted request
+    uint8_t own[MAC_SIZE];             // Contribution to the last round
+    uint8_t subtree[MAC_SIZE];         // Aggregate forwarded in the last round
+} swarm_member_t;
+
+// Answers a drill-down query with a member's last contribution and forwarded
+// aggregate. Returns -1 if the member cannot be reached.
+typedef int (*swarm_query_t)(void *ctx, uint32_t member, uint8_t *own, uint8_t *subtree);
+
+// Verifier side of swarm attestation. The expected contribution of every
+// member, and their XOR per subtree, are computed ahead of each round, so a
+// healthy swarm costs the verifier one comparison.
+typedef struct {
+    const mac_key_t *group;
+    keycache_t *keys;                  // Member i is device i
+    uint32_t members;
+    uint32_t fanout;
+    uint32_t counter;                  // C_S of the last request built
+    uint8_t (*expected_vs)[MV_STATE_SIZE];   // Per member, from the golden measurement
+    uint8_t (*expected)[MAC_SIZE];           // Per member, for the prepared request
+    uint8_t (*expected_subtree)[MAC_SIZE];   // Per member: XOR over its subtree
+    swarm_request_t request;           // Prepared request
+    int prepared;
+    uint64_t queries;                  // Drill-down queries sent so far
+} swarm_verifier_t;
+
+// Function prototypes
+void swarm_group_key(const mac_key_t *prk, mac_key_t *group);
+uint32_t swarm_parent(uint32_t member, uint32_t fanout);
+uint32_t swarm_first_child(uint32_t member, uint32_t fanout);
+uint32_t swarm_depth(uint32_t members, uint32_t fanout);
+void swarm_encode_request(const swarm_request_t *req, uint8_t *buf);
+void swarm_decode_request(const uint8_t *buf, swarm_request_t *req);
+
+void swarm_member_init(swarm_member_t *m, microvisor_t *mv, const mac_key_t *group, uint32_t index);
+int swarm_member_accept(swarm_member_t *m, const swarm_request_t *req);
+void swarm_member_contribute(swarm_member_t *m, const swarm_request_t *req, const uint8_t *vs, swarm_report_t *report);
+void swarm_member_forward(swarm_member_t *m, const swarm_report_t *report);
+void swarm_report_merge(swarm_report_t *into, const swarm_report_t *child);
+void swarm_report_mark_missing(swarm_report_t *r, uint32_t child, uint32_t members, uint32_t fanout);
+int swarm_report_is_missing(const swarm_report_t *r, uint32_t member);
+
+int swarm_verifier_init(swarm_verifier_t *v, const mac_key_t *group, keycache_t *keys, const uint8_t *golden,
+                        uint32_t members, uint32_t fanout);
+void swarm_verifier_free(swarm_verifier_t *v);
+int swarm_verifier_prepare(swarm_verifier_t *v);
+int swarm_verifier_take_request(swarm_verifier_t *v, swarm_request_t *req);
+int swarm_verifier_check(swarm_verifier_t *v, const swarm_report_t *report, swarm_query_t query, void *ctx,
+                         uint32_t *suspects, size_t max_suspects, size_t *nsuspects);
+
+#endif // SWARM_H
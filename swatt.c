@@ -0,0 +1,108 @@
+#include <stdint.h>
+#include <string.h>
+#include <openssl/sha.h>
+#include "swatt.h"
+#include "microvisor.h"
+
+/*
+ * Time-bounded software-based attestation (SWATT/Pioneer style).
+ *
+ * Devices without isolation hardware cannot keep Kauth/Kattest secret, so
+ * instead of a MAC the prover answers a nonce with a checksum over its whole
+ * memory image. The verifier accepts the answer only if it is correct AND
+ * arrives within a tight time bound: any attempt to hide modified memory
+ * (redirecting reads to a clean copy, computing on the side) adds work to
+ * every single step and pushes the response past the bound.
+ *
+ * That argument only holds if the honest kernel is already as fast as the
+ * hardware allows, so the checksum loop is written so that the compiler has
+ * nothing left to remove and an attacker has nothing left to overlap:
+ *  - one strictly serial dependency chain: every address depends on the
+ *    previous checksum lane, so loads cannot be issued early or in parallel;
+ *  - eight checksum lanes held in registers and the loop unrolled by eight,
+ *    so lane selection costs nothing at runtime;
+ *  - each step mixes the PRNG output, the loaded word, the previous lane and
+ *    the address/iteration index, so a memory-copy attack must forge both
+ *    the data and the address it came from;
+ *  - the PRNG is the Klimov-Shamir T-function x += (x * x) | 5, a single
+ *    cycle permutation of 2^64 costing one multiply, one or and one add.
+ */
+
+#define SWATT_LANES 8
+
+static inline uint64_t rotl64(uint64_t v, int r) {
+    return (v << r) | (v >> (64 - r));
+}
+
+static inline uint64_t load64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/**
+ * Build the deterministic memory image that both sides checksum.
+ * The image stands in for the prover's firmware: SOFTWARE_CODE expanded with
+ * SHA-256 in counter mode to fill the whole region.
+ *
+ * @param image Destination buffer (8-byte aligned)
+ * @param len Size of the buffer in bytes (multiple of 32)
+ */
+void swatt_build_image(uint8_t *image, size_t len) {
+    uint8_t block[sizeof(SOFTWARE_CODE) - 1 + sizeof(uint32_t)];
+    memcpy(block, SOFTWARE_CODE, sizeof(SOFTWARE_CODE) - 1);
+
+    for (uint32_t i = 0; (size_t)i * SHA256_DIGEST_LENGTH < len; i++) {
+        memcpy(block + sizeof(SOFTWARE_CODE) - 1, &i, sizeof(i));
+        SHA256(block, sizeof(block), image + (size_t)i * SHA256_DIGEST_LENGTH);
+    }
+}
+
+// One checksum step: advance the PRNG, pick a data-dependent word, fold it in
+#define SWATT_STEP(cur, prev, k)                                    \
+    do {                                                            \
+        x += (x * x) | 5;                                           \
+        a = (x ^ (prev)) & mask;                                    \
+        (cur) += mem[a] ^ (prev) ^ x ^ ((a << 32) | (i + (k)));     \
+        (cur) = rotl64((cur), 1 + (k));                             \
+    } while (0)
+
+/**
+ * Compute the nonce-seeded pseudo-random memory traversal checksum.
+ *
+ * @param image Memory image to checksum (8-byte aligned)
+ * @param len Size of the image in bytes (power of two, at least 8)
+ * @param nonce SWATT_NONCE_SIZE-byte challenge from the verifier
+ * @param iterations Number of checksum steps (rounded up to a multiple of 8)
+ * @param output Buffer receiving SWATT_OUTPUT_SIZE bytes of checksum
+ */
+void swatt_checksum(const uint8_t *image, size_t len, const uint8_t *nonce,
+                    uint32_t iterations, uint8_t *output) {
+    const uint64_t *mem = (const uint64_t *)image;
+    const uint64_t mask = (len / sizeof(uint64_t)) - 1;
+
+    // Seed the PRNG and all lanes from the nonce; the PRNG state must be odd
+    uint64_t x = load64(nonce) | 1;
+    uint64_t c0 = load64(nonce + 0),  c1 = load64(nonce + 8);
+    uint64_t c2 = load64(nonce + 16), c3 = load64(nonce + 24);
+    uint64_t c4 = ~c0, c5 = ~c1, c6 = ~c2, c7 = ~c3;
+    uint64_t a;
+
+    for (uint64_t i = 0; i < iterations; i += SWATT_LANES) {
+        SWATT_STEP(c0, c7, 0);
+        SWATT_STEP(c1, c0, 1);
+        SWATT_STEP(c2, c1, 2);
+        SWATT_STEP(c3, c2, 3);
+        SWATT_STEP(c4, c3, 4);
+        SWATT_STEP(c5, c4, 5);
+        SWATT_STEP(c6, c5, 6);
+        SWATT_STEP(c7, c6, 7);
+    }
+
+    // Fold the eight lanes down to the 32-byte response
+    uint64_t folded[4] = {
+        c0 ^ rotl64(c4, 32), c1 ^ rotl64(c5, 32),
+        c2 ^ rotl64(c6, 32), c3 ^ rotl64(c7, 32),
+    };
+    memcpy(output, folded, SWATT_OUTPUT_SIZE);
+}
@@ -0,0 +1,18 @@
+#ifndef SWATT_H
+#define SWATT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SWATT_IMAGE_SIZE (64 * 1024)  // Size of the checksummed memory image (power of two)
+#define SWATT_ITERATIONS (1u << 20)   // Checksum steps per challenge (multiple of 8)
+#define SWATT_NONCE_SIZE 32           // Challenge size in bytes
+#define SWATT_OUTPUT_SIZE 32          // Checksum size in bytes
+#define SWATT_DEFAULT_BOUND_US 20000  // Fallback response-time bound when not calibrated
+
+// Function prototypes
+void swatt_build_image(uint8_t *image, size_t len);
+void swatt_checksum(const uint8_t *image, size_t len, const uint8_t *nonce,
+                    uint32_t iterations, uint8_t *output);
+
+#endif // SWATT_H
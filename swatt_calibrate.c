@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "frame.h"
+#include "simple.h"
+#include "swatt.h"
+#include "timing.h"
+
+#define DEFAULT_RUNS 1000    // Timed kernel executions
+#define WARMUP_RUNS 20       // Untimed executions to settle caches and frequency
+#define DEFAULT_MARGIN 10    // Safety margin over the tail latency, in percent
+#define UART_BITS_PER_BYTE 10 // 8N1: start bit + 8 data bits + stop bit
+
+/**
+ * Profiles the SWATT checksum kernel on the current machine and derives the
+ * response-time bound for the verifier (`verifier -t -b <bound_us>`).
+ *
+ * The bound has to sit just above the honest prover's slowest plausible run:
+ * too tight and honest devices fail, too loose and an attacker gains slack for
+ * extra work. Run this on the prover hardware itself, with the same build.
+ */
+int main(int argc, char **argv) {
+    static uint8_t image[SWATT_IMAGE_SIZE] __attribute__((aligned(64)));
+    uint32_t runs = DEFAULT_RUNS;
+    uint32_t margin = DEFAULT_MARGIN;
+    uint32_t baud = 0; // 0: PTY link, no transfer time
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:m:r:")) != -1) {
+        if (opt == 'n') {
+            runs = (uint32_t)strtoul(optarg, NULL, 10);
+        } else if (opt == 'm') {
+            margin = (uint32_t)strtoul(optarg, NULL, 10);
+        } else if (opt == 'r') {
+            baud = (uint32_t)strtoul(optarg, NULL, 10);
+        } else {
+            fprintf(stderr, "Usage: %s [-n runs] [-m margin_pct] [-r baud]\n", argv[0]);
+            return -1;
+        }
+    }
+    if (runs == 0) runs = 1;
+
+    uint64_t *samples = malloc(runs * sizeof(uint64_t));
+    if (!samples) {
+        perror("[CALIBRATE] Failed to allocate samples");
+        return -1;
+    }
+
+    swatt_build_image(image, sizeof(image));
+
+    lat_stats_t stats;
+    lat_stats_init(&stats, samples, runs);
+
+    uint8_t nonce[SWATT_NONCE_SIZE], checksum[SWATT_OUTPUT_SIZE];
+    for (uint32_t i = 0; i < WARMUP_RUNS + runs; i++) {
+        if (simple_generate_nonce(nonce) == -1) { // Fresh challenge each run, like the verifier
+            fprintf(stderr, "[CALIBRATE] Failed to generate nonce\n");
+            free(samples);
+            return -1;
+        }
+
+        uint64_t start = timing_now_ns();
+        swatt_checksum(image, sizeof(image), nonce, SWATT_ITERATIONS, checksum);
+        uint64_t elapsed = timing_now_ns() - start;
+
+        if (i >= WARMUP_RUNS) lat_stats_record(&stats, elapsed);
+    }
+
+    printf("[CALIBRATE] Kernel: %u iterations over %u bytes\n",
+           SWATT_ITERATIONS, SWATT_IMAGE_SIZE);
+    printf("[CALIBRATE] Per-step cost: %.2fns\n",
+           (double)stats.min_ns / SWATT_ITERATIONS);
+    printf("[CALIBRATE] Runtime distribution (us):\n");
+    printf("    min    %10.1f\n", stats.min_ns / 1e3);
+    printf("    p50    %10.1f\n", lat_stats_percentile(&stats, 50.0) / 1e3);
+    printf("    p90    %10.1f\n", lat_stats_percentile(&stats, 90.0) / 1e3);
+    printf("    p99    %10.1f\n", lat_stats_percentile(&stats, 99.0) / 1e3);
+    printf("    p99.9  %10.1f\n", lat_stats_percentile(&stats, 99.9) / 1e3);
+    printf("    max    %10.1f\n", stats.max_ns / 1e3);
+
+    // Bound = tail of the honest runtime plus margin, plus the response transfer time
+    double tail_us = lat_stats_percentile(&stats, 99.9) / 1e3;
+    double link_us = baud ? (double)(SWATT_OUTPUT_SIZE + FRAME_OVERHEAD) * UART_BITS_PER_BYTE * 1e6 / baud : 0.0; // Framed answer
+    uint32_t bound_us = (uint32_t)(tail_us * (100 + margin) / 100.0 + link_us + 0.5);
+
+    printf("[CALIBRATE] Response transfer: %.1fus (%s)\n", link_us, baud ? "UART" : "PTY");
+    printf("[CALIBRATE] Recommended bound: -b %u\n", bound_us);
+
+    free(samples);
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "timing.h"
+
+/**
+ * Initialize a latency recorder.
+ *
+ * @param stats Recorder to initialize
+ * @param samples Storage for individual samples (NULL disables percentiles)
+ * @param capacity Number of samples that fit in the storage; once full, the
+ *                 oldest samples are overwritten so percentiles cover the
+ *                 most recent window
+ */
+void lat_stats_init(lat_stats_t *stats, uint64_t *samples, size_t capacity) {
+    stats->samples = samples;
+    stats->capacity = samples ? capacity : 0;
+    stats->count = 0;
+    stats->min_ns = UINT64_MAX;
+    stats->max_ns = 0;
+    stats->sum_ns = 0;
+}
+
+/**
+ * Record a single latency sample.
+ *
+ * @param stats Recorder to update
+ * @param ns Measured latency in nanoseconds
+ */
+void lat_stats_record(lat_stats_t *stats, uint64_t ns) {
+    if (stats->capacity) {
+        stats->samples[stats->count % stats->capacity] = ns;
+    }
+    stats->count++;
+    stats->sum_ns += ns;
+    if (ns < stats->min_ns) stats->min_ns = ns;
+    if (ns > stats->max_ns) stats->max_ns = ns;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Compute a percentile over the retained samples.
+ * Sorts a copy of the sample buffer, so the ring keeps recording over its
+ * oldest samples; call this only when reporting.
+ *
+ * @param stats Recorder holding the samples
+ * @param pct Percentile in the range [0, 100]
+ * @return Latency at the requested percentile in nanoseconds (0 if empty)
+ */
+uint64_t lat_stats_percentile(const lat_stats_t *stats, double pct) {
+    size_t n = stats->count < stats->capacity ? stats->count : stats->capacity;
+    if (n == 0) return 0;
+
+    uint64_t *sorted = malloc(n * sizeof(uint64_t));
+    if (!sorted) return 0;
+    memcpy(sorted, stats->samples, n * sizeof(uint64_t));
+    qsort(sorted, n, sizeof(uint64_t), compare_u64);
+    size_t idx = (size_t)(pct / 100.0 * (double)(n - 1) + 0.5);
+    uint64_t value = sorted[idx < n ? idx : n - 1];
+    free(sorted);
+    return value;
+}
+
+/**
+ * Print a one-line latency summary in microseconds.
+ *
+ * @param label Description of what was measured
+ * @param stats Recorder to summarize
+ */
+void lat_stats_print(const char *label, const lat_stats_t *stats) {
+    if (stats->count == 0) {
+        printf("%s: no samples\n", label);
+        return;
+    }
+    printf("%s: n=%zu min=%.1fus mean=%.1fus", label, stats->count,
+           stats->min_ns / 1e3, (double)stats->sum_ns / (double)stats->count / 1e3);
+    if (stats->capacity) {
+        printf(" p50=%.1fus p99=%.1fus", lat_stats_percentile(stats, 50.0) / 1e3,
+               lat_stats_percentile(stats, 99.0) / 1e3);
+    }
+    printf(" max=%.1fus\n", stats->max_ns / 1e3);
+}
+
+/**
+ * Rate of timing_cycles, calibrated against the monotonic clock over 20ms
+ * on first use.
+ *
+ * @return Cycles per nanosecond
+ */
+double timing_cycles_per_ns(void) {
+    static double rate;
+    if (rate == 0) {
+        uint64_t ns0 = timing_now_ns(), c0 = timing_cycles();
+        struct timespec ts = { 0, 20000000 };
+        nanosleep(&ts, NULL);
+        uint64_t ns1 = timing_now_ns(), c1 = timing_cycles();
+        rate = (double)(c1 - c0) / (ns1 - ns0);
+    }
+    return rate;
+}
@@ -0,0 +1,57 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * Read a monotonic, high-resolution timestamp in nanoseconds.
+ * CLOCK_MONOTONIC_RAW is not slewed by NTP, so short intervals measured with
+ * it are not distorted by clock adjustments.
+ *
+ * @return Current time in nanoseconds
+ */
+static inline uint64_t timing_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Read the CPU cycle counter. rdtscp waits until earlier instructions have
+ * executed, so the code being timed cannot leak past the reading. Other
+ * architectures fall back to nanoseconds.
+ *
+ * @return Cycle count (not comparable across CPUs without an invariant TSC)
+ */
+static inline uint64_t timing_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int aux;
+    return __rdtscp(&aux);
+#else
+    return timing_now_ns();
+#endif
+}
+
+// Latency recorder: running min/max/mean plus a sample buffer for percentiles
+typedef struct {
+    uint64_t *samples;   // Caller-provided sample storage (may be NULL)
+    size_t capacity;     // Number of slots in samples
+    size_t count;        // Total number of recorded samples
+    uint64_t min_ns;
+    uint64_t max_ns;
+    uint64_t sum_ns;
+} lat_stats_t;
+
+// Function prototypes
+void lat_stats_init(lat_stats_t *stats, uint64_t *samples, size_t capacity);
+void lat_stats_record(lat_stats_t *stats, uint64_t ns);
+uint64_t lat_stats_percentile(const lat_stats_t *stats, double pct);
+void lat_stats_print(const char *label, const lat_stats_t *stats);
+double timing_cycles_per_ns(void);
+
+#endif // TIMING_H
@@ -0,0 +1,38 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+/*
+ * Static user-level tracepoints (USDT) of the attestation path, provider
+ * "simple". With <sys/sdt.h> (systemtap-sdt-dev) installed, each probe
+ * compiles to one nop plus an ELF note; perf and bpftrace patch the nop only
+ * while they are attached, so a probe costs nothing otherwise. Without the
+ * header, or with -DSIMPLE_NO_TRACE, the probes compile to nothing.
+ *
+ *   bpftrace -l 'usdt:./verifier:simple:*'
+ *   perf buildid-cache --add ./prover && perf record -e sdt_simple:report_send ...
+ *
+ * Probes only take values the code already has, so a disabled probe never
+ * costs an extra clock read. Durations come from pairs of probes ending in
+ * _start and _done, which the tracer subtracts.
+ */
+
+#if defined(__has_include) && !defined(SIMPLE_NO_TRACE)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define SIMPLE_TRACE 1
+#endif
+#endif
+
+#ifdef SIMPLE_TRACE
+#define TRACE1(name, a) DTRACE_PROBE1(simple, name, a)
+#define TRACE2(name, a, b) DTRACE_PROBE2(simple, name, a, b)
+#define TRACE3(name, a, b, c) DTRACE_PROBE3(simple, name, a, b, c)
+#define TRACE4(name, a, b, c, d) DTRACE_PROBE4(simple, name, a, b, c, d)
+#else
+#define TRACE1(name, a) ((void)(a))
+#define TRACE2(name, a, b) ((void)(a), (void)(b))
+#define TRACE3(name, a, b, c) ((void)(a), (void)(b), (void)(c))
+#define TRACE4(name, a, b, c, d) ((void)(a), (void)(b), (void)(c), (void)(d))
+#endif
+
+#endif // TRACE_H
@@ -0,0 +1,167 @@
+#define _GNU_SOURCE // ppoll
+#include <stdio.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <poll.h>
+#include "timing.h"
+#include "uart.h"
+
+/**
+ * Opens a simulated UART connection between the Prover and the Verifier.
+ * Uses pseudo-terminals (pts) to simulate real hardware UART.
+ *
+ * @param device Path to the UART device (e.g., /dev/pts/X)
+ * @param log_tag Prefix for error messages (e.g., "[PROVER]")
+ * @return File descriptor for the opened UART connection, or -1 on failure
+ */
+int open_uart(const char *device, const char *log_tag) {
+    int fd = open(device, O_RDWR | O_NOCTTY | O_NDELAY); // Open UART in read-write mode
+    if (fd == -1) {
+        fprintf(stderr, "%s ", log_tag);
+        perror("Failed to open UART");
+        return -1;
+    }
+
+    struct termios options;
+    tcgetattr(fd, &options);
+    cfsetispeed(&options, B115200); // Set baud rate
+    cfsetospeed(&options, B115200);
+    options.c_cflag = CS8 | CLOCAL | CREAD; // 8-bit data, enable receiver
+    tcsetattr(fd, TCSANOW, &options); // Apply settings
+
+    tcflush(fd, TCIOFLUSH); // Clear any pending data
+    return fd;
+}
+
+/**
+ * Reads a fixed number of bytes from UART safely.
+ * Ensures all expected bytes are received before returning.
+ *
+ * @param fd UART file descriptor
+ * @param buffer Pointer to the destination buffer
+ * @param size Number of bytes to read
+ */
+void safe_uart_read(int fd, uint8_t *buffer, size_t size) {
+    size_t received = 0;
+    while (received < size) {
+        ssize_t bytes_read = read(fd, buffer + received, size - received);
+        if (bytes_read > 0) {
+            received += bytes_read;
+        }
+    }
+}
+
+/**
+ * Writes a fixed number of bytes to UART safely.
+ * Ensures all bytes are transmitted before returning.
+ *
+ * @param fd UART file descriptor
+ * @param buffer Pointer to the data to be sent
+ * @param size Number of bytes to write
+ */
+void safe_uart_write(int fd, const uint8_t *buffer, size_t size) {
+    size_t sent = 0;
+    while (sent < size) {
+        ssize_t bytes_written = write(fd, buffer + sent, size - sent);
+        if (bytes_written > 0) {
+            sent += bytes_written;
+        }
+    }
+}
+
+/**
+ * Sends one message as a frame (sync marker, header, payload, CRC).
+ *
+ * @param fd UART file descriptor
+ * @param type Message type (FRAME_REQUEST, FRAME_REPORT, ...)
+ * @param payload Message bytes
+ * @param len Payload length, at most FRAME_MAX_PAYLOAD
+ */
+void uart_write_frame(int fd, uint8_t type, const uint8_t *payload, size_t len) {
+    uint8_t buf[FRAME_MAX_SIZE];
+    size_t n = frame_encode(type, payload, len, buf);
+    safe_uart_write(fd, buf, n);
+}
+
+/**
+ * Reads from UART until the next valid frame is complete.
+ * Lost, corrupted or extra bytes are skipped by the receiver, so a damaged
+ * frame costs only itself and the link is back in step with the next one.
+ *
+ * @param fd UART file descriptor
+ * @param rx Receiver state, kept across calls (bytes after the frame stay buffered)
+ * @param frame Receives the frame; valid until the next call
+ */
+void uart_read_frame(int fd, frame_rx_t *rx, frame_t *frame) {
+    while (!frame_rx_next(rx, frame)) {
+        size_t space;
+        uint8_t *tail = frame_rx_space(rx, &space);
+        ssize_t bytes_read = read(fd, tail, space);
+        if (bytes_read > 0) frame_rx_commit(rx, bytes_read);
+    }
+}
+
+/**
+ * Sleeps until the UART is readable or the deadline passes.
+ *
+ * @param fd UART file descriptor
+ * @param deadline_ns Absolute time (timing_now_ns clock)
+ * @return 1 if readable, 0 once the deadline has passed
+ */
+static int wait_readable(int fd, uint64_t deadline_ns) {
+    uint64_t now = timing_now_ns();
+    if (now >= deadline_ns) return 0;
+    struct timespec timeout = { (time_t)((deadline_ns - now) / 1000000000ull), (long)((deadline_ns - now) % 1000000000ull) };
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+    ppoll(&pfd, 1, &timeout, NULL);
+    return 1; // Readable, or woken early: the caller reads and checks again
+}
+
+/**
+ * Reads a fixed number of bytes from UART, giving up at a deadline.
+ * Sleeps in poll instead of spinning while nothing arrives.
+ *
+ * @param fd UART file descriptor
+ * @param buffer Pointer to the destination buffer
+ * @param size Number of bytes to read
+ * @param deadline_ns Absolute time to give up (timing_now_ns clock)
+ * @return 0 once all bytes are in, -1 on timeout (buffer partly filled)
+ */
+int uart_read_until(int fd, uint8_t *buffer, size_t size, uint64_t deadline_ns) {
+    size_t received = 0;
+    while (received < size) {
+        ssize_t bytes_read = read(fd, buffer + received, size - received);
+        if (bytes_read > 0) {
+            received += bytes_read;
+        } else if (!wait_readable(fd, deadline_ns)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Reads the next valid frame, giving up at a deadline. Bytes of a frame
+ * that is still incomplete at the deadline stay buffered in rx.
+ *
+ * @param fd UART file descriptor
+ * @param rx Receiver state, kept across calls
+ * @param frame Receives the frame; valid until the next call
+ * @param deadline_ns Absolute time to give up (timing_now_ns clock)
+ * @return 0 if a frame was received, -1 on timeout
+ */
+int uart_read_frame_until(int fd, frame_rx_t *rx, frame_t *frame, uint64_t deadline_ns) {
+    while (!frame_rx_next(rx, frame)) {
+        size_t space;
+        uint8_t *tail = frame_rx_space(rx, &space);
+        ssize_t bytes_read = read(fd, tail, space);
+        if (bytes_read > 0) {
+            frame_rx_commit(rx, bytes_read);
+        } else if (!wait_readable(fd, deadline_ns)) {
+            return -1;
+        }
+    }
+    return 0;
+}
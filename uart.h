@@ -0,0 +1,17 @@
+#ifndef UART_H
+#define UART_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "frame.h"
+
+// Function prototypes
+int open_uart(const char *device, const char *log_tag);
+void safe_uart_read(int fd, uint8_t *buffer, size_t size);
+void safe_uart_write(int fd, const uint8_t *buffer, size_t size);
+void uart_write_frame(int fd, uint8_t type, const uint8_t *payload, size_t len);
+void uart_read_frame(int fd, frame_rx_t *rx, frame_t *frame);
+int uart_read_until(int fd, uint8_t *buffer, size_t size, uint64_t deadline_ns);
+int uart_read_frame_until(int fd, frame_rx_t *rx, frame_t *frame, uint64_t deadline_ns);
+
+#endif // UART_H
@@ -3,159 +3,354 @@
 #include <stdint.h>
 #include <string.h>
 #include <unistd.h>
-#include <fcntl.h>
+#include <signal.h>
 #include <termios.h>
-#include <openssl/hmac.h>
+#include <openssl/crypto.h>
+#include "golden.h"
+#include "keycache.h"
 #include "microvisor.h"
+#include "secarena.h"
+#include "simple.h"
+#include "swatt.h"
+#include "timing.h"
+#include "trace.h"
+#include "uart.h"
 
-#define NONCE_SIZE 32  // Size of nonce (random challenge) in bytes
-#define OUTPUT_SIZE 32 // HMAC-SHA256 output size in bytes
-#define KEY_SIZE 32    // Cryptographic key size in bytes
-#define COUNTER_SIZE 4 // Counter size (32-bit integer)
+#define VERIFIER_KEYCACHE_SIZE 1024 // Devices whose derived keys are kept
+#define VERIFIER_MAX_RETRIES 8        // Retransmissions per attestation, at most
 
-// Monotonic counter for the Verifier, stored securely
-__attribute__((section(".secure_data"))) volatile uint32_t C_V = 0;
+// Secure world and protocol state of this verifier, stored securely
+__attribute__((section(".secure_data"))) static microvisor_t mv;
+__attribute__((section(".secure_data"))) static simple_verifier_t verifier;
+
+// Per-device keys come from the master secret or the keystore; hot devices skip both
+static keycache_t keys;
+static keystore_t store;
+static volatile sig_atomic_t reload_keys; // Set by SIGHUP: keys were rotated
+static volatile sig_atomic_t dump_call_stats; // Set by SIGUSR1
 
 /**
- * Opens a simulated UART connection for communication with the Prover.
- * Uses pseudo-terminals (pts) to simulate real hardware UART.
+ * Notes a key rotation; the keys are reloaded before the next request.
  *
- * @param device Path to the UART device (e.g., /dev/pts/X)
- * @return File descriptor for the opened UART connection, or -1 on failure
+ * @param sig Signal number (unused)
  */
-int open_uart(const char *device) {
-    int fd = open(device, O_RDWR | O_NOCTTY | O_NDELAY); // Open UART in read-write mode
-    if (fd == -1) {
-        perror("[VERIFIER] Failed to open UART");
-        return -1;
-    }
-
-    struct termios options;
-    tcgetattr(fd, &options);
-    cfsetispeed(&options, B115200); // Set baud rate
-    cfsetospeed(&options, B115200);
-    options.c_cflag = CS8 | CLOCAL | CREAD; // 8-bit data, enable receiver
-    tcsetattr(fd, TCSANOW, &options); // Apply settings
-
-    tcflush(fd, TCIOFLUSH); // Clear any pending data
-    return fd;
+static void on_sighup(int sig) {
+    (void)sig;
+    reload_keys = 1;
 }
 
 /**
- * Computes an HMAC for the attestation request using the authentication key (Kauth).
- * The HMAC is computed over { C_V, Valid Software State, Nonce }.
+ * Requests a printout of the microvisor's per-entry-point cost.
  *
- * @param nonce Pointer to the generated nonce
- * @param output Buffer to store the computed HMAC
+ * @param sig Signal number (unused)
  */
-void compute_verifier_hmac(uint8_t *nonce, uint8_t *output) {
-    uint8_t key[KEY_SIZE];
-    uint8_t valid_state[KEY_SIZE];
-    uint8_t hmac_input[COUNTER_SIZE + KEY_SIZE + NONCE_SIZE];
-
-    get_secure_key(key, 0);  // Retrieve authentication key (Kauth)
-    compute_valid_software_state(valid_state); // Compute valid software state (VS)
-
-    // Construct HMAC input: { C_V || Valid Software State || Nonce }
-    uint32_t temp_CV = C_V;
-    memcpy(hmac_input, &temp_CV, COUNTER_SIZE);
-    memcpy(hmac_input + COUNTER_SIZE, valid_state, KEY_SIZE);
-    memcpy(hmac_input + COUNTER_SIZE + KEY_SIZE, nonce, NONCE_SIZE);
-
-    unsigned int len = 0;
-    HMAC(EVP_sha256(), key, KEY_SIZE, hmac_input, sizeof(hmac_input), output, &len);
-
-    hex_dump("[VERIFIER] Computed HMAC", output, OUTPUT_SIZE);
+static void on_sigusr1(int sig) {
+    (void)sig;
+    dump_call_stats = 1;
 }
 
 /**
- * Reads a fixed number of bytes from UART safely.
- * Ensures all expected bytes are received before returning.
+ * Loads the keys used to attest a device: from the keystore, derived from
+ * the master secret, or from kauth.key/kattest.key. Called again after a key
+ * rotation, which drops the previously loaded keys.
  *
- * @param fd UART file descriptor
- * @param buffer Pointer to the destination buffer
- * @param size Number of bytes to read
+ * @param master_file Master secret file, or NULL
+ * @param keystore_file Keystore file, or NULL
+ * @param device_id Device to attest
+ * @param reload Nonzero if keys were loaded before
+ * @return 0 on success, -1 on failure
  */
-void safe_uart_read(int fd, uint8_t *buffer, size_t size) {
-    size_t received = 0;
-    while (received < size) {
-        ssize_t bytes_read = read(fd, buffer + received, size - received);
-        if (bytes_read > 0) {
-            received += bytes_read;
+static int load_keys(const char *master_file, const char *keystore_file, uint32_t device_id, int reload) {
+    if (reload && (master_file || keystore_file)) keycache_free(&keys);
+    if (reload && keystore_file) keystore_close(&store);
+
+    if (keystore_file) {
+        uint64_t t0 = timing_now_ns();
+        if (keystore_open(&store, keystore_file) == -1) return -1;
+        if (keycache_init_store(&keys, &store, VERIFIER_KEYCACHE_SIZE) == -1) return -1;
+        if (!keys.arena.locked) fprintf(stderr, "[VERIFIER] Key cache is not locked in RAM\n");
+        printf("[VERIFIER] Keystore with %u devices opened in %.1fus\n", store.count, (timing_now_ns() - t0) / 1e3);
+        if (!keycache_get(&keys, device_id)) {
+            fprintf(stderr, "[VERIFIER] Device %u is not in the keystore\n", device_id);
+            return -1;
         }
+        printf("[VERIFIER] Attesting device %u with keystore keys\n", device_id);
+    } else if (master_file) {
+        uint8_t master[MV_KEY_SIZE];
+        int loaded = load_key_from_file(master, master_file);
+        int ready = loaded == 0 && keycache_init(&keys, master, sizeof(master), VERIFIER_KEYCACHE_SIZE) == 0;
+        memset(master, 0, sizeof(master));
+        if (!ready) return -1;
+        if (!keys.arena.locked) fprintf(stderr, "[VERIFIER] Key cache is not locked in RAM\n");
+        printf("[VERIFIER] Attesting device %u with derived keys\n", device_id);
+    } else {
+        initialize_keys(&mv); // Load cryptographic keys from the key files
     }
+    return 0;
 }
 
 /**
- * Writes a fixed number of bytes to UART safely.
- * Ensures all bytes are transmitted before returning.
+ * Runs time-bounded software-based attestation (SWATT mode).
+ * Sends a bare nonce and accepts the checksum only if it matches the value
+ * computed over the verifier's copy of the prover image AND it arrived within
+ * bound_us. The clock starts once the challenge has left the UART (tcdrain),
+ * so the bound covers the prover's computation plus the response transfer.
  *
- * @param fd UART file descriptor
- * @param buffer Pointer to the data to be sent
- * @param size Number of bytes to write
+ * @param uart_fd UART file descriptor
+ * @param bound_us Maximum accepted response time in microseconds
+ * @param timeout_ms Stop waiting for a checksum after this long (at least bound_us)
+ * @return -1 if no challenge could be generated (otherwise runs forever)
  */
-void safe_uart_write(int fd, uint8_t *buffer, size_t size) {
-    size_t sent = 0;
-    while (sent < size) {
-        ssize_t bytes_written = write(fd, buffer + sent, size - sent);
-        if (bytes_written > 0) {
-            sent += bytes_written;
+int run_timed_attestation(int uart_fd, uint32_t bound_us, uint32_t timeout_ms) {
+    static uint8_t image[SWATT_IMAGE_SIZE] __attribute__((aligned(64)));
+    static uint64_t samples[1024];
+    static frame_rx_t rx;
+    lat_stats_t stats;
+
+    swatt_build_image(image, sizeof(image)); // Verifier's copy of the expected prover memory
+    lat_stats_init(&stats, samples, sizeof(samples) / sizeof(samples[0]));
+
+    while (1) {
+        uint8_t nonce[SWATT_NONCE_SIZE];
+        uint8_t checksum[SWATT_OUTPUT_SIZE], expected[SWATT_OUTPUT_SIZE];
+
+        if (simple_generate_nonce(nonce) == -1) { // A predictable challenge would void the time bound
+            fprintf(stderr, "[VERIFIER] Failed to generate nonce\n");
+            return -1;
         }
-    }
-}
+        hex_dump("[VERIFIER] Timed Challenge", nonce, SWATT_NONCE_SIZE);
 
-/**
- * Generates a random nonce for the attestation process.
- *
- * @param nonce Pointer to the buffer where the nonce will be stored
- */
-void generate_nonce(uint8_t *nonce) {
-    FILE *fp = fopen("/dev/urandom", "r");
-    fread(nonce, 1, NONCE_SIZE, fp);
-    fclose(fp);
+        // Time only the prover's side: from challenge fully sent to checksum fully received
+        tcflush(uart_fd, TCIFLUSH); // A late checksum from the previous round is not an answer
+        frame_rx_init(&rx);
+        uart_write_frame(uart_fd, FRAME_SWATT_CHALLENGE, nonce, SWATT_NONCE_SIZE);
+        tcdrain(uart_fd);
+        uint64_t start = timing_now_ns();
+        uint64_t wait_ns = (uint64_t)timeout_ms * 1000000 > (uint64_t)bound_us * 1000 ?
+                           (uint64_t)timeout_ms * 1000000 : (uint64_t)bound_us * 1000;
+        frame_t frame;
+        int timed_out;
+        do {
+            timed_out = uart_read_frame_until(uart_fd, &rx, &frame, start + wait_ns) == -1;
+        } while (!timed_out && (frame.type != FRAME_SWATT_CHECKSUM || frame.length != SWATT_OUTPUT_SIZE));
+        if (timed_out) {
+            printf("[VERIFIER]  Timed Attestation FAILED! (no response within %.1fms)\n", wait_ns / 1e6);
+            sleep(5);
+            continue;
+        }
+        uint64_t elapsed = timing_now_ns() - start;
+        memcpy(checksum, frame.payload, SWATT_OUTPUT_SIZE);
+
+        lat_stats_record(&stats, elapsed);
+        swatt_checksum(image, sizeof(image), nonce, SWATT_ITERATIONS, expected);
+
+        int correct = CRYPTO_memcmp(checksum, expected, SWATT_OUTPUT_SIZE) == 0;
+        int in_time = elapsed <= (uint64_t)bound_us * 1000;
+        printf("[VERIFIER] Response time: %.1fus (bound %uus)\n", elapsed / 1e3, bound_us);
+
+        if (correct && in_time) {
+            printf("[VERIFIER]  Timed Attestation SUCCESSFUL!\n");
+        } else {
+            printf("[VERIFIER]  Timed Attestation FAILED! (%s)\n",
+                   correct ? "response too slow" : "checksum mismatch");
+        }
+        lat_stats_print("[VERIFIER] Response latency", &stats);
+
+        sleep(5); // Wait before sending the next challenge
+    }
 }
 
-int main() {
-    initialize_keys(); // Load cryptographic keys at startup
+int main(int argc, char **argv) {
+    int timed = 0;                           // -t: time-bounded software-based attestation
+    uint32_t bound_us = SWATT_DEFAULT_BOUND_US; // -b: response-time bound (see swatt_calibrate)
+    static uint8_t golden[MEASURE_DIGEST_SIZE]; // -m: expected prover measurement digest
+    const uint8_t *expected_measurement = NULL; // NULL: measure locally
+    uint32_t max_age_ms = 0;                 // -a: accepted measurement age (0: measure now)
+    const char *master_file = NULL;          // -K: derive per-device keys from this master secret
+    const char *keystore_file = NULL;        // -k: look per-device keys up in this keystore
+    uint32_t device_id = 0;                  // -i: device to attest (with -K or -k)
+    const char *golden_file = NULL;          // -g: golden database with the expected measurement
+    uint32_t model = 0, fw_version = 0;      // -M, -F: the device's hardware model and firmware (with -g)
+    uint32_t timeout_ms = 2000;              // -w: report deadline after each request
+    uint32_t retries = 3;                    // -R: retransmissions before the attestation fails
+    int opt;
+    while ((opt = getopt(argc, argv, "tb:m:a:K:k:i:g:M:F:w:R:")) != -1) {
+        if (opt == 't') {
+            timed = 1;
+        } else if (opt == 'b') {
+            bound_us = (uint32_t)strtoul(optarg, NULL, 10);
+        } else if (opt == 'm') {
+            if (parse_hex(optarg, golden, sizeof(golden)) == -1) {
+                fprintf(stderr, "[VERIFIER] -m expects %d hex digits\n", 2 * MEASURE_DIGEST_SIZE);
+                return -1;
+            }
+            expected_measurement = golden;
+        } else if (opt == 'a') {
+            max_age_ms = (uint32_t)strtoul(optarg, NULL, 10);
+        } else if (opt == 'K') {
+            master_file = optarg;
+        } else if (opt == 'k') {
+            keystore_file = optarg;
+        } else if (opt == 'i') {
+            device_id = (uint32_t)strtoul(optarg, NULL, 10);
+        } else if (opt == 'g') {
+            golden_file = optarg;
+        } else if (opt == 'M') {
+            model = (uint32_t)strtoul(optarg, NULL, 10);
+        } else if (opt == 'F') {
+            fw_version = (uint32_t)strtoul(optarg, NULL, 10);
+        } else if (opt == 'w') {
+            timeout_ms = (uint32_t)strtoul(optarg, NULL, 10);
+        } else if (opt == 'R') {
+            retries = (uint32_t)strtoul(optarg, NULL, 10);
+            if (retries > VERIFIER_MAX_RETRIES) retries = VERIFIER_MAX_RETRIES;
+        } else {
+            fprintf(stderr, "Usage: %s [-t] [-b bound_us] [-m measurement_hex | -g golden_db -M model -F version] "
+                            "[-a max_age_ms] [-K master_key_file | -k keystore_file] [-i device_id] "
+                            "[-w timeout_ms] [-R retries]\n", argv[0]);
+            return -1;
+        }
+    }
 
-    int uart_fd = open_uart("/dev/pts/7"); // Open simulated UART connection
+    int uart_fd = open_uart("/dev/pts/7", "[VERIFIER]"); // Open simulated UART connection
     if (uart_fd == -1) return -1; // Exit if UART cannot be opened
 
+    if (timed) {
+        return run_timed_attestation(uart_fd, bound_us, timeout_ms);
+    }
+
+    size_t secure_size;
+    int locked;
+    if (secarena_protect_section(&secure_size, &locked) == -1) return -1;
+    printf("[VERIFIER] Secure data: %zu KiB between guard pages, %s\n", secure_size / 1024,
+           locked ? "locked in RAM" : "NOT locked (raise RLIMIT_MEMLOCK)");
+
+    microvisor_init(&mv);
+    mv.verbose = 1;
+
+    if (load_keys(master_file, keystore_file, device_id, 0) == -1) return -1;
+    signal(SIGHUP, on_sighup);
+    signal(SIGUSR1, on_sigusr1);
+    static golden_db_t golden_db;
+    if (golden_file) {
+        if (golden_open(&golden_db, golden_file) == -1) return -1;
+        printf("[VERIFIER] Golden database with %u entries, expecting model %u version %u\n",
+               golden_db.count, model, fw_version);
+    }
+    simple_verifier_init(&verifier, &mv);
+    verifier.expected_measurement = expected_measurement;
+    verifier.max_age_ms = max_age_ms;
+    verifier.verbose = 1;
+
+    static frame_rx_t rx;
+    frame_rx_init(&rx);
+
+    static uint64_t rtt_samples[1024];
+    lat_stats_t rtt;
+    lat_stats_init(&rtt, rtt_samples, sizeof(rtt_samples) / sizeof(rtt_samples[0]));
+    uint64_t timeouts = 0, retransmissions = 0, unanswered = 0;
+
     while (1) { // Continuous loop to send attestation requests
-        uint8_t nonce[NONCE_SIZE];
-        uint8_t hmac[OUTPUT_SIZE];
-        uint8_t valid_state[KEY_SIZE];
+        simple_request_t attempts[VERIFIER_MAX_RETRIES + 1]; // Every request sent this round
+        uint8_t buf[SIMPLE_REQUEST_SIZE];
 
+        if (dump_call_stats) {
+            dump_call_stats = 0;
+            microvisor_print_call_stats(&mv, "[VERIFIER]");
+        }
         printf("[VERIFIER] Sending attestation request...\n");
 
-        // Generate a fresh nonce for attestation request
-        generate_nonce(nonce);
-        hex_dump("[VERIFIER] Generated Nonce", nonce, NONCE_SIZE);
+        if (reload_keys) { // Rotated keys: the prover still accepts the old ones for its grace period
+            reload_keys = 0;
+            if (load_keys(master_file, keystore_file, device_id, 1) == -1) return -1;
+            printf("[VERIFIER] Reloaded keys\n");
+        }
+        if (master_file || keystore_file) microvisor_use_keys(&mv, keycache_get(&keys, device_id));
 
-        // Increment counter (C_V = C_V + 1) to ensure freshness
-        C_V++;
+        // Expected measurement from the golden database, picking up a swapped file
+        if (golden_file) {
+            if (golden_reload(&golden_db) == 1) {
+                printf("[VERIFIER] Reloaded golden database (%u entries)\n", golden_db.count);
+            }
+            if (golden_lookup(&golden_db, model, fw_version, golden) == -1) {
+                printf("[VERIFIER] No golden measurement for model %u version %u\n", model, fw_version);
+                sleep(5);
+                continue;
+            }
+            verifier.expected_measurement = golden;
+        }
 
-        // Compute HMAC for { C_V, Valid Software State, Nonce }
-        compute_verifier_hmac(nonce, hmac);
+        // Reports that turn up after a round gave up on them answer no request
+        tcflush(uart_fd, TCIFLUSH);
+        frame_rx_init(&rx);
 
-        // Send attestation request: { C_V, Valid Software State, Nonce, HMAC }
-        safe_uart_write(uart_fd, (uint8_t *)&C_V, COUNTER_SIZE);
-        compute_valid_software_state(valid_state);
-        safe_uart_write(uart_fd, valid_state, KEY_SIZE);
-        safe_uart_write(uart_fd, nonce, NONCE_SIZE);
-        safe_uart_write(uart_fd, hmac, OUTPUT_SIZE);
+        int status = SIMPLE_ERR_REPORT, answered = 0;
+        for (uint32_t tries = 0; tries <= retries && !answered; tries++) {
+            simple_request_t *request = &attempts[tries];
 
-        printf("[VERIFIER] Request sent with counter: %u\n", C_V);
+            // Fresh nonce, C_V = C_V + 1, expected VS and HMAC over { C_V, VS, Nonce, MaxAge }.
+            // A retransmission gets a fresh counter too: if only the report was lost, the
+            // prover has accepted the previous counter and would reject the same request.
+            TRACE2(request_build_start, device_id, verifier.counter + 1);
+            if (simple_verifier_build_request(&verifier, request) != SIMPLE_OK) {
+                fprintf(stderr, "[VERIFIER] Failed to generate nonce\n");
+                return -1;
+            }
+            TRACE2(request_build_done, device_id, request->counter);
 
-        // Read attestation report from Prover
-        uint8_t report[1 + OUTPUT_SIZE];
-        safe_uart_read(uart_fd, report, sizeof(report));
+            // Send attestation request: { C_V, Valid Software State, Nonce, MaxAge, HMAC }
+            simple_encode_request(request, buf);
+            uint64_t sent_ns = timing_now_ns();
+            uart_write_frame(uart_fd, FRAME_REQUEST, buf, sizeof(buf));
+            TRACE3(request_send, device_id, request->counter, tries);
 
-        // Verify attestation report
-        if (report[0] == 1) {
+            printf("[VERIFIER] Request sent with counter: %u\n", request->counter);
+            TRACE2(mac_start, device_id, request->counter);
+            simple_verifier_expect_report(&verifier, request); // While the prover measures
+            TRACE2(mac_done, device_id, request->counter);
+
+            // Read attestation report from Prover, skipping anything that is not one
+            frame_t frame;
+            uint64_t deadline = sent_ns + (uint64_t)timeout_ms * 1000000;
+            int timed_out;
+            do {
+                timed_out = uart_read_frame_until(uart_fd, &rx, &frame, deadline);
+            } while (!timed_out && (frame.type != FRAME_REPORT || frame.length != SIMPLE_REPORT_SIZE));
+            if (timed_out) {
+                TRACE3(request_timeout, device_id, request->counter, tries);
+                timeouts++;
+                printf("[VERIFIER] No report from device %u within %ums (attempt %u of %u)\n",
+                       device_id, timeout_ms, tries + 1, retries + 1);
+                if (tries < retries) retransmissions++;
+                continue;
+            }
+            answered = 1;
+            uint64_t rtt_ns = timing_now_ns() - sent_ns;
+            TRACE3(report_receive, device_id, request->counter, rtt_ns);
+            lat_stats_record(&rtt, rtt_ns);
+            lat_stats_print("[VERIFIER] Attestation round trip", &rtt);
+
+            // Verify attestation report; a late answer to an earlier attempt of this round counts too
+            simple_report_t report;
+            simple_decode_report(frame.payload, &report);
+            status = simple_verifier_check_report(&verifier, request, &report);
+            for (uint32_t i = tries; status == SIMPLE_ERR_REPORT_MAC && i-- > 0;) {
+                status = simple_verifier_check_report(&verifier, &attempts[i], &report);
+            }
+            TRACE3(report_verdict, device_id, request->counter, status);
+        }
+
+        if (!answered) {
+            unanswered++;
+            printf("[VERIFIER]  Attestation FAILED! (device %u not responding)\n", device_id);
+        } else if (status == SIMPLE_OK) {
             printf("[VERIFIER]  Attestation SUCCESSFUL!\n");
         } else {
-            printf("[VERIFIER]  Attestation FAILED!\n");
+            printf("[VERIFIER]  Attestation FAILED!%s\n", status == SIMPLE_ERR_REPORT_MAC ? " (report not authentic)" : "");
+        }
+        if (timeouts) {
+            printf("[VERIFIER] Device %u: %llu timeouts, %llu retransmissions, %llu rounds unanswered\n", device_id,
+                   (unsigned long long)timeouts, (unsigned long long)retransmissions, (unsigned long long)unanswered);
         }
 
         sleep(5); // Wait before sending the next attestation request